@@ -10,6 +10,10 @@ function(afsproject_setup_dependencies)
     find_package(NumCpp REQUIRED)
   endif()
 
+  if(NOT TARGET Threads::Threads)
+    find_package(Threads REQUIRED)
+  endif()
+
   if(NOT TARGET Catch2::Catch2WithMain)
     cpmaddpackage("gh:catchorg/Catch2@3.11.0")
   endif()
@@ -123,6 +123,9 @@ macro(afsproject_setup_options)
 
   option(afsproject_BUILD_FUZZ_TESTS "Enable fuzz testing executable" ${DEFAULT_FUZZER})
 
+  option(afsproject_FLOAT_PIPELINE "Run the fingerprint pipeline in single precision by default" OFF)
+  option(afsproject_ENABLE_AVX2 "Build the downmix kernels for CPUs with AVX2" OFF)
+
 endmacro()
 
 macro(afsproject_global_options)
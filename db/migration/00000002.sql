@@ -0,0 +1,18 @@
+CREATE TABLE IF NOT EXISTS fingerprint_config (
+    id                 INTEGER PRIMARY KEY CHECK (id = 1),
+    fan_out            INTEGER NOT NULL,
+    anchor_offset      INTEGER NOT NULL,
+    min_time_delta_ms  INTEGER NOT NULL,
+    max_time_delta_ms  INTEGER NOT NULL,
+    max_freq_delta     INTEGER NOT NULL,
+    freq_bits          INTEGER NOT NULL,
+    time_delta_bits    INTEGER NOT NULL,
+    time_step          REAL NOT NULL,
+    time_quantum_ms    INTEGER NOT NULL
+);
+
+-- Catalogues built before this table existed used these parameters.
+INSERT OR IGNORE INTO fingerprint_config
+    (id, fan_out, anchor_offset, min_time_delta_ms, max_time_delta_ms, max_freq_delta, freq_bits, time_delta_bits,
+     time_step, time_quantum_ms)
+VALUES (1, 5, 3, 0, 0, 0, 9, 14, 0.046, 1);
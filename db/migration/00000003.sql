@@ -0,0 +1,5 @@
+-- 0 = strongest bin per band, 1 = 2D local maxima under a peaks-per-second budget.
+ALTER TABLE fingerprint_config ADD COLUMN peak_extractor INTEGER NOT NULL DEFAULT 0;
+ALTER TABLE fingerprint_config ADD COLUMN peak_time_radius INTEGER NOT NULL DEFAULT 3;
+ALTER TABLE fingerprint_config ADD COLUMN peak_freq_radius INTEGER NOT NULL DEFAULT 8;
+ALTER TABLE fingerprint_config ADD COLUMN peaks_per_second REAL NOT NULL DEFAULT 30.0;
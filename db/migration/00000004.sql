@@ -0,0 +1,13 @@
+CREATE TABLE IF NOT EXISTS hash_stats (
+    hash        INTEGER PRIMARY KEY,
+    song_count  INTEGER NOT NULL
+);
+
+-- Songs fingerprinted before the table existed.
+INSERT OR IGNORE INTO hash_stats (hash, song_count)
+SELECT hash, COUNT(DISTINCT song_id) FROM fingerprints GROUP BY hash;
+
+-- A hash found in more than stop_hash_max_fraction of the songs is ignored, once the
+-- catalogue holds at least stop_hash_min_songs songs.
+ALTER TABLE fingerprint_config ADD COLUMN stop_hash_max_fraction REAL NOT NULL DEFAULT 0.1;
+ALTER TABLE fingerprint_config ADD COLUMN stop_hash_min_songs INTEGER NOT NULL DEFAULT 50;
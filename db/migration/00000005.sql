@@ -0,0 +1,5 @@
+ALTER TABLE fingerprint_config ADD COLUMN dedupe_tolerance_ms INTEGER NOT NULL DEFAULT 0;
+
+-- Postings are unique from now on, drop the repeats inserted before.
+DELETE FROM fingerprints
+WHERE id NOT IN (SELECT MIN(id) FROM fingerprints GROUP BY hash, song_id, time_offset);
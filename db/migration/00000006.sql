@@ -0,0 +1,2 @@
+-- Blocks quieter than this RMS level in dBFS are not fingerprinted.
+ALTER TABLE fingerprint_config ADD COLUMN silence_threshold_db REAL NOT NULL DEFAULT -60.0;
@@ -0,0 +1,21 @@
+-- 0 = constellation hashes, 1 = 32-bit sub-fingerprints.
+ALTER TABLE fingerprint_config ADD COLUMN fingerprint_mode INTEGER NOT NULL DEFAULT 0;
+ALTER TABLE fingerprint_config ADD COLUMN sub_fingerprint_hop INTEGER NOT NULL DEFAULT 128;
+ALTER TABLE fingerprint_config ADD COLUMN max_bit_error_rate REAL NOT NULL DEFAULT 0.35;
+
+-- Every sub-fingerprint of a song, 4 bytes per frame in little-endian order.
+CREATE TABLE IF NOT EXISTS sub_fingerprints (
+    song_id  INTEGER PRIMARY KEY,
+    frames   BLOB NOT NULL,
+    FOREIGN KEY(song_id) REFERENCES songs(id)
+);
+
+-- Exact-match seeds into the frames. The primary key is the lookup index, WITHOUT ROWID
+-- keeps it the only copy of the rows.
+CREATE TABLE IF NOT EXISTS sub_fingerprint_seeds (
+    value    INTEGER NOT NULL,
+    song_id  INTEGER NOT NULL,
+    frame    INTEGER NOT NULL,
+    PRIMARY KEY (value, song_id, frame),
+    FOREIGN KEY(song_id) REFERENCES songs(id)
+) WITHOUT ROWID;
@@ -0,0 +1,3 @@
+-- Tracks split out of a single-file album image: their number and where they start in it.
+ALTER TABLE songs ADD COLUMN track_number INTEGER;
+ALTER TABLE songs ADD COLUMN start_seconds REAL NOT NULL DEFAULT 0;
@@ -2,40 +2,161 @@
 #define afs_h_
 
 #include <afsproject/audio_file.h>
+#include <afsproject/band_layout.h>
 #include <afsproject/db.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/sub_fingerprint.h>
+#include <afsproject/window_table.h>
+#include <cstddef>
 #include <cstdint>
-#include <optional>
-#include <unordered_map>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace afs {
 
+// Peaks kept per STFT block as (bin, magnitude) pairs.
 using Matrix = std::vector<std::vector<std::pair<int, double>>>;
-using Fingerprint = std::unordered_map<uint32_t, std::vector<uint64_t>>;
+// One hash: the packed address and the time of its anchor in ms.
+struct FingerprintEntry
+{
+  uint32_t address;
+  uint32_t anchor_time;
+
+  friend bool operator==(const FingerprintEntry &, const FingerprintEntry &) = default;
+};
+
+// Flat fingerprint buffer, sorted by address and then anchor time, without duplicates.
+// All entries of one address are adjacent.
+using Fingerprint = std::vector<FingerprintEntry>;
 
-const double TIME_STEP = 0.046;
 const double BIN_SIZE = 10.7;
 
-const uint16_t NINE_BITS_MASK = 0x1FF;
-const uint16_t FOURTEEN_BITS_MASK = 0x3FFF;
-const uint32_t THIRTY_TWO_BITS_MASK = 0xFFFFFFFF;
+constexpr size_t FFT_WINDOW_SIZE = 1024;
+constexpr double LOW_PASS_CUTOFF = 5000.0;
+
+// Window and logarithmic bands the fingerprints are computed with.
+template<typename T> using FingerprintWindow = WindowTable<WindowKind::Hamming, FFT_WINDOW_SIZE, T>;
+using FingerprintBands = BandLayout<0, 10, 20, 40, 80, 160, 513>;
+
+static_assert(FingerprintBands::NUM_BINS == (FFT_WINDOW_SIZE / 2) + 1, "The bands have to cover the whole spectrum.");
+
+// |X|^2 of every STFT block in one buffer, one row of NUM_BINS bins per block.
+template<typename T> struct PowerSpectrogram
+{
+  static constexpr size_t NUM_BINS = FingerprintBands::NUM_BINS;
+
+  std::vector<T> power;
+  size_t num_blocks{};
+  // Blocks that passed the silence gate, the rows of the others are left at zero power.
+  std::vector<uint8_t> active;
+
+  [[nodiscard]] std::span<const T> row(size_t block) const
+  {
+    return std::span<const T>(power).subspan(block * NUM_BINS, NUM_BINS);
+  }
+};
+
+// Best alignment of one query against the catalogue, song_id is -1 when nothing matched.
+struct MatchResult
+{
+  int64_t song_id = -1;
+  // IDF weighted votes for the alignment and how many hashes cast them.
+  double score{};
+  int num_matches{};
+  int time_offset_ms{};
+};
+
+// Best alignment of a sub-fingerprint query, song_id is -1 when no candidate stays below
+// the bit error rate of the config.
+struct SubFingerprintMatch
+{
+  int64_t song_id = -1;
+  double bit_error_rate{};
+  size_t num_frames{};
+  int time_offset_ms{};
+};
+
+// One track of an album image, stored as a song of its own. Samples per channel.
+struct TrackSlice
+{
+  long long song_id;
+  uint64_t start_sample;
+  uint64_t end_sample;
+};
+
+// Sample type the fingerprint pipeline runs in. Only the peak bins end up in the hashes,
+// so single precision gives the same fingerprints at half the memory traffic.
+enum class SamplePrecision : uint8_t { Double, Float };
+
+#ifdef AFS_FLOAT_PIPELINE
+constexpr SamplePrecision DEFAULT_SAMPLE_PRECISION = SamplePrecision::Float;
+#else
+constexpr SamplePrecision DEFAULT_SAMPLE_PRECISION = SamplePrecision::Double;
+#endif
 
 class AFS// NOLINT
 {
 private:
   static void normalizePCMData(IAudioFile &);
-  static void stereoToMono(IAudioFile &);
-  static void applyLowPassFilter(IAudioFile &);
-  static void downSampling(IAudioFile &);
-  static Matrix shortTimeFourierTransform(IAudioFile &);
-  static void filtering(Matrix &);
-  static Fingerprint generateFingerprints(Matrix &, std::optional<long long>);
+  template<typename T> static std::vector<T> stereoToMono(const IAudioFile &);
+  template<typename T> static void applyLowPassFilter(std::vector<T> &, uint32_t);
+  static uint32_t processingRate(uint32_t);
+  template<typename T> static uint32_t downSampling(std::vector<T> &, uint32_t);
+  template<typename T> static void resample(std::vector<T> &, uint32_t, uint32_t);
+  template<typename T>
+  static PowerSpectrogram<T>
+    shortTimeFourierTransform(std::span<const T>, const FingerprintConfig &, size_t hop = FFT_WINDOW_SIZE / 2);
+  template<typename T> static Matrix filtering(const PowerSpectrogram<T> &);
+  template<typename T> static Fingerprint fingerprint(std::vector<T>, uint32_t, const FingerprintConfig &);
+  static Fingerprint generateFingerprints(const Matrix &, const FingerprintConfig &);
+  static void deduplicate(Fingerprint &, uint32_t);
+  template<typename T> static SubFingerprint subFingerprint(std::vector<T>, uint32_t, const FingerprintConfig &);
+  static void storeFingerprints(const Fingerprint &, long long, SQLiteDB &, const FingerprintConfig &);
+  static void storeSubFingerprints(const SubFingerprint &, long long, SQLiteDB &);
 
 public:
   AFS() = default;
 
-  static void storingFingerprints(IAudioFile &, long long, SQLiteDB &);
-  static void searchForRecord(IAudioFile &, SQLiteDB &);
+  static Fingerprint computeFingerprints(const IAudioFile &,
+    SamplePrecision = DEFAULT_SAMPLE_PRECISION,
+    const FingerprintConfig & = {});
+  // Same pipeline on mono samples in [-1, 1) at `sample_rate`, e.g. a window of a stream.
+  static Fingerprint computeFingerprints(std::span<const double>,
+    uint32_t sample_rate,
+    SamplePrecision = DEFAULT_SAMPLE_PRECISION,
+    const FingerprintConfig & = {});
+  static SubFingerprint computeSubFingerprints(const IAudioFile &,
+    SamplePrecision = DEFAULT_SAMPLE_PRECISION,
+    const FingerprintConfig & = {});
+  static SubFingerprint computeSubFingerprints(std::span<const double>,
+    uint32_t sample_rate,
+    SamplePrecision = DEFAULT_SAMPLE_PRECISION,
+    const FingerprintConfig & = {});
+  // Both hash with the fingerprint config stored in the database, in the mode it names.
+  static void storingFingerprints(IAudioFile &, long long, SQLiteDB &, SamplePrecision = DEFAULT_SAMPLE_PRECISION);
+  // Fingerprints every track of the mono stream on its own thread, then stores them one
+  // song at a time. Anchor times count from the start of each track.
+  static void storingTrackFingerprints(std::span<const double>,
+    uint32_t sample_rate,
+    std::span<const TrackSlice>,
+    SQLiteDB &,
+    SamplePrecision = DEFAULT_SAMPLE_PRECISION);
+  static void searchForRecord(IAudioFile &, SQLiteDB &, SamplePrecision = DEFAULT_SAMPLE_PRECISION);
+
+  // Matches many constellation queries in one pass over the index: the hashes of all of
+  // them are merged, every posting list is fetched once and its postings vote in the
+  // tables of the queries that hold the hash. One result per query, in the same order.
+  static std::vector<MatchResult> matchFingerprints(std::span<const Fingerprint>, SQLiteDB &, const FingerprintConfig &);
+  static void printMatch(const MatchResult &);
+  // Seeds candidates with the query frames found verbatim in a song, then compares the
+  // frames around each alignment by their bit error rate.
+  static SubFingerprintMatch searchSubFingerprints(const SubFingerprint &, SQLiteDB &, const FingerprintConfig &);
+  static void printMatch(const SubFingerprintMatch &);
+
+  // One flag per STFT block of FFT_WINDOW_SIZE samples every `hop`, set when the RMS of the
+  // block reaches `threshold_db` dBFS.
+  template<typename T> static std::vector<uint8_t> gateSilence(std::span<const T>, size_t, size_t, double);
 };
 
 }// namespace afs
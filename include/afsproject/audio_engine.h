@@ -2,9 +2,14 @@
 #define audio_engine_h_
 
 #include <afsproject/audio_file.h>
+#include <afsproject/pipe_audio_file.h>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace afs {
 
@@ -12,14 +17,46 @@ enum class AudioFormat : uint8_t { Wave, Flac, Unsupported };
 
 class IAudioFile;
 
+// Bytes read from the start of a file to tell its format, fewer when the file is shorter.
+constexpr size_t PROBE_SIZE = 16;
+
+// A format the engine can load. `probe` looks at the first bytes of a file only, `open`
+// builds the audio file once the probe matched and `scan` reads its headers alone.
+struct AudioDecoder
+{
+  std::string name;
+  std::function<bool(std::span<const uint8_t>)> probe;
+  std::function<std::unique_ptr<IAudioFile>(const std::string &)> open;
+  std::function<bool(const std::string &, AudioInfo &)> scan;
+};
+
+bool isWaveHeader(std::span<const uint8_t>);
+bool isFlacHeader(std::span<const uint8_t>);
+
 class AudioEngine// NOLINT
 {
 public:
-  AudioEngine() = default;
+  // Comes with the WAV and FLAC decoders registered.
+  AudioEngine();
   ~AudioEngine() = default;
 
-  static std::unique_ptr<IAudioFile> loadAudioFile(const std::string &);
+  // Decoders are probed in the order they were registered, the first match wins.
+  void registerDecoder(AudioDecoder);
+  // Classifies a file from its first PROBE_SIZE bytes, nullptr when no decoder takes it.
+  [[nodiscard]] const AudioDecoder *probe(const std::string &) const;
+  [[nodiscard]] const AudioDecoder *probe(std::span<const uint8_t>) const;
+
+  // "-" reads a WAV stream or raw PCM in the default raw format from stdin. Files are
+  // probed first, one that no decoder takes is rejected before it is read any further.
+  [[nodiscard]] std::unique_ptr<IAudioFile> loadAudioFile(const std::string &) const;
+  // Stream properties and tags from the headers of a file, none of its audio is decoded.
+  bool scanAudioFile(const std::string &, AudioInfo &) const;
+  // Reads stdin ("-") or a pipe in one pass, raw PCM is taken to be in `raw_format`.
+  static std::unique_ptr<IAudioFile> loadAudioStream(const std::string &, const RawPCMFormat &raw_format = {});
   static bool saveAudioFile(const IAudioFile &, const std::string &);
+
+private:
+  std::vector<AudioDecoder> m_decoders;
 };
 
 }// namespace afs
@@ -1,8 +1,14 @@
 #ifndef audio_file_h_
 #define audio_file_h_
 
+#include <afsproject/cue_sheet.h>
+#include <afsproject/downmix.h>
+#include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
+#include <variant>
 #include <vector>
 
 namespace afs {
@@ -16,6 +22,32 @@ struct Metadata
   std::string date;
 };
 
+// What the headers of a file say about it, gathered without decoding any audio.
+struct AudioInfo
+{
+  uint32_t sample_rate{};
+  uint16_t num_channels{};
+  uint16_t bit_depth{};
+  // Samples per channel, 0 when the header does not know the length.
+  uint64_t num_frames{};
+  Metadata metadata;
+};
+
+// Interleaved samples in the width the decoder produced them. Conversion to double is
+// deferred until the fingerprinting pipeline actually asks for it. Integer samples are
+// full scale for the file's bit depth, floating point samples are already in [-1, 1].
+using PCMBuffer =
+  std::variant<std::monostate, std::vector<int16_t>, std::vector<int32_t>, std::vector<float>, std::vector<double>>;
+
+// Converts interleaved samples to doubles in [-1, 1).
+std::vector<double> convertToDouble(const PCMBuffer &, uint16_t bit_depth);
+// Converts and mixes all channels into one in a single pass.
+std::vector<double> downmixToMono(const PCMBuffer &, uint16_t bit_depth, const DownmixMatrix &);
+std::vector<double> downmixToMono(std::span<const double>, const DownmixMatrix &);
+// Same in single precision, integer input takes the SIMD kernels when there are some.
+std::vector<float> downmixToMonoFloat(const PCMBuffer &, uint16_t bit_depth, const DownmixMatrix &);
+size_t getNumStoredSamples(const PCMBuffer &);
+
 class IAudioFile// NOLINT
 {
 public:
@@ -26,6 +58,7 @@ public:
   virtual void setPCMData(const std::vector<double> &pcm_data, uint32_t sample_rate, uint16_t num_channels)// NOLINT
   {
     m_pcm_data = pcm_data;
+    m_samples = std::monostate{};
     m_sample_rate = sample_rate;
     m_num_channels = num_channels;
     if (m_sample_rate > 0 && m_num_channels > 0) {
@@ -35,6 +68,25 @@ public:
     }
   }
   [[nodiscard]] virtual std::vector<double> getPCMData() const = 0;
+  // Mono samples in [-1, 1), straight from the stored PCM without an interleaved double copy.
+  [[nodiscard]] virtual std::vector<double> getMonoPCMData() const
+  {
+    if (m_pcm_data.empty()) { return downmixToMono(m_samples, m_bit_depth, getDownmixMatrix()); }
+
+    return downmixToMono(m_pcm_data, getDownmixMatrix());
+  }
+  [[nodiscard]] virtual std::vector<float> getMonoPCMDataFloat() const
+  {
+    // Nothing decoded up front, the double path knows where the samples are.
+    if (std::holds_alternative<std::monostate>(m_samples)) {
+      const std::vector<double> mono = getMonoPCMData();
+      std::vector<float> out(mono.size());
+      for (size_t i = 0; i < mono.size(); ++i) { out[i] = static_cast<float>(mono[i]); }
+      return out;
+    }
+
+    return downmixToMonoFloat(m_samples, m_bit_depth, getDownmixMatrix());
+  }
   [[nodiscard]] virtual uint32_t getSampleRate() const = 0;
   [[nodiscard]] virtual uint16_t getNumChannels() const = 0;
   [[nodiscard]] virtual bool isMono() const = 0;
@@ -43,9 +95,25 @@ public:
   [[nodiscard]] virtual int getNumSamplesPerChannel() const = 0;
   [[nodiscard]] virtual double getDurationSeconds() const = 0;
   [[nodiscard]] virtual Metadata getMetadata() const = 0;
+  // Track layout when the file is an album image that carries one.
+  [[nodiscard]] virtual std::optional<CueSheet> getCueSheet() const { return m_cue_sheet; }
+  // Speaker positions of the channels, 0 when the file does not say.
+  [[nodiscard]] virtual uint32_t getChannelMask() const { return m_channel_mask; }
+
+  // Replaces the ITU downmix of the channel layout, ignored when the channel count does not match.
+  void setDownmixMatrix(const DownmixMatrix &matrix) { m_downmix_matrix = matrix; }
+  [[nodiscard]] DownmixMatrix getDownmixMatrix() const
+  {
+    if (m_downmix_matrix && m_downmix_matrix->getNumChannels() == m_num_channels) { return *m_downmix_matrix; }
+
+    return makeDownmixMatrix(m_num_channels, m_channel_mask);
+  }
 
 protected:
   std::string m_file_path;
+  // Only one of these two holds the samples: m_samples right after decoding and
+  // m_pcm_data once a processing step has replaced them through setPCMData().
+  PCMBuffer m_samples;
   std::vector<double> m_pcm_data;
   uint32_t m_sample_rate{};
   uint16_t m_num_channels{};
@@ -53,6 +121,9 @@ protected:
   uint16_t m_bit_depth{};
   uint16_t m_format_tag{};
   Metadata m_metadata{};
+  std::optional<CueSheet> m_cue_sheet;
+  uint32_t m_channel_mask{};
+  std::optional<DownmixMatrix> m_downmix_matrix;
 };
 
 }// namespace afs
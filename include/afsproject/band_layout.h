@@ -0,0 +1,66 @@
+#ifndef band_layout_h_
+#define band_layout_h_
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace afs {
+
+// Compile-time partition of a spectrum row into bands. `Edges` are the bin boundaries,
+// band b covers [Edges[b], Edges[b + 1]). The per-band loops below are expanded over the
+// band index, so a kernel instantiated for a layout has no runtime band bookkeeping.
+template<size_t... Edges> struct BandLayout
+{
+  static_assert(sizeof...(Edges) >= 2, "A band layout needs at least one band.");
+
+  static constexpr std::array<size_t, sizeof...(Edges)> EDGES{ Edges... };
+  static constexpr size_t NUM_BANDS = sizeof...(Edges) - 1;
+  static constexpr size_t NUM_BINS = EDGES.back();
+
+  static constexpr bool isIncreasing()
+  {
+    for (size_t b = 0; b < NUM_BANDS; ++b) {
+      if (EDGES[b] >= EDGES[b + 1]) { return false; }
+    }
+    return true;
+  }
+
+  static_assert(isIncreasing(), "Band edges have to be strictly increasing.");
+
+  template<size_t Band> static constexpr size_t begin() { return EDGES[Band]; }
+  template<size_t Band> static constexpr size_t end() { return EDGES[Band + 1]; }
+
+  // Calls fn(std::integral_constant<size_t, Band>{}) for every band in order.
+  template<typename Fn> static constexpr void forEachBand(Fn &&fn)
+  {
+    [&]<size_t... B>(std::index_sequence<B...>) {
+      (fn(std::integral_constant<size_t, B>{}), ...);
+    }(std::make_index_sequence<NUM_BANDS>{});
+  }
+
+  // Index of the largest value of `row` inside every band, the first one wins on ties.
+  template<typename Row, typename Proj = std::identity>
+  static std::array<size_t, NUM_BANDS> argmaxPerBand(const Row &row, Proj proj = {})
+  {
+    std::array<size_t, NUM_BANDS> out{};
+
+    forEachBand([&](auto band) {
+      constexpr size_t first = begin<decltype(band)::value>();
+      constexpr size_t last = end<decltype(band)::value>();
+
+      size_t best = first;
+      for (size_t k = first + 1; k < last; ++k) {
+        if (std::invoke(proj, row[best]) < std::invoke(proj, row[k])) { best = k; }
+      }
+      out[decltype(band)::value] = best;
+    });
+
+    return out;
+  }
+};
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef crc_h_
+#define crc_h_
+
+#include <cstdint>
+#include <span>
+
+namespace afs {
+
+// CRC-8 with polynomial x^8 + x^2 + x + 1, as used by FLAC frame headers.
+uint8_t crc8(std::span<const uint8_t>, uint8_t crc = 0);
+// CRC-16 with polynomial x^16 + x^15 + x^2 + 1, as used by FLAC frame footers.
+uint16_t crc16(std::span<const uint8_t>, uint16_t crc = 0);
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef cue_sheet_h_
+#define cue_sheet_h_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace afs {
+
+struct CueTrack
+{
+  uint8_t number{};
+  // INDEX 01, in samples per channel from the start of the stream. The pregap before it
+  // stays with the previous track.
+  uint64_t start_sample{};
+  std::string title;
+  std::string performer;
+  std::string isrc;
+  bool is_audio = true;
+};
+
+// Track layout of a single-file album image, from a FLAC CUESHEET block or a .cue file.
+struct CueSheet
+{
+  std::string title;
+  std::string performer;
+  std::string catalog;
+  std::vector<CueTrack> tracks;
+  // Where the last track ends, 0 when only the end of the stream tells.
+  uint64_t lead_out{};
+};
+
+// Reads a single-file .cue sheet, MSF times are converted at `sample_rate`.
+std::optional<CueSheet> parseCueSheet(std::istream &, uint32_t sample_rate);
+std::optional<CueSheet> loadCueFile(const std::string &file_path, uint32_t sample_rate);
+
+// A track runs up to the start of the next one, the last one to the lead-out.
+uint64_t getTrackEnd(const CueSheet &, size_t track_index, uint64_t total_samples);
+size_t countAudioTracks(const CueSheet &);
+
+}// namespace afs
+
+#endif
@@ -2,10 +2,13 @@
 #define DB_H_
 
 #include "sqlite3.h"
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -55,11 +58,13 @@ public:
     void bindInt(int index, int value);
     void bindDouble(int index, double value);
     void bindLongLong(int index, long long value);
+    void bindBlob(int index, const void *data, size_t size);
     int step();
     int columnInt(int index);
     std::string columText(int index);
     double columnDouble(int index);
     long long columnLongLong(int index);
+    std::vector<uint8_t> columnBlob(int index);
     void reset();
 
   private:
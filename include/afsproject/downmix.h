@@ -0,0 +1,59 @@
+#ifndef downmix_h_
+#define downmix_h_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace afs {
+
+// Speaker positions of WAVEFORMATEXTENSIBLE, FLAC uses the same bits in its
+// WAVEFORMATEXTENSIBLE_CHANNEL_MASK tag. Channels are interleaved in the order of the set bits.
+enum Speaker : uint32_t {
+  SPEAKER_FRONT_LEFT = 0x1,
+  SPEAKER_FRONT_RIGHT = 0x2,
+  SPEAKER_FRONT_CENTER = 0x4,
+  SPEAKER_LOW_FREQUENCY = 0x8,
+  SPEAKER_BACK_LEFT = 0x10,
+  SPEAKER_BACK_RIGHT = 0x20,
+  SPEAKER_FRONT_LEFT_OF_CENTER = 0x40,
+  SPEAKER_FRONT_RIGHT_OF_CENTER = 0x80,
+  SPEAKER_BACK_CENTER = 0x100,
+  SPEAKER_SIDE_LEFT = 0x200,
+  SPEAKER_SIDE_RIGHT = 0x400,
+};
+
+// The layouts up to 8 channels have a dedicated kernel, wider streams fall back to a generic loop.
+constexpr size_t MAX_DOWNMIX_CHANNELS = 8;
+
+// Mixes interleaved channels into mono. The fingerprint pipeline only ever wants one
+// output channel, so the matrix is a single row holding the gain of every input channel.
+struct DownmixMatrix
+{
+  std::vector<double> gains;
+
+  [[nodiscard]] size_t getNumChannels() const { return gains.size(); }
+};
+
+// Layout FLAC and WAVE imply for a channel count when the file carries no mask.
+uint32_t defaultChannelMask(uint16_t num_channels);
+
+// ITU-R BS.775 mono downmix for the speakers in `channel_mask`: centre at unity, front left
+// and right at -3 dB, surrounds at -6 dB and the LFE dropped, scaled so the gains add up to 1.
+// A mask that does not match the channel count is replaced by the default layout, more than
+// MAX_DOWNMIX_CHANNELS channels are averaged.
+DownmixMatrix makeDownmixMatrix(uint16_t num_channels, uint32_t channel_mask = 0);
+
+// Every channel weighted the same.
+DownmixMatrix averageDownmixMatrix(uint16_t num_channels);
+
+// Mixes interleaved samples into `out` in one pass, scaling by `norm_factor` on the way.
+// `out` has to hold samples.size() / channels values. Integer and float input mixed into
+// float output goes through AVX2 kernels when the library is built for it.
+template<typename S, typename T>
+void downmix(std::span<const S> samples, double norm_factor, const DownmixMatrix &matrix, std::span<T> out);
+
+}// namespace afs
+
+#endif
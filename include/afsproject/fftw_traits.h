@@ -0,0 +1,115 @@
+#ifndef fftw_traits_h_
+#define fftw_traits_h_
+
+#include <cstddef>
+#include <fftw3.h>
+#include <mutex>
+
+namespace afs {
+
+// The FFTW planner works on global state, plans are only made and destroyed under this
+// lock so songs can be fingerprinted on several threads. Executing a plan needs no lock.
+inline std::mutex &fftwPlannerMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Maps a sample type onto the matching FFTW library, fftw for double and fftwf for float,
+// so the transforms can be written once as templates.
+template<typename T> struct FFTWTraits;
+
+template<> struct FFTWTraits<double>
+{
+  using Plan = fftw_plan;
+  using Complex = fftw_complex;
+
+  static void *malloc(size_t n) { return fftw_malloc(n); }
+  static void free(void *p) { fftw_free(p); }
+  static Plan planR2C(int n, double *in, Complex *out, unsigned flags)// NOLINT
+  {
+    const std::scoped_lock lock(fftwPlannerMutex());
+    return fftw_plan_dft_r2c_1d(n, in, out, flags);
+  }
+  static Plan planC2R(int n, Complex *in, double *out, unsigned flags)// NOLINT
+  {
+    const std::scoped_lock lock(fftwPlannerMutex());
+    return fftw_plan_dft_c2r_1d(n, in, out, flags);
+  }
+  static void execute(Plan plan) { fftw_execute(plan); }
+  static void executeR2C(Plan plan, double *in, Complex *out) { fftw_execute_dft_r2c(plan, in, out); }
+  static void destroy(Plan plan)
+  {
+    const std::scoped_lock lock(fftwPlannerMutex());
+    fftw_destroy_plan(plan);
+  }
+};
+
+template<> struct FFTWTraits<float>
+{
+  using Plan = fftwf_plan;
+  using Complex = fftwf_complex;
+
+  static void *malloc(size_t n) { return fftwf_malloc(n); }
+  static void free(void *p) { fftwf_free(p); }
+  static Plan planR2C(int n, float *in, Complex *out, unsigned flags)// NOLINT
+  {
+    const std::scoped_lock lock(fftwPlannerMutex());
+    return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+  }
+  static Plan planC2R(int n, Complex *in, float *out, unsigned flags)// NOLINT
+  {
+    const std::scoped_lock lock(fftwPlannerMutex());
+    return fftwf_plan_dft_c2r_1d(n, in, out, flags);
+  }
+  static void execute(Plan plan) { fftwf_execute(plan); }
+  static void executeR2C(Plan plan, float *in, Complex *out) { fftwf_execute_dft_r2c(plan, in, out); }
+  static void destroy(Plan plan)
+  {
+    const std::scoped_lock lock(fftwPlannerMutex());
+    fftwf_destroy_plan(plan);
+  }
+};
+
+// Buffer allocated with the FFTW allocator of T, aligned for its SIMD codelets.
+template<typename T, typename Elem = T> class FFTWBuffer
+{
+public:
+  explicit FFTWBuffer(size_t size)
+    : m_data(static_cast<Elem *>(FFTWTraits<T>::malloc(sizeof(Elem) * size))), m_size(size)
+  {}
+  ~FFTWBuffer() { FFTWTraits<T>::free(m_data); }
+
+  FFTWBuffer(const FFTWBuffer &) = delete;
+  FFTWBuffer &operator=(const FFTWBuffer &) = delete;
+
+  [[nodiscard]] Elem *data() const { return m_data; }
+  [[nodiscard]] size_t size() const { return m_size; }
+
+private:
+  Elem *m_data;
+  size_t m_size;
+};
+
+// Owns a plan and destroys it with the right library.
+template<typename T> class FFTWPlan
+{
+public:
+  explicit FFTWPlan(typename FFTWTraits<T>::Plan plan) : m_plan(plan) {}
+  ~FFTWPlan()
+  {
+    if (m_plan != nullptr) { FFTWTraits<T>::destroy(m_plan); }
+  }
+
+  FFTWPlan(const FFTWPlan &) = delete;
+  FFTWPlan &operator=(const FFTWPlan &) = delete;
+
+  [[nodiscard]] typename FFTWTraits<T>::Plan get() const { return m_plan; }
+
+private:
+  typename FFTWTraits<T>::Plan m_plan;
+};
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef fingerprint_config_h_
+#define fingerprint_config_h_
+
+#include <afsproject/db.h>
+#include <cstdint>
+
+namespace afs {
+
+// How the peaks are picked from the spectrogram.
+//  - BandMax: the strongest bin of each logarithmic band per block, kept when above the
+//    mean of the band maxima.
+//  - LocalMax: 2D local maxima of the spectrogram under a peaks-per-second budget.
+enum class PeakExtractor : uint8_t { BandMax, LocalMax };
+
+// What a song is fingerprinted into.
+//  - Constellation: addresses of peak pairs, one posting row per hash.
+//  - SubFingerprint: one 32-bit word of band energy differences per STFT hop, stored as a
+//    BLOB per song, found through exact-match seeds and verified by bit error rate.
+enum class FingerprintMode : uint8_t { Constellation, SubFingerprint };
+
+// How peaks are paired into hashes. Every peak is an anchor, it is paired with up to
+// `fan_out` of the peaks that follow it, starting `anchor_offset` peaks later and limited
+// to the target zone. An address packs
+//   anchor bin | target bin << freq_bits | time delta << (2 * freq_bits)
+// with every field masked to its width.
+//
+// The catalogue stores the config it was built with, a query has to use the same one.
+struct FingerprintConfig
+{
+  uint32_t fan_out = 5;
+  uint32_t anchor_offset = 3;
+
+  // Target zone, a limit of 0 leaves that side open. An open time limit ends where the
+  // time delta field of the address would wrap, 16.4 s with the default layout.
+  uint32_t min_time_delta_ms = 0;
+  uint32_t max_time_delta_ms = 0;
+  uint32_t max_freq_delta = 0;
+
+  // Bit layout of the 32-bit address.
+  uint8_t freq_bits = 9;
+  uint8_t time_delta_bits = 14;
+
+  // Seconds between two STFT blocks and the unit time deltas are counted in.
+  double time_step = 0.046;
+  uint32_t time_quantum_ms = 1;
+  // Repeats of an address whose anchors are at most this far apart are emitted once.
+  uint32_t dedupe_tolerance_ms = 0;
+
+  // Blocks whose RMS is below this level in dBFS are skipped, -inf turns the gate off.
+  double silence_threshold_db = -60.0;
+
+  FingerprintMode fingerprint_mode = FingerprintMode::Constellation;
+  // SubFingerprint only: samples between two frames at SUB_FINGERPRINT_SAMPLE_RATE, and the share
+  // of differing bits up to which a candidate still counts as a match.
+  uint32_t sub_fingerprint_hop = 128;
+  double max_bit_error_rate = 0.35;
+
+  PeakExtractor peak_extractor = PeakExtractor::BandMax;
+  // LocalMax only: neighbourhood half-widths in blocks and bins, and the density budget.
+  uint32_t peak_time_radius = 3;
+  uint32_t peak_freq_radius = 8;
+  double peaks_per_second = 30.0;
+
+  // Stop hashes: found in more than this share of the songs once there are enough songs.
+  double stop_hash_max_fraction = 0.1;
+  uint32_t stop_hash_min_songs = 50;
+
+  [[nodiscard]] bool isValid() const;
+  // Longest time delta the address can hold.
+  [[nodiscard]] uint32_t timeDeltaRangeMs() const;
+  // Upper end of the target zone in time, the pairing stops looking past it.
+  [[nodiscard]] uint32_t maxTimeDeltaMs() const;
+  [[nodiscard]] bool inTargetZone(uint32_t time_delta_ms, uint32_t freq_anchor, uint32_t freq_point) const;
+  [[nodiscard]] uint32_t makeAddress(uint32_t freq_anchor, uint32_t freq_point, uint32_t time_delta_ms) const;
+};
+
+// Reads the config of the catalogue, the defaults when the database has none.
+FingerprintConfig loadFingerprintConfig(SQLiteDB &db);
+// Whether the catalogue has a config row at all, valid or not.
+bool hasFingerprintConfig(SQLiteDB &db);
+// Replaces the config of the catalogue. Existing fingerprints are not rebuilt.
+bool storeFingerprintConfig(SQLiteDB &db, const FingerprintConfig &config);
+
+}// namespace afs
+
+#endif
@@ -2,47 +2,13 @@
 #define flac_file_h_
 
 #include <afsproject/audio_file.h>
-#include <afsproject/md5.h>
-#include <array>
+#include <afsproject/flac_stream_decoder.h>
 #include <cstdint>
-#include <etl/bit_stream.h>
-#include <optional>
+#include <string>
 #include <vector>
 
 namespace afs {
 
-const int THIRTY_TWO = 32;
-
-using Subframes = std::vector<std::vector<int32_t>>;
-
-struct StreamInfo
-{
-  uint16_t min_block_size;
-  uint16_t max_block_size;
-  uint32_t min_frame_size;
-  uint32_t max_frame_size;
-  uint32_t sample_rate;
-  uint8_t num_channels;
-  uint8_t bit_depth;
-  uint64_t total_samples;
-};
-
-struct FrameHeader
-{
-  uint16_t frame_sync_code;
-  int strategy_bit;
-  int block_size_bits;
-  uint32_t block_size;
-  int sample_rate_bits;
-  uint32_t sample_rate;
-  int channel_bits;
-  uint16_t num_channels;
-  int bit_depth_bits;
-  uint16_t bit_depth;
-  uint64_t coded_number;
-  int crc8;
-};
-
 class FlacFile : public IAudioFile// NOLINT
 {
 public:
@@ -50,6 +16,9 @@ public:
   ~FlacFile() override = default;
 
   bool load(const std::string &file_path) override;
+  // Loads `count` samples per channel starting at `start_sample`, only the frames that
+  // cover them are decoded. Fewer samples are loaded when the stream ends first.
+  bool decodeRange(const std::string &file_path, uint64_t start_sample, uint64_t count);
   [[nodiscard]] bool save(const std::string &file_path) const override;
   [[nodiscard]] std::vector<double> getPCMData() const override;
   [[nodiscard]] uint32_t getSampleRate() const override;
@@ -61,63 +30,21 @@ public:
   [[nodiscard]] int getNumSamplesPerChannel() const override;
   [[nodiscard]] Metadata getMetadata() const override;
 
-private:
-  std::vector<uint8_t> m_file_data;
-  uint64_t m_total_samples{};
-  uint32_t m_channel_mask{};
-  uint32_t m_bits_read{};
-  std::array<uint8_t, 16> m_md5_checksum;
-  bool m_has_md5_signature = false;
-  std::unique_ptr<MD5> m_md5;
-  // NOTE: could store `etl::bit_stream_reader` as a member variable.
-
-  bool decodeStreaminfo(etl::bit_stream_reader &, uint32_t, uint8_t);
-  bool decodePadding(etl::bit_stream_reader &, uint32_t);
-  bool decodeApplication(etl::bit_stream_reader &, uint32_t);
-  bool decodeSeektable(etl::bit_stream_reader &, uint32_t);
-  bool decodeVorbiscomment(etl::bit_stream_reader &, uint32_t);
-  bool decodeCuesheet(etl::bit_stream_reader &, uint32_t);
-  bool decodePicture(etl::bit_stream_reader &, uint32_t);
-
-  bool decodeFrames(etl::bit_stream_reader &);
-  bool decodeFrame(etl::bit_stream_reader &);
-  bool seekToNextFrame(etl::bit_stream_reader &);
-
-  std::optional<FrameHeader> decodeFrameHeader(etl::bit_stream_reader &);
-
-  std::optional<Subframes> decodeSubframes(etl::bit_stream_reader &, FrameHeader &);
-  bool decodeSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t);
-  bool decodeSubframeHeader(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t);
-  bool decodeConstantSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint16_t, uint8_t);
-  bool decodeVerbatimSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t, uint8_t);
-  bool decodeFixedSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t, uint8_t, uint8_t);
-  bool decodeLPCSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t, uint8_t, uint8_t);
-  bool decodeResidual(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint8_t);
+  void setVerifyMode(VerifyMode);
 
-  bool decodeFrameFooter(etl::bit_stream_reader &);
+  // Reads STREAMINFO and the tags only, no frame is decoded.
+  static bool scan(const std::string &file_path, AudioInfo &);
 
-  bool decodeFlacFile();
+private:
+  uint64_t m_total_samples{};
+  VerifyMode m_verify_mode = VerifyMode::Frames;
 
   static bool encodeFlacFile();
 
-  std::optional<uint64_t> readUTF8(etl::bit_stream_reader &);
-  int32_t readSignedValue(etl::bit_stream_reader &, uint16_t);
-  int32_t readRiceSignedValue(etl::bit_stream_reader &, uint32_t);
-  static bool decorrelateChannels(std::vector<std::vector<int32_t>> &, int);
-  bool isSyncCode(etl::bit_stream_reader &) const;
-  void storeSamples(const std::vector<std::vector<int32_t>> &);
-  bool validateMD5Checksum();
+  bool readStream(FlacStreamDecoder &, const std::string &, uint64_t max_frames);
+  template<typename T> std::vector<T> readSamples(FlacStreamDecoder &, uint64_t max_frames) const;
 };
 
-std::string determinePictureTypeStr(uint32_t);
-uint32_t determineBlockSize(int);
-uint32_t determineSampleRate(int);
-uint16_t determineChannels(int);
-uint16_t determineBitDepth(int);
-std::string determineSubframeType(int);
-
-int utf8SequenceLength(uint8_t);
-
 }// namespace afs
 
 #endif
@@ -0,0 +1,85 @@
+#ifndef flac_metadata_h_
+#define flac_metadata_h_
+
+#include <afsproject/mapped_file.h>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+enum class MetadataBlockType : uint8_t {
+  StreamInfo = 0,
+  Padding = 1,
+  Application = 2,
+  SeekTable = 3,
+  VorbisComment = 4,
+  CueSheet = 5,
+  Picture = 6,
+  Forbidden = 127
+};
+
+// Where a metadata block sits in the file, `offset` points past its 4 byte header.
+struct MetadataBlockInfo
+{
+  MetadataBlockType type;
+  uint64_t offset;
+  uint32_t size;
+};
+
+struct VorbisComment
+{
+  std::string_view vendor;
+  // TAG=value pairs in file order, the tag keeps its original case.
+  std::vector<std::pair<std::string_view, std::string_view>> fields;
+};
+
+struct FlacPicture
+{
+  uint32_t picture_type;
+  std::string_view mime_type;
+  std::string_view description;
+  uint32_t width;
+  uint32_t height;
+  uint32_t color_depth;
+  uint32_t num_colors;
+  std::span<const uint8_t> data;
+};
+
+// Both parse a block body in place, the views point into `block`.
+std::optional<VorbisComment> parseVorbisComment(std::span<const uint8_t> block);
+std::optional<FlacPicture> parsePicture(std::span<const uint8_t> block);
+
+// Maps a FLAC file and indexes its metadata blocks by offset and size without reading
+// any of them. A block is only parsed when asked for, so a file with 10 MB of cover art
+// costs the same to open as one without.
+class FlacMetadataIndex// NOLINT
+{
+public:
+  FlacMetadataIndex() = default;
+  ~FlacMetadataIndex() = default;
+
+  bool open(const std::string &file_path);
+
+  [[nodiscard]] const std::vector<MetadataBlockInfo> &getBlocks() const;
+  // Offset of the first frame header, right after the last metadata block.
+  [[nodiscard]] uint64_t getFirstFrameOffset() const;
+  // The body of a block, valid for as long as the index is open.
+  [[nodiscard]] std::span<const uint8_t> getBlockData(const MetadataBlockInfo &) const;
+  [[nodiscard]] std::optional<VorbisComment> getVorbisComment() const;
+  [[nodiscard]] std::vector<FlacPicture> getPictures() const;
+
+private:
+  MappedFile m_mapped_file;
+  std::vector<MetadataBlockInfo> m_blocks;
+  uint64_t m_first_frame_offset{};
+};
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef flac_predictor_h_
+#define flac_predictor_h_
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace afs {
+
+constexpr int MAX_FIXED_ORDER = 4;
+constexpr int MAX_LPC_ORDER = 32;
+
+// The restoration kernels below work in place: `samples` holds the warm-up samples
+// followed by the residual, and every residual is turned into its sample by adding
+// the prediction made from the samples already restored before it.
+
+template<typename Accumulator, size_t Order> void restoreFixedSignal(std::span<int32_t> samples)
+{
+  int32_t *data = samples.data();
+
+  for (size_t i = Order; i < samples.size(); ++i) {
+    Accumulator prediction = 0;
+
+    if constexpr (Order == 1) {
+      prediction = Accumulator(data[i - 1]);
+    } else if constexpr (Order == 2) {
+      prediction = (2 * Accumulator(data[i - 1])) - data[i - 2];
+    } else if constexpr (Order == 3) {
+      prediction = (3 * Accumulator(data[i - 1])) - (3 * Accumulator(data[i - 2])) + data[i - 3];
+    } else if constexpr (Order == 4) {
+      prediction = (4 * Accumulator(data[i - 1])) - (6 * Accumulator(data[i - 2])) + (4 * Accumulator(data[i - 3]))
+                   - data[i - 4];
+    }
+
+    data[i] += static_cast<int32_t>(prediction);
+  }
+}
+
+template<typename Accumulator, size_t Order>
+void restoreLPCSignal(std::span<int32_t> samples, const int32_t *coefficients, int shift)
+{
+  int32_t *data = samples.data();
+
+  std::array<Accumulator, Order> coefs{};
+  for (size_t j = 0; j < Order; ++j) { coefs[j] = coefficients[j]; }// NOLINT
+
+  for (size_t i = Order; i < samples.size(); ++i) {
+    // Fully unrolled dot product over the previous `Order` samples.
+    const Accumulator prediction = [&]<size_t... J>(std::index_sequence<J...>) {
+      return (Accumulator{ 0 } + ... + (coefs[J] * Accumulator(data[i - J - 1])));
+    }(std::make_index_sequence<Order>{});
+
+    data[i] += static_cast<int32_t>(prediction >> shift);
+  }
+}
+
+using FixedKernel = void (*)(std::span<int32_t>);
+using LPCKernel = void (*)(std::span<int32_t>, const int32_t *, int);
+
+template<typename Accumulator, size_t... Orders>
+constexpr std::array<FixedKernel, sizeof...(Orders)> makeFixedKernels(std::index_sequence<Orders...>)
+{
+  return { &restoreFixedSignal<Accumulator, Orders + 1>... };
+}
+
+template<typename Accumulator, size_t... Orders>
+constexpr std::array<LPCKernel, sizeof...(Orders)> makeLPCKernels(std::index_sequence<Orders...>)
+{
+  return { &restoreLPCSignal<Accumulator, Orders + 1>... };
+}
+
+// Indexed by `order - 1`.
+inline constexpr auto FIXED_KERNELS_32 = makeFixedKernels<int32_t>(std::make_index_sequence<MAX_FIXED_ORDER>{});
+inline constexpr auto FIXED_KERNELS_64 = makeFixedKernels<int64_t>(std::make_index_sequence<MAX_FIXED_ORDER>{});
+inline constexpr auto LPC_KERNELS_32 = makeLPCKernels<int32_t>(std::make_index_sequence<MAX_LPC_ORDER>{});
+inline constexpr auto LPC_KERNELS_64 = makeLPCKernels<int64_t>(std::make_index_sequence<MAX_LPC_ORDER>{});
+
+// The fixed predictor coefficients sum up to at most 2^order in magnitude.
+inline void restoreFixed(std::span<int32_t> samples, uint16_t bit_depth, uint8_t order)
+{
+  if (order == 0) { return; }
+
+  if (bit_depth + order <= 32) {
+    FIXED_KERNELS_32.at(order - 1U)(samples);
+  } else {
+    FIXED_KERNELS_64.at(order - 1U)(samples);
+  }
+}
+
+// Same bound libFLAC uses to decide when a 32-bit accumulator cannot overflow.
+inline void
+  restoreLPC(std::span<int32_t> samples, const int32_t *coefficients, int shift, uint16_t bit_depth, int precision, uint8_t order)
+{
+  if (unsigned(bit_depth) + unsigned(precision) + std::bit_width(unsigned(order)) <= 32U) {
+    LPC_KERNELS_32.at(order - 1U)(samples, coefficients, shift);
+  } else {
+    LPC_KERNELS_64.at(order - 1U)(samples, coefficients, shift);
+  }
+}
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef flac_stream_decoder_h_
+#define flac_stream_decoder_h_
+
+#include <afsproject/audio_file.h>
+#include <afsproject/cue_sheet.h>
+#include <afsproject/flac_metadata.h>
+#include <afsproject/md5.h>
+#include <afsproject/md5_worker.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <etl/bit_stream.h>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+const int THIRTY_TWO = 32;
+
+using Subframes = std::vector<std::vector<int32_t>>;
+
+struct StreamInfo
+{
+  uint16_t min_block_size;
+  uint16_t max_block_size;
+  uint32_t min_frame_size;
+  uint32_t max_frame_size;
+  uint32_t sample_rate;
+  uint8_t num_channels;
+  uint8_t bit_depth;
+  uint64_t total_samples;
+};
+
+struct FrameHeader
+{
+  uint16_t frame_sync_code;
+  int strategy_bit;
+  int block_size_bits;
+  uint32_t block_size;
+  int sample_rate_bits;
+  uint32_t sample_rate;
+  int channel_bits;
+  uint16_t num_channels;
+  int bit_depth_bits;
+  uint16_t bit_depth;
+  uint64_t coded_number;
+  int crc8;
+};
+
+struct SeekPoint
+{
+  uint64_t sample_number;
+  // Byte offset of the frame holding `sample_number`, counted from the first frame header.
+  uint64_t offset;
+  uint16_t num_samples;
+};
+
+// How much integrity checking the decoder does while decoding.
+//  - Off: trust the stream.
+//  - Frames: check the CRC-8 of every frame header and the CRC-16 of every frame.
+//  - Full: frames plus the MD5 of the whole decoded stream, computed on a worker thread.
+enum class VerifyMode : uint8_t { Off, Frames, Full };
+
+// Pull-based FLAC decoder. The file is read in chunks that are only ever big enough
+// to hold a couple of frames, so memory stays at O(max_block_size * channels) no matter
+// how long the stream is.
+class FlacStreamDecoder// NOLINT
+{
+public:
+  FlacStreamDecoder() = default;
+  ~FlacStreamDecoder() = default;
+
+  // Has to be called before open() for the MD5 check to be set up.
+  void setVerifyMode(VerifyMode);
+
+  // Opens the file and indexes every metadata block, leaving the reader on the first frame.
+  // Only STREAMINFO, SEEKTABLE, VORBIS_COMMENT and CUESHEET are read, padding, application
+  // data and pictures are seeked over, FlacMetadataIndex hands them out on request.
+  bool open(const std::string &file_path);
+  // Like open() but only STREAMINFO and VORBIS_COMMENT are decoded, every other block is
+  // seeked over and no frame can be read afterwards.
+  bool scan(const std::string &file_path);
+
+  // Fills `out` with interleaved samples and returns how many samples per channel were written.
+  // Only whole inter-channel samples are written, a return value of 0 means the stream is done.
+  size_t readFrames(std::span<int32_t> out);
+
+  // Positions the decoder so that the next readFrames() starts at `sample`. The SEEKTABLE
+  // narrows the search down when there is one, frame headers are bisected from there and
+  // only the frames around `sample` are decoded. The stream is no longer read as a whole
+  // afterwards, so the MD5 check is dropped.
+  bool seek(uint64_t sample);
+
+  [[nodiscard]] const StreamInfo &getStreamInfo() const;
+  [[nodiscard]] Metadata getMetadata() const;
+  [[nodiscard]] uint32_t getChannelMask() const;
+  [[nodiscard]] const std::vector<SeekPoint> &getSeekPoints() const;
+  [[nodiscard]] const std::vector<MetadataBlockInfo> &getMetadataBlocks() const;
+  [[nodiscard]] const std::optional<CueSheet> &getCueSheet() const;
+  [[nodiscard]] uint64_t getFramesDecoded() const;
+  [[nodiscard]] bool isEndOfStream() const;
+  [[nodiscard]] bool failed() const;
+
+private:
+  static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+  static constexpr size_t MAX_FRAME_HEADER_SIZE = 16;
+  static constexpr size_t FRAME_FOOTER_SIZE = 2;
+
+  std::ifstream m_file;
+  std::vector<uint8_t> m_buffer;
+  size_t m_buffer_begin{};
+  size_t m_buffer_end{};
+  size_t m_frame_bound{};
+  bool m_end_of_file = false;
+  bool m_end_of_stream = false;
+  bool m_failed = false;
+  bool m_headers_only = false;
+  VerifyMode m_verify_mode = VerifyMode::Frames;
+
+  StreamInfo m_stream_info{};
+  Metadata m_metadata{};
+  uint32_t m_channel_mask{};
+  uint32_t m_bits_read{};
+  uint64_t m_frames_decoded{};
+  std::array<uint8_t, 16> m_md5_checksum{};
+  bool m_has_md5_signature = false;
+  std::unique_ptr<MD5Worker> m_md5_worker;
+  std::vector<SeekPoint> m_seek_points;
+  std::vector<MetadataBlockInfo> m_metadata_blocks;
+  std::optional<CueSheet> m_cue_sheet;
+  uint64_t m_first_frame_offset{};
+
+  // Interleaved samples of the last decoded frame and how many of them were handed out.
+  std::vector<int32_t> m_block;
+  size_t m_block_frames{};
+  size_t m_block_pos{};
+  uint64_t m_block_first_sample{};
+
+  // Per-channel scratch the subframes are decoded into, kept across frames.
+  Subframes m_subframes;
+
+  bool decodeMetadata();
+  bool decodeStreaminfo(etl::bit_stream_reader &, uint32_t, uint8_t);
+  bool decodeSeektable(etl::bit_stream_reader &, uint32_t);
+  bool decodeVorbiscomment(std::span<const uint8_t>);
+  bool decodeCuesheet(etl::bit_stream_reader &, uint32_t);
+
+  bool fillBuffer();
+  bool decodeNextFrame();
+  bool decodeFrame(etl::bit_stream_reader &);
+  bool seekToOffset(uint64_t);
+  std::optional<std::pair<uint64_t, uint64_t>> findFrameAfter(uint64_t);
+  [[nodiscard]] std::optional<uint64_t> parseFrameStart(std::span<const uint8_t>) const;
+  [[nodiscard]] uint64_t firstSampleOf(int strategy_bit, uint64_t coded_number) const;
+
+  std::optional<FrameHeader> decodeFrameHeader(etl::bit_stream_reader &);
+
+  bool decodeSubframes(etl::bit_stream_reader &, const FrameHeader &);
+  bool decodeSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t);
+  bool decodeConstantSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint16_t);
+  bool decodeVerbatimSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t);
+  bool decodeFixedSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t, uint8_t);
+  bool decodeLPCSubframe(etl::bit_stream_reader &, std::vector<int32_t> &, uint32_t, uint16_t, uint8_t);
+  bool decodeResidual(etl::bit_stream_reader &, std::span<int32_t>, uint32_t, uint8_t);
+
+  bool decodeFrameFooter(etl::bit_stream_reader &);
+
+  std::optional<uint64_t> readUTF8(etl::bit_stream_reader &);
+  int32_t readSignedValue(etl::bit_stream_reader &, uint16_t);
+  int32_t readRiceSignedValue(etl::bit_stream_reader &, uint32_t);
+  static bool decorrelateChannels(std::vector<std::vector<int32_t>> &, int);
+  void storeBlock(const std::vector<std::vector<int32_t>> &);
+  [[nodiscard]] size_t computeFrameBound() const;
+  [[nodiscard]] std::span<const uint8_t> frameBytes(size_t) const;
+  bool validateMD5Checksum();
+};
+
+std::string determinePictureTypeStr(uint32_t);
+uint32_t determineBlockSize(int);
+uint32_t determineSampleRate(int);
+uint16_t determineChannels(int);
+uint16_t determineBitDepth(int);
+std::string determineSubframeType(int);
+
+int utf8SequenceLength(uint8_t);
+
+}// namespace afs
+
+#endif
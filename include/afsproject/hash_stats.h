@@ -0,0 +1,41 @@
+#ifndef hash_stats_h_
+#define hash_stats_h_
+
+#include <afsproject/db.h>
+#include <afsproject/fingerprint_config.h>
+#include <cstdint>
+
+namespace afs {
+
+// Document frequency of every hash, the number of songs it occurs in, kept in the
+// hash_stats table next to the postings. Hashes that occur in too large a share of the
+// catalogue are stop hashes, they match nearly everything and only cost postings scans.
+// Their postings are stored all the same and skipped when a query is matched, as the
+// share changes with every song added.
+// The others are weighted by their inverse document frequency when votes are counted.
+class HashStats// NOLINT
+{
+public:
+  HashStats(SQLiteDB &db, const FingerprintConfig &config);
+
+  [[nodiscard]] long long getNumSongs() const;
+  // 0 when the hash was never counted, e.g. in a catalogue built before the stats existed.
+  uint32_t documentFrequency(uint32_t hash);
+  // Counts one more song for `hash`.
+  void addSong(uint32_t hash);
+
+  // The cap only applies once the catalogue is big enough for the share to mean something.
+  [[nodiscard]] bool isStopHash(uint32_t document_frequency) const;
+  [[nodiscard]] double weight(uint32_t document_frequency) const;
+
+private:
+  long long m_num_songs{};
+  double m_max_fraction;
+  uint32_t m_min_songs;
+  SQLiteDB::Statement m_select;
+  SQLiteDB::Statement m_upsert;
+};
+
+}// namespace afs
+
+#endif
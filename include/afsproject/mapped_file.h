@@ -0,0 +1,39 @@
+#ifndef mapped_file_h_
+#define mapped_file_h_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace afs {
+
+// Read-only memory mapping of a whole file, through mmap or MapViewOfFile on Windows. Pages
+// are shared through the OS page cache, so several workers mapping the same file do not
+// each hold a copy of it.
+class MappedFile// NOLINT
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) noexcept;
+  MappedFile &operator=(MappedFile &&) noexcept;
+
+  bool open(const std::string &);
+  void close();
+
+  [[nodiscard]] std::span<const uint8_t> data() const;
+  [[nodiscard]] size_t size() const;
+  [[nodiscard]] bool isOpen() const;
+
+private:
+  const uint8_t *m_data = nullptr;
+  size_t m_size{};
+};
+
+}// namespace afs
+
+#endif
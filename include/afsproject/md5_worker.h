@@ -0,0 +1,50 @@
+#ifndef md5_worker_h_
+#define md5_worker_h_
+
+#include <afsproject/md5.h>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace afs {
+
+// Computes the MD5 of decoded PCM on its own thread. Blocks are serialized the way
+// FLAC signs them: interleaved, little-endian, (bit_depth + 7) / 8 bytes per sample.
+class MD5Worker// NOLINT
+{
+public:
+  explicit MD5Worker(uint16_t bit_depth);
+  ~MD5Worker();
+
+  // Queues a copy of the samples, blocks only when the worker is falling behind.
+  void push(std::span<const int32_t>);
+  // Waits for every queued block to be hashed and returns the digest, call it once.
+  std::array<uint8_t, 16> finish();
+
+private:
+  static constexpr size_t MAX_PENDING_BLOCKS = 8;
+
+  size_t m_bytes_per_sample;
+  MD5 m_md5;
+  std::vector<uint8_t> m_bytes;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::vector<int32_t>> m_pending;
+  std::vector<std::vector<int32_t>> m_free;
+  bool m_done = false;
+  std::thread m_thread;
+
+  void run();
+  void hashBlock(const std::vector<int32_t> &);
+};
+
+}// namespace afs
+
+#endif
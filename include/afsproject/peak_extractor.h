@@ -0,0 +1,29 @@
+#ifndef peak_extractor_h_
+#define peak_extractor_h_
+
+#include <afsproject/afs.h>
+#include <afsproject/fingerprint_config.h>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace afs {
+
+// Maximum over every window of `2 * radius + 1` elements centered on each of the `n`
+// elements of `in`, read and written with `stride`. Uses the van Herk/Gil-Werman scheme:
+// prefix and suffix maxima over blocks of the window length give each output from two
+// lookups, so the cost does not grow with the radius. The input is fully read before
+// anything is written, `in` and `out` may be the same. `scratch` is resized as needed.
+template<typename T>
+void slidingMax(const T *in, T *out, size_t n, size_t stride, size_t radius, std::vector<T> &scratch);
+
+// Peaks of a power spectrogram (`num_blocks` rows of `num_bins` bins) that are the maximum
+// of their (2 * time radius + 1) x (2 * freq radius + 1) neighbourhood. The threshold
+// adapts per second of signal so that at most `peaks_per_second` of them are kept there,
+// loud passages do not flood the index and quiet ones still get their share.
+template<typename T>
+Matrix extractLocalMaxima(std::span<const T> power, size_t num_blocks, size_t num_bins, const FingerprintConfig &config);
+
+}// namespace afs
+
+#endif
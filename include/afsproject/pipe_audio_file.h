@@ -0,0 +1,76 @@
+#ifndef pipe_audio_file_h_
+#define pipe_audio_file_h_
+
+#include <afsproject/audio_file.h>
+#include <afsproject/wave_file.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace afs {
+
+// Layout of headerless interleaved PCM, samples are little endian.
+struct RawPCMFormat
+{
+  uint32_t sample_rate = 44100;
+  uint16_t num_channels = 2;
+  WaveFormat format = WaveFormat::PCM;
+  uint16_t bit_depth = 16;
+};
+
+// Sample formats by their ffmpeg name: u8, s16le, s24le, s32le, f32le and f64le.
+std::optional<RawPCMFormat> makeRawPCMFormat(const std::string &name, uint32_t sample_rate, uint16_t num_channels);
+
+// Audio read in one forward pass from stdin or a pipe, so a transcoder can feed the
+// fingerprinting without a temporary file. A stream starting with a RIFF/WAVE header is
+// read as WAV, a data chunk size of 0 or 0xFFFFFFFF (unknown length) runs to the end of
+// the stream. Anything else is raw PCM in the declared format.
+class PipeAudioFile : public IAudioFile// NOLINT
+{
+public:
+  explicit PipeAudioFile(const RawPCMFormat & = {});
+  ~PipeAudioFile() override = default;
+
+  // Takes whole frames as they are decoded.
+  using PCMSink = std::function<void(PCMBuffer &&)>;
+
+  // "-" reads stdin, anything else is opened as a file, e.g. a named pipe.
+  bool load(const std::string &source) override;
+  bool load(std::istream &);
+  // Same parsing as load, but every chunk goes to `sink` and none is kept, so a stream of
+  // any length is read in constant memory. The format is known from the first chunk on.
+  bool stream(const std::string &source, const PCMSink &sink);
+  bool stream(std::istream &, const PCMSink &sink);
+  [[nodiscard]] bool save(const std::string &file_path) const override;
+  [[nodiscard]] std::vector<double> getPCMData() const override;
+  [[nodiscard]] uint32_t getSampleRate() const override;
+  [[nodiscard]] uint16_t getNumChannels() const override;
+  [[nodiscard]] double getDurationSeconds() const override;
+  [[nodiscard]] bool isMono() const override;
+  [[nodiscard]] bool isStereo() const override;
+  [[nodiscard]] uint16_t getBitDepth() const override;
+  [[nodiscard]] int getNumSamplesPerChannel() const override;
+  [[nodiscard]] Metadata getMetadata() const override;
+
+private:
+  static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+  static constexpr uint32_t UNKNOWN_DATA_SIZE = 0xFFFFFFFF;
+
+  RawPCMFormat m_raw_format;
+
+  static std::optional<RawPCMFormat> readWaveHeader(std::istream &, uint64_t &data_size);
+  bool readSamples(std::istream &,
+    const RawPCMFormat &,
+    std::span<const uint8_t> prefix,
+    uint64_t data_size,
+    const PCMSink &sink);
+};
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef spectral_kernels_h_
+#define spectral_kernels_h_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace afs {
+
+// Kernels over FFT output. `bins` points at `n` interleaved (re, im) pairs, the layout of
+// fftw_complex, fftwf_complex and std::complex, so they read the FFTW buffer directly.
+// The loops are plain element-wise arithmetic the compiler turns into SIMD code.
+
+// |X|^2. Orders the bins the same way |X| does, without the hypot() of std::abs.
+template<typename T> void powerSpectrum(const T *bins, T *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    const T re = bins[2 * i];// NOLINT
+    const T im = bins[(2 * i) + 1];// NOLINT
+    out[i] = (re * re) + (im * im);// NOLINT
+  }
+}
+
+// |X| as sqrt(|X|^2). Unlike std::abs there is no overflow guard, FFT output of samples
+// in [-1, 1] is nowhere near the range where that matters.
+template<typename T> void magnitudeSpectrum(const T *bins, T *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    const T re = bins[2 * i];// NOLINT
+    const T im = bins[(2 * i) + 1];// NOLINT
+    out[i] = std::sqrt((re * re) + (im * im));// NOLINT
+  }
+}
+
+// 10 * log10(|X|^2) in dB, with the power clamped to `floor` so silent bins stay finite.
+template<typename T> void logPowerSpectrum(const T *bins, T *out, size_t n, T floor = T(1e-12))
+{
+  powerSpectrum(bins, out, n);
+  for (size_t i = 0; i < n; ++i) { out[i] = T(10) * std::log10(std::max(out[i], floor)); }// NOLINT
+}
+
+}// namespace afs
+
+#endif
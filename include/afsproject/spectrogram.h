@@ -3,27 +3,56 @@
 
 #include <afsproject/spectrum.h>
 #include <afsproject/wave.h>
-#include <NumCpp/NdArray/NdArrayCore.hpp>
-#include <map>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <vector>
 
 namespace afs {
 
+// Whether a spectrogram keeps the complex spectra or only a real value per bin: |X|, |X|^2
+// or 10 * log10(|X|^2). The real kinds take half the memory but cannot be turned back into
+// a wave.
+enum class SpectrogramKind : uint8_t { Complex, Magnitude, Power, LogPower };
+
+// All segment spectra live in one row-major buffer, one row of `numFrequencies()` bins
+// per segment, with the time and frequency axes shared by every row.
 class Spectrogram
 {
 private:
-  std::map<double, Spectrum> m_spec_map;
+  std::vector<std::complex<double>> m_hs;
+  std::vector<double> m_amps;
+  std::vector<double> m_times;
+  std::vector<double> m_frequencies;
   int m_seg_length;
+  int m_framerate;
+  SpectrogramKind m_kind;
 
 public:
-  Spectrogram(std::map<double, Spectrum> spec_map, int seg_length);
+  Spectrogram(std::vector<std::complex<double>> hs,// NOLINT
+    std::vector<double> amps,
+    std::vector<double> times,
+    std::vector<double> frequencies,
+    int seg_length,
+    int framerate,
+    SpectrogramKind kind = SpectrogramKind::Complex);
+
+  [[nodiscard]] SpectrogramKind kind() const;
+  [[nodiscard]] size_t numTimes() const;
+  [[nodiscard]] size_t numFrequencies() const;
 
-  [[nodiscard]] const Spectrum &anySpectrum() const;
+  [[nodiscard]] Spectrum anySpectrum() const;
+  [[nodiscard]] Spectrum spectrum(size_t time_idx) const;
   [[nodiscard]] double timeRes() const;
   [[nodiscard]] double freqRes() const;
-  [[nodiscard]] std::vector<double> times() const;
-  [[nodiscard]] nc::NdArray<double> frequencies() const;
+  [[nodiscard]] std::span<const double> times() const;
+  [[nodiscard]] std::span<const double> frequencies() const;
+  // Complex bins of one segment, empty for a magnitude spectrogram.
+  [[nodiscard]] std::span<const std::complex<double>> segment(size_t time_idx) const;
+  // Value of one bin in the spectrogram's scale, |X| for a complex spectrogram.
+  [[nodiscard]] double amp(size_t time_idx, size_t freq_idx) const;
   void plot(std::optional<double> high = std::nullopt) const;
   void getData(std::optional<double> high = std::nullopt) const;
   [[nodiscard]] Wave makeWave() const;
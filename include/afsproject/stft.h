@@ -0,0 +1,55 @@
+#ifndef stft_h_
+#define stft_h_
+
+#include <afsproject/spectrogram.h>
+#include <afsproject/window_table.h>
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+struct fftw_plan_s;
+
+namespace afs {
+
+// Short-time Fourier transform over a whole signal. Segments are windowed into a scratch
+// buffer a batch at a time and transformed with one FFTW plan that is reused for every
+// batch, the spectra land directly in the spectrogram's contiguous buffer.
+class STFT// NOLINT
+{
+public:
+  STFT(int seg_length, int hop, WindowKind window = WindowKind::Hamming);
+  ~STFT();
+
+  STFT(const STFT &) = delete;
+  STFT &operator=(const STFT &) = delete;
+
+  // `start_time` is the time of the first sample, it offsets the segment midpoints.
+  [[nodiscard]] Spectrogram compute(std::span<const double> ys,
+    int framerate,
+    double start_time = 0.0,
+    SpectrogramKind kind = SpectrogramKind::Complex);
+
+  // Number of segments compute() produces for a signal of `num_samples`.
+  [[nodiscard]] size_t numSegments(size_t num_samples) const;
+
+private:
+  static constexpr size_t BATCH_SIZE = 64;
+
+  int m_seg_length;
+  int m_hop;
+  size_t m_num_bins;
+  std::vector<double> m_window;
+
+  double *m_in = nullptr;
+  std::complex<double> *m_out = nullptr;
+  fftw_plan_s *m_plan = nullptr;
+  fftw_plan_s *m_tail_plan = nullptr;
+  size_t m_tail_size{};
+
+  fftw_plan_s *planFor(size_t batch);
+};
+
+}// namespace afs
+
+#endif
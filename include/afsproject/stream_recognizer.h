@@ -0,0 +1,103 @@
+#ifndef stream_recognizer_h_
+#define stream_recognizer_h_
+
+#include <afsproject/afs.h>
+#include <afsproject/db.h>
+#include <afsproject/downmix.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/hash_stats.h>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace afs {
+
+// A stretch of the stream attributed to one song.
+struct StreamSegment
+{
+  double start_seconds;
+  double end_seconds;
+  int64_t song_id;
+  // Best share of all the current votes its alignment held while the segment was open.
+  double confidence;
+};
+
+// How the stream is cut into windows and when a match opens or closes a segment.
+struct StreamSettings
+{
+  // Every hop the last `window_seconds` are fingerprinted. Only the hashes anchored in
+  // the middle `hop_seconds` of the window are used, the rest is context for the filter
+  // and the pairing, so consecutive windows cover the stream exactly once.
+  double window_seconds = 4.0;
+  double hop_seconds = 2.0;
+  // Votes lose 1/e of their weight every `decay_seconds`, old alignments fade out.
+  double decay_seconds = 6.0;
+  // Time deltas are counted in buckets this wide, the block rounding of the window and of
+  // the catalogue do not line up.
+  uint32_t delta_bucket_ms = 100;
+  // Hysteresis: a segment opens once one window gives an alignment `enter_score` worth of
+  // votes. It stays open while the decayed votes of its song stay above `exit_score`,
+  // unless a window gives another song more than `enter_score` and more than it, and it
+  // only grows over windows that give it at least `exit_score`.
+  double enter_score = 20.0;
+  double exit_score = 8.0;
+};
+
+// Recognizes songs in a stream of any length. Samples are pushed as they arrive, a window
+// is matched against the catalogue every hop and its votes are added to histograms that
+// decay over time. Memory and the work per second of audio do not grow with the stream.
+class StreamRecognizer// NOLINT
+{
+public:
+  StreamRecognizer(SQLiteDB &db, uint32_t sample_rate, uint16_t num_channels, const StreamSettings & = {});
+
+  // Interleaved samples in [-1, 1), whole inter-channel samples only.
+  void push(std::span<const double> samples);
+  // Matches what is left of the stream and closes the open segment.
+  void finish();
+  // Votes with the hashes of one hop starting at `start_seconds`, anchor times relative to
+  // it, as if they had been computed from pushed samples. For a caller that fingerprints
+  // the stream itself.
+  void pushHashes(const Fingerprint &, double start_seconds);
+
+  // Segments closed since the last call.
+  std::vector<StreamSegment> takeSegments();
+
+private:
+  FingerprintConfig m_config;
+  StreamSettings m_settings;
+  uint32_t m_sample_rate;
+  uint16_t m_num_channels;
+  DownmixMatrix m_downmix;
+  SQLiteDB::Statement m_select;
+  HashStats m_hash_stats;
+
+  // Mono samples of the current window and the stream position of the first one.
+  std::vector<double> m_window;
+  size_t m_window_start{};
+  size_t m_window_samples;
+  size_t m_hop_samples;
+
+  // Decayed votes per song and time delta bucket.
+  std::unordered_map<int64_t, std::unordered_map<int64_t, double>> m_votes;
+  // The votes of the last window alone and the stream time of the first hash voting per song.
+  std::unordered_map<int64_t, std::unordered_map<int64_t, double>> m_fresh_votes;
+  std::unordered_map<int64_t, int64_t> m_fresh_start_ms;
+
+  std::optional<StreamSegment> m_open;
+  std::vector<StreamSegment> m_segments;
+
+  void matchWindow(double first_ms, double last_ms);
+  void vote(const Fingerprint &, int64_t window_ms, double first_ms, double last_ms);
+  void decayVotes();
+  [[nodiscard]] double decayedScore(int64_t song_id) const;
+  [[nodiscard]] double freshScore(int64_t song_id) const;
+  void updateSegments(double end_seconds);
+};
+
+}// namespace afs
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef sub_fingerprint_h_
+#define sub_fingerprint_h_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace afs {
+
+// Haitsma-Kalker style sub-fingerprints. The range between the two frequencies is split
+// into 33 logarithmic bands, bit m of a frame is set when the energy difference of bands m
+// and m + 1 grew since the frame before:
+//   (E(n, m) - E(n, m + 1)) - (E(n - 1, m) - E(n - 1, m + 1)) > 0
+// Noise flips a few of the bits instead of removing whole hashes, two recordings of the
+// same audio are told apart from others by the share of differing bits.
+constexpr size_t SUB_FINGERPRINT_BITS = 32;
+constexpr double SUB_FINGERPRINT_MIN_FREQ = 300.0;
+constexpr double SUB_FINGERPRINT_MAX_FREQ = 2000.0;
+// Every input is resampled to this rate first, so a frame lasts as long whatever rate the
+// audio came in at and frames of two recordings line up.
+constexpr uint32_t SUB_FINGERPRINT_SAMPLE_RATE = 11025;
+
+// Frames a candidate is compared over at least, ~3 s at the default hop.
+constexpr size_t SUB_FINGERPRINT_BLOCK = 256;
+// Alignments with the most seed hits that are verified per query.
+constexpr size_t SUB_FINGERPRINT_MAX_CANDIDATES = 32;
+
+// One word per block of the spectrogram after the first, word i belongs to block i + 1.
+using SubFingerprint = std::vector<uint32_t>;
+
+// Sub-fingerprints of a power spectrogram of `num_blocks` rows of `num_bins` bins that are
+// `bin_hz` apart.
+template<typename T>
+SubFingerprint extractSubFingerprints(std::span<const T> power, size_t num_blocks, size_t num_bins, double bin_hz);
+
+// The frames as stored in the database, 4 bytes each in little-endian order, and back. A
+// trailing partial word is dropped.
+std::vector<uint8_t> packSubFingerprint(std::span<const uint32_t> frames);
+SubFingerprint unpackSubFingerprint(std::span<const uint8_t> bytes);
+
+// Number of differing bits of two equally long runs of frames.
+size_t bitErrors(std::span<const uint32_t> a, std::span<const uint32_t> b);
+
+}// namespace afs
+
+#endif
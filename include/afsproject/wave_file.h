@@ -3,9 +3,14 @@
 
 #include <afsproject/audio_file.h>
 #include <afsproject/either.h>
+#include <afsproject/mapped_file.h>
 #include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace afs {
 
@@ -35,6 +40,10 @@ struct WaveFmtChunk
   int32_t n_avg_bytes_per_sec;
   int16_t n_block_align;
   int16_t bit_depth;
+  // WAVE_FORMAT_EXTENSIBLE only
+  int16_t valid_bits;
+  int32_t channel_mask;
+  int16_t sub_format;
 };
 
 struct WaveDataChunk
@@ -46,15 +55,46 @@ struct WaveDataChunk
   int samples_start_idx;
 };
 
+// The raw data chunk of a WAV file, straight from the file bytes.
+struct WaveDataView
+{
+  std::span<const uint8_t> bytes;
+  WaveFormat format;
+  uint16_t bit_depth;
+  uint16_t num_channels;
+  size_t num_frames;
+
+  // Typed view of the interleaved samples, empty when T is not the layout on disk
+  // (24-bit or 8-bit samples, big endian host or a misaligned data chunk).
+  template<typename T> [[nodiscard]] std::span<const T> as() const
+  {
+    if (std::endian::native != std::endian::little || sizeof(T) * 8 != bit_depth
+        || std::is_floating_point_v<T> != (format == WaveFormat::IEEE_FLOAT)
+        || reinterpret_cast<uintptr_t>(bytes.data()) % alignof(T) != 0) {// NOLINT
+      return {};
+    }
+
+    return { reinterpret_cast<const T *>(bytes.data()), bytes.size() / sizeof(T) };// NOLINT
+  }
+};
+
+// Turns the raw bytes of whole samples into a PCMBuffer of the narrowest fitting type.
+using WaveDecodeKernel = PCMBuffer (*)(std::span<const uint8_t>);
+
 class WaveFile : public IAudioFile// NOLINT
 {
 public:
   WaveFile() = default;
   ~WaveFile() override = default;
 
+  // Decodes the whole file up front and lets go of it.
   bool load(const std::string &file_path) override;
+  // Maps the file and validates its chunks without decoding anything, samples are
+  // decoded on demand from the mapping.
+  bool open(const std::string &file_path);
   [[nodiscard]] bool save(const std::string &file_path) const override;
   [[nodiscard]] std::vector<double> getPCMData() const override;
+  [[nodiscard]] std::vector<double> getMonoPCMData() const override;
   [[nodiscard]] uint32_t getSampleRate() const override;
   [[nodiscard]] uint16_t getNumChannels() const override;
   [[nodiscard]] double getDurationSeconds() const override;
@@ -64,23 +104,54 @@ public:
   [[nodiscard]] int getNumSamplesPerChannel() const override;
   [[nodiscard]] Metadata getMetadata() const override;
 
+  [[nodiscard]] size_t getNumFrames() const;
+  [[nodiscard]] WaveDataView getDataView() const;
+  // Decodes `num_frames` interleaved frames starting at `first_frame`, only valid
+  // while the file is open.
+  [[nodiscard]] PCMBuffer decodeWindow(size_t first_frame, size_t num_frames) const;
+
+  // Maps the file and reads fmt, the data size and the LIST/INFO tags, the samples are
+  // never touched.
+  static bool scan(const std::string &file_path, AudioInfo &);
+
+  // Kernel for little endian samples of that format and width, nullptr when unsupported.
+  static WaveDecodeKernel findDecodeKernel(WaveFormat, uint16_t bit_depth);
+
 private:
+  static constexpr size_t DECODE_WINDOW_FRAMES = 64 * 1024;
+
+  MappedFile m_mapped_file;
   std::vector<uint8_t> m_file_data;
+  std::span<const uint8_t> m_file_view;
+  std::span<const uint8_t> m_data_view;
+  size_t m_block_align{};
+  WaveFormat m_format = WaveFormat::PCM;
+  WaveDecodeKernel m_decode_kernel = nullptr;
+
+  [[nodiscard]] bool isLazy() const;
+  void releaseFile();
 
   WaveHeaderChunk decodeHeaderChunk();
   Either<WaveFmtChunk, std::string> decodeFmtChunk();
   WaveDataChunk decodeDataChunk();
+  void decodeInfoChunks();
+  void decodeInfoTags(std::span<const uint8_t>);
   Either<size_t, std::string> getIdxOfChunk(const std::string &, size_t);
 
-  void decode8Bits(const WaveFmtChunk &, const std::vector<uint8_t> &);
-  void decode16Bits(const WaveFmtChunk &, const std::vector<uint8_t> &);
-  bool decodeSamples(const WaveFmtChunk &, const WaveDataChunk &);
+  static PCMBuffer decode8Bits(std::span<const uint8_t>);
+  static PCMBuffer decode16Bits(std::span<const uint8_t>);
+  static PCMBuffer decode24Bits(std::span<const uint8_t>);
+  static PCMBuffer decode32Bits(std::span<const uint8_t>);
+  static PCMBuffer decodeFloat32Bits(std::span<const uint8_t>);
+  static PCMBuffer decodeFloat64Bits(std::span<const uint8_t>);
+  bool prepareSamples(const WaveFmtChunk &, const WaveDataChunk &);
   bool decodeWaveFile();
 
 
   void encodeHeaderChunk(std::vector<uint8_t> &) const;
   void encodeFmtChunk(std::vector<uint8_t> &) const;
   void encodeDataChunk(std::vector<uint8_t> &) const;
+  [[nodiscard]] std::vector<int32_t> getIntegerSamples() const;
   void encode8Bits(std::vector<uint8_t> &) const;
   void encode16Bits(std::vector<uint8_t> &) const;
 
@@ -89,8 +160,8 @@ private:
 };
 
 // TODO: Move these utilities functions to audio_engine.h file
-int32_t convFourBytesToInt32(std::span<uint8_t>, std::endian = std::endian::little);
-int16_t convTwoBytesToInt16(std::span<uint8_t>, std::endian = std::endian::little);
+int32_t convFourBytesToInt32(std::span<const uint8_t>, std::endian = std::endian::little);
+int16_t convTwoBytesToInt16(std::span<const uint8_t>, std::endian = std::endian::little);
 void addStringToData(std::vector<uint8_t> &, const std::string &);
 void addInt32ToData(std::vector<uint8_t> &, int32_t);
 void addInt16ToData(std::vector<uint8_t> &, int16_t);
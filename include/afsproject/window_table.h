@@ -0,0 +1,72 @@
+#ifndef window_table_h_
+#define window_table_h_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+namespace afs {
+
+enum class WindowKind : uint8_t { Rectangular, Hamming, Hann, Blackman };
+
+// Value of the symmetric window of length `n` at index `i`, same definitions as numpy.
+inline double windowValue(WindowKind kind, size_t i, size_t n)
+{
+  if (n <= 1) { return 1.0; }
+
+  const double phase = (2.0 * std::numbers::pi * double(i)) / double(n - 1);
+
+  switch (kind) {
+  case WindowKind::Hamming:
+    return 0.54 - (0.46 * std::cos(phase));// NOLINT
+  case WindowKind::Hann:
+    return 0.5 - (0.5 * std::cos(phase));// NOLINT
+  case WindowKind::Blackman:
+    return 0.42 - (0.5 * std::cos(phase)) + (0.08 * std::cos(2.0 * phase));// NOLINT
+  case WindowKind::Rectangular:
+  default:
+    return 1.0;
+  }
+}
+
+// Window of a length only known at runtime.
+inline std::vector<double> makeWindow(WindowKind kind, size_t n)
+{
+  std::vector<double> window(n);
+  for (size_t i = 0; i < n; ++i) { window[i] = windowValue(kind, i, n); }
+  return window;
+}
+
+// Window of a length known at compile time, stored in the sample type T it is applied to.
+// The table is computed on first use and shared by every caller afterwards, loops over it
+// have a constant trip count of N.
+template<WindowKind Kind, size_t N, typename T = double> class WindowTable
+{
+public:
+  static constexpr size_t SIZE = N;
+
+  static const std::array<T, N> &values()
+  {
+    static const std::array<T, N> table = [] {
+      std::array<T, N> out{};
+      for (size_t i = 0; i < N; ++i) { out[i] = static_cast<T>(windowValue(Kind, i, N)); }
+      return out;
+    }();
+
+    return table;
+  }
+
+  // out[i] = in[i] * w[i] over exactly N samples.
+  static void apply(const T *in, T *out)
+  {
+    const std::array<T, N> &window = values();
+    for (size_t i = 0; i < N; ++i) { out[i] = in[i] * window[i]; }// NOLINT
+  }
+};
+
+}// namespace afs
+
+#endif
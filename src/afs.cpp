@@ -1,39 +1,42 @@
-#include <NumCpp/NdArray/NdArrayCore.hpp>
 #include <afsproject/afs.h>
 #include <afsproject/audio_file.h>
+#include <afsproject/band_layout.h>
 #include <afsproject/db.h>
-#include <afsproject/fft.h>
-#include <afsproject/spectrum.h>
-#include <afsproject/wave.h>
+#include <afsproject/fftw_traits.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/hash_stats.h>
+#include <afsproject/peak_extractor.h>
+#include <afsproject/spectral_kernels.h>
+#include <afsproject/sub_fingerprint.h>
+#include <afsproject/window_table.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <fftw3.h>
 #include <iostream>
-#include <optional>
+#include <span>
 #include <sqlite3.h>
 #include <string>
-#include <tuple>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace afs {
 
-void AFS::stereoToMono(IAudioFile &audio_file)
+template<typename T> std::vector<T> AFS::stereoToMono(const IAudioFile &audio_file)
 {
-  // Compute simple averaging to chnage from stereo to mon
-  // M(t) = (L(t) + R(t)) / 2
-
-  if (audio_file.isStereo()) {
-    std::vector<double> pcm_data = audio_file.getPCMData();
-    std::vector<double> avg_pcm_data{};
-
-    for (size_t i = 0; i < pcm_data.size() - 1; i += 2) {
-      avg_pcm_data.push_back((pcm_data.at(i) + pcm_data.at(i + 1)) / 2);
-    }
-
-    audio_file.setPCMData(avg_pcm_data, audio_file.getSampleRate(), 1);
+  // Mix every channel down to mono with the ITU gains of the file's layout,
+  // for stereo that is M(t) = (L(t) + R(t)) / 2.
+  // The conversion from the decoded integer samples happens in the same pass.
+  if constexpr (std::is_same_v<T, double>) {
+    return audio_file.getMonoPCMData();
+  } else {
+    return audio_file.getMonoPCMDataFloat();
   }
 }
 
@@ -60,62 +63,252 @@ void AFS::normalizePCMData(IAudioFile &audio_file)
   audio_file.setPCMData(normalized_pcm_data, audio_file.getSampleRate(), audio_file.getNumChannels());
 }
 
-void AFS::applyLowPassFilter(IAudioFile &audio_file)
+template<typename T> void AFS::applyLowPassFilter(std::vector<T> &pcm_data, uint32_t sample_rate)
 {
-  std::vector<double> pcm_data = audio_file.getPCMData();
+  // Brick-wall filter: zero every bin above the cutoff and transform back.
+  using FFTW = FFTWTraits<T>;
 
-  const nc::NdArray<double> ys(pcm_data.begin(), pcm_data.end());
-  Wave wave(ys, int(audio_file.getSampleRate()));
+  const size_t n = pcm_data.size();// NOLINT
+  if (n == 0) { return; }
 
-  Spectrum spectrum = wave.makeSpectrum();
-  spectrum.lowPass(5000);
+  const size_t num_bins = (n / 2) + 1;
+  FFTWBuffer<T> samples(n);
+  FFTWBuffer<T, typename FFTW::Complex> bins(num_bins);
+
+  const FFTWPlan<T> forward(FFTW::planR2C(int(n), samples.data(), bins.data(), FFTW_ESTIMATE));
+  const FFTWPlan<T> backward(FFTW::planC2R(int(n), bins.data(), samples.data(), FFTW_ESTIMATE));
+
+  std::ranges::copy(pcm_data, samples.data());
+  FFTW::execute(forward.get());
+
+  // Bin k sits at k * (rate / 2) / (num_bins - 1), same spacing Wave::makeSpectrum uses.
+  const double freq_step = num_bins > 1 ? (double(sample_rate) / 2.0) / double(num_bins - 1) : 0.0;
+  for (size_t k = 0; k < num_bins; ++k) {
+    if (double(k) * freq_step > LOW_PASS_CUTOFF) {
+      bins.data()[k][0] = T(0);// NOLINT
+      bins.data()[k][1] = T(0);// NOLINT
+    }
+  }
 
-  const Wave filtered = spectrum.makeWave();
-  const std::vector<double> pcm_data2 = filtered.getYs().toStlVector();
+  FFTW::execute(backward.get());
 
-  audio_file.setPCMData(pcm_data2, audio_file.getSampleRate(), audio_file.getNumChannels());
+  const T scale = T(1) / static_cast<T>(n);
+  for (size_t i = 0; i < n; ++i) { pcm_data[i] = samples.data()[i] * scale; }// NOLINT
 }
 
-void AFS::downSampling(IAudioFile &audio_file)
+uint32_t AFS::processingRate(uint32_t sample_rate)
+{
+  // Only 44100 Hz is downsampled, by 4
+  return sample_rate == 44100 ? sample_rate / 4 : sample_rate;// NOLINT
+}
+
+template<typename T> uint32_t AFS::downSampling(std::vector<T> &pcm_data, uint32_t sample_rate)
 {
   // Downsample for sample rate @ 44100 Hz
+  const uint32_t new_rate = processingRate(sample_rate);
+  if (new_rate == sample_rate) { return sample_rate; }
+
+  const size_t factor = sample_rate / new_rate;
+  std::vector<T> new_pcm_data((pcm_data.size() + factor - 1) / factor);
+  for (size_t i = 0; i < new_pcm_data.size(); ++i) { new_pcm_data[i] = pcm_data[factor * i]; }
+
+  pcm_data.swap(new_pcm_data);
+  return new_rate;
+}
+
+template<typename T> void AFS::resample(std::vector<T> &pcm_data, uint32_t sample_rate, uint32_t new_rate)
+{
+  // Linear interpolation, the low-pass filter already removed what the new rate cannot hold
+  if (sample_rate == new_rate || pcm_data.empty()) { return; }
+
+  const double step = double(sample_rate) / double(new_rate);
+  const auto new_size = size_t(std::ceil(double(pcm_data.size()) / step));
+  std::vector<T> new_pcm_data(new_size);
+  for (size_t i = 0; i < new_size; ++i) {
+    const double position = double(i) * step;
+    const auto index = size_t(position);
+    const T next = index + 1 < pcm_data.size() ? pcm_data[index + 1] : pcm_data[index];
+    const auto fraction = T(position - double(index));
+    new_pcm_data[i] = pcm_data[index] + (fraction * (next - pcm_data[index]));
+  }
 
-  if (audio_file.getSampleRate() == 44100) {
-    std::vector<double> pcm_data = audio_file.getPCMData();
-    std::vector<double> new_pcm_data;
+  pcm_data.swap(new_pcm_data);
+}
+
+template<typename T>
+Fingerprint AFS::fingerprint(std::vector<T> pcm_data, uint32_t sample_rate, const FingerprintConfig &config)
+{
+  applyLowPassFilter(pcm_data, sample_rate);
+  downSampling(pcm_data, sample_rate);
+
+  const PowerSpectrogram<T> spectrogram = shortTimeFourierTransform(std::span<const T>(pcm_data), config);
+  const Matrix peaks = config.peak_extractor == PeakExtractor::LocalMax
+                         ? extractLocalMaxima(std::span<const T>(spectrogram.power),
+                             spectrogram.num_blocks,
+                             PowerSpectrogram<T>::NUM_BINS,
+                             config)
+                         : filtering(spectrogram);
+
+  return generateFingerprints(peaks, config);
+}
+
+Fingerprint
+  AFS::computeFingerprints(const IAudioFile &audio_file, SamplePrecision precision, const FingerprintConfig &config)
+{
+  const uint32_t sample_rate = audio_file.getSampleRate();
+  if (precision == SamplePrecision::Float) { return fingerprint(stereoToMono<float>(audio_file), sample_rate, config); }
 
-    for (size_t i = 0; i < pcm_data.size(); i += 4) { new_pcm_data.push_back(pcm_data[i]); }
+  return fingerprint(stereoToMono<double>(audio_file), sample_rate, config);
+}
 
-    audio_file.setPCMData(new_pcm_data, audio_file.getSampleRate() / 4, audio_file.getNumChannels());
+Fingerprint AFS::computeFingerprints(std::span<const double> mono,
+  uint32_t sample_rate,
+  SamplePrecision precision,
+  const FingerprintConfig &config)
+{
+  if (precision == SamplePrecision::Float) {
+    std::vector<float> pcm_data(mono.size());
+    for (size_t i = 0; i < mono.size(); ++i) { pcm_data[i] = static_cast<float>(mono[i]); }
+    return fingerprint(std::move(pcm_data), sample_rate, config);
   }
+
+  return fingerprint(std::vector<double>(mono.begin(), mono.end()), sample_rate, config);
 }
 
-void AFS::storingFingerprints(IAudioFile &audio_file, long long song_id, SQLiteDB &db)// NOLINT
+template<typename T>
+SubFingerprint AFS::subFingerprint(std::vector<T> pcm_data, uint32_t sample_rate, const FingerprintConfig &config)
 {
-  Matrix matrix{ shortTimeFourierTransform(audio_file) };
-  filtering(matrix);
-  const Fingerprint fingerprints{ generateFingerprints(matrix, song_id) };
+  applyLowPassFilter(pcm_data, sample_rate);
+  resample(pcm_data, sample_rate, SUB_FINGERPRINT_SAMPLE_RATE);
+
+  // Same transform as the constellation, only with a shorter hop
+  const PowerSpectrogram<T> spectrogram =
+    shortTimeFourierTransform(std::span<const T>(pcm_data), config, config.sub_fingerprint_hop);
+
+  return extractSubFingerprints(std::span<const T>(spectrogram.power),
+    spectrogram.num_blocks,
+    PowerSpectrogram<T>::NUM_BINS,
+    double(SUB_FINGERPRINT_SAMPLE_RATE) / double(FFT_WINDOW_SIZE));
+}
+
+SubFingerprint
+  AFS::computeSubFingerprints(const IAudioFile &audio_file, SamplePrecision precision, const FingerprintConfig &config)
+{
+  const uint32_t sample_rate = audio_file.getSampleRate();
+  if (precision == SamplePrecision::Float) { return subFingerprint(stereoToMono<float>(audio_file), sample_rate, config); }
+
+  return subFingerprint(stereoToMono<double>(audio_file), sample_rate, config);
+}
+
+SubFingerprint AFS::computeSubFingerprints(std::span<const double> mono,
+  uint32_t sample_rate,
+  SamplePrecision precision,
+  const FingerprintConfig &config)
+{
+  if (precision == SamplePrecision::Float) {
+    std::vector<float> pcm_data(mono.size());
+    for (size_t i = 0; i < mono.size(); ++i) { pcm_data[i] = static_cast<float>(mono[i]); }
+    return subFingerprint(std::move(pcm_data), sample_rate, config);
+  }
 
+  return subFingerprint(std::vector<double>(mono.begin(), mono.end()), sample_rate, config);
+}
+
+void AFS::storingFingerprints(IAudioFile &audio_file, long long song_id, SQLiteDB &db, SamplePrecision precision)// NOLINT
+{
+  const FingerprintConfig config = loadFingerprintConfig(db);
+  // The catalogue keeps the config it is built with, queries are hashed with it. The first
+  // song of a catalogue without one writes the defaults down.
+  if (!hasFingerprintConfig(db)) { storeFingerprintConfig(db, config); }
+
+  if (config.fingerprint_mode == FingerprintMode::SubFingerprint) {
+    storeSubFingerprints(computeSubFingerprints(audio_file, precision, config), song_id, db);
+    return;
+  }
+
+  storeFingerprints(computeFingerprints(audio_file, precision, config), song_id, db, config);
+}
+
+void AFS::storingTrackFingerprints(std::span<const double> mono,
+  uint32_t sample_rate,
+  std::span<const TrackSlice> tracks,
+  SQLiteDB &db,
+  SamplePrecision precision)
+{
+  if (tracks.empty()) { return; }
+
+  const FingerprintConfig config = loadFingerprintConfig(db);
+  if (!hasFingerprintConfig(db)) { storeFingerprintConfig(db, config); }
+  const bool sub_fingerprints = config.fingerprint_mode == FingerprintMode::SubFingerprint;
+
+  std::vector<Fingerprint> fingerprints(tracks.size());
+  std::vector<SubFingerprint> sub_fingerprint_frames(tracks.size());
+
+  // 1. Hash the tracks in parallel, every worker takes the next track nobody has started on.
+  std::atomic<size_t> next_track{ 0 };
+  auto worker = [&]() {
+    for (size_t i = next_track++; i < tracks.size(); i = next_track++) {
+      const size_t start = std::min(size_t(tracks[i].start_sample), mono.size());
+      const size_t end = std::clamp(size_t(tracks[i].end_sample), start, mono.size());
+      const std::span<const double> track = mono.subspan(start, end - start);
+
+      if (sub_fingerprints) {
+        sub_fingerprint_frames[i] = computeSubFingerprints(track, sample_rate, precision, config);
+      } else {
+        fingerprints[i] = computeFingerprints(track, sample_rate, precision, config);
+      }
+    }
+  };
+
+  const size_t num_workers = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, tracks.size());
+  std::vector<std::jthread> workers;
+  workers.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; ++i) { workers.emplace_back(worker); }
+  // Joins them.
+  workers.clear();
+
+  // 2. SQLite takes one writer, the tracks go in one after the other.
+  for (size_t i = 0; i < tracks.size(); ++i) {
+    if (sub_fingerprints) {
+      storeSubFingerprints(sub_fingerprint_frames[i], tracks[i].song_id, db);
+    } else {
+      storeFingerprints(fingerprints[i], tracks[i].song_id, db, config);
+    }
+  }
+}
+
+void AFS::storeFingerprints(const Fingerprint &fingerprints,
+  long long song_id,
+  SQLiteDB &db,
+  const FingerprintConfig &config)// NOLINT
+{
   const std::string insert_sql = "INSERT INTO fingerprints (hash, song_id, time_offset) VALUES (?, ?, ?);";
 
   try {
     SQLiteDB::Transaction transaction(db);
 
     SQLiteDB::Statement stmt(db, insert_sql);
+    HashStats hash_stats(db, config);
 
-    for (const auto &pair : fingerprints) {
-      const unsigned int hash = pair.first;
-      const auto &couples = pair.second;
+    // The entries are unique and grouped by address, every run is one hash of the song.
+    // All postings are kept: whether a hash is a stop hash depends on the size of the
+    // catalogue, so it is only decided when a query is matched.
+    for (auto run = fingerprints.begin(); run != fingerprints.end();) {
+      const uint32_t hash = run->address;
+      const auto run_end =
+        std::find_if(run, fingerprints.end(), [hash](const FingerprintEntry &entry) { return entry.address != hash; });
 
-      for (const unsigned long couple : couples) {
-        const uint32_t time_offset = couple & 0xFFFFFFFFU;
+      hash_stats.addSong(hash);
 
+      for (auto entry = run; entry != run_end; ++entry) {
         stmt.bindInt(1, static_cast<int>(hash));
         stmt.bindLongLong(2, song_id);
-        stmt.bindInt(3, static_cast<int>(time_offset));
+        stmt.bindInt(3, static_cast<int>(entry->anchor_time));
         stmt.step();
         stmt.reset();
       }
+
+      run = run_end;
     }
 
     transaction.commit();
@@ -125,225 +318,466 @@ void AFS::storingFingerprints(IAudioFile &audio_file, long long song_id, SQLiteD
   }
 }
 
-void AFS::searchForRecord(IAudioFile &audio_file, SQLiteDB &db)// NOLINT
+void AFS::searchForRecord(IAudioFile &audio_file, SQLiteDB &db, SamplePrecision precision)// NOLINT
 {
-  Matrix matrix{ shortTimeFourierTransform(audio_file) };
-  filtering(matrix);
-  const Fingerprint record_fgs{ generateFingerprints(matrix, std::nullopt) };
+  // The query has to be hashed the same way the catalogue was.
+  const FingerprintConfig config = loadFingerprintConfig(db);
+
+  if (config.fingerprint_mode == FingerprintMode::SubFingerprint) {
+    printMatch(searchSubFingerprints(computeSubFingerprints(audio_file, precision, config), db, config));
+    return;
+  }
 
+  const Fingerprint record_fgs{ computeFingerprints(audio_file, precision, config) };
+  const std::vector<MatchResult> results = matchFingerprints(std::span(&record_fgs, 1), db, config);
+
+  if (!results.empty()) { printMatch(results.front()); }
+}
+
+std::vector<MatchResult>
+  AFS::matchFingerprints(std::span<const Fingerprint> queries, SQLiteDB &db, const FingerprintConfig &config)// NOLINT
+{
   const std::string select_sql = "SELECT song_id, time_offset FROM fingerprints WHERE hash = ?;";
 
+  // The entries of all queries in one buffer, grouped by address.
+  struct QueryEntry
+  {
+    uint32_t address;
+    uint32_t anchor_time;
+    uint32_t query;
+  };
+  std::vector<QueryEntry> entries;
+
+  size_t num_entries = 0;
+  for (const Fingerprint &query : queries) { num_entries += query.size(); }
+  entries.reserve(num_entries);
+
+  for (size_t q = 0; q < queries.size(); ++q) {
+    for (const FingerprintEntry &entry : queries[q]) { entries.push_back({ entry.address, entry.anchor_time, uint32_t(q) }); }
+  }
+  std::ranges::stable_sort(entries, {}, &QueryEntry::address);
+
+  std::vector<MatchResult> results(queries.size());
+
   try {
     SQLiteDB::Transaction transaction(db);
     SQLiteDB::Statement stmt(db, select_sql);
+    HashStats hash_stats(db, config);
 
-    std::unordered_map<int64_t, std::unordered_map<int, int>> song_time_delta_counts;
+    // Votes per query and (song, time delta), each weighted by the IDF of the hash that cast it.
+    struct Votes
+    {
+      double score;
+      int count;
+    };
+    std::vector<std::unordered_map<int64_t, std::unordered_map<int, Votes>>> song_time_delta_counts(queries.size());
+
+    // Each unique hash is fetched once and its postings vote for every anchor time of it in any query.
+    for (auto run = entries.begin(); run != entries.end();) {
+      const uint32_t hash = run->address;
+      const auto run_end =
+        std::find_if(run, entries.end(), [hash](const QueryEntry &entry) { return entry.address != hash; });
+
+      const uint32_t document_frequency = hash_stats.documentFrequency(hash);
+      if (hash_stats.isStopHash(document_frequency)) {
+        run = run_end;
+        continue;
+      }
+      const double weight = hash_stats.weight(document_frequency);
 
-    for (const auto &pair : record_fgs) {
-      const auto hash = pair.first;
-      const auto &query_couples = pair.second;
+      stmt.bindInt(1, static_cast<int>(hash));
 
-      for (const auto query_couple : query_couples) {
-        const int query_time = static_cast<int>(query_couple & 0xFFFFFFFFU);
+      while (stmt.step() == SQLITE_ROW) {
+        const int64_t song_id = stmt.columnLongLong(0);
+        const int db_time = stmt.columnInt(1);
 
-        stmt.bindInt(1, static_cast<int>(hash));
+        for (auto entry = run; entry != run_end; ++entry) {
+          const int time_delta = db_time - static_cast<int>(entry->anchor_time);
 
-        while (stmt.step() == SQLITE_ROW) {
-          const int64_t song_id = stmt.columnLongLong(0);
-          const int db_time = stmt.columnInt(1);
+          Votes &votes = song_time_delta_counts[entry->query][song_id][time_delta];
+          votes.score += weight;
+          votes.count++;
+        }
+      }
 
-          const int time_delta = db_time - query_time;
+      stmt.reset();
+      run = run_end;
+    }
 
-          song_time_delta_counts[song_id][time_delta]++;
+    for (size_t q = 0; q < queries.size(); ++q) {
+      MatchResult &result = results[q];
+
+      for (const auto &[song_id, time_deltas] : song_time_delta_counts[q]) {
+        for (const auto &[time_delta, votes] : time_deltas) {
+          if (votes.score > result.score) {
+            result.score = votes.score;
+            result.num_matches = votes.count;
+            result.song_id = song_id;
+            result.time_offset_ms = time_delta;
+          }
         }
-
-        stmt.reset();
       }
     }
 
-    int64_t best_song_id = -1;
-    int max_cons_matches = 0;
-    int best_time_delta = 0;
+    transaction.commit();
+  } catch (const SQLiteException &e) {
+    std::cerr << "Failed to retrieve fingerprint values from database. Rolled back transaction.\n" << e.what() << "\n";
+  }
+
+  return results;
+}
+
+void AFS::printMatch(const MatchResult &result)
+{
+  if (result.song_id != -1) {
+    std::cout << "\n=== MATCH FOUND ===\n";
+    std::cout << "Song ID: " << result.song_id << "\n";
+    std::cout << "Consistent matches: " << result.num_matches << " (score " << result.score << ")\n";
+    std::cout << "Time offset in song: " << result.time_offset_ms << "ms\n";
+  } else {
+    std::cout << "\nNo match found.\n";
+  }
+}
+
+void AFS::storeSubFingerprints(const SubFingerprint &frames, long long song_id, SQLiteDB &db)// NOLINT
+{
+  const std::string frames_sql = "INSERT OR REPLACE INTO sub_fingerprints (song_id, frames) VALUES (?, ?);";
+  const std::string seed_sql = "INSERT OR IGNORE INTO sub_fingerprint_seeds (value, song_id, frame) VALUES (?, ?, ?);";
+
+  try {
+    SQLiteDB::Transaction transaction(db);
+
+    SQLiteDB::Statement frames_stmt(db, frames_sql);
+    frames_stmt.bindLongLong(1, song_id);
+    const std::vector<uint8_t> bytes = packSubFingerprint(frames);
+    frames_stmt.bindBlob(2, bytes.data(), bytes.size());
+    frames_stmt.step();
+
+    // A frame of 0 is what silence turns into, it would seed every song.
+    SQLiteDB::Statement seed_stmt(db, seed_sql);
+    for (size_t i = 0; i < frames.size(); ++i) {
+      if (frames[i] == 0) { continue; }
+
+      seed_stmt.bindInt(1, static_cast<int>(frames[i]));
+      seed_stmt.bindLongLong(2, song_id);
+      seed_stmt.bindInt(3, static_cast<int>(i));
+      seed_stmt.step();
+      seed_stmt.reset();
+    }
+
+    transaction.commit();
+    std::cout << "Successfully inserted " << frames.size() << " sub-fingerprints for song ID: " << song_id << "\n";
+  } catch (const SQLiteException &e) {
+    std::cerr << "Failed to insert sub-fingerprints. Rolled back transaction.\n" << e.what() << "\n";
+  }
+}
+
+SubFingerprintMatch
+  AFS::searchSubFingerprints(const SubFingerprint &query, SQLiteDB &db, const FingerprintConfig &config)// NOLINT
+{
+  const std::string seed_sql = "SELECT song_id, frame FROM sub_fingerprint_seeds WHERE value = ?;";
+  const std::string frames_sql = "SELECT frames FROM sub_fingerprints WHERE song_id = ?;";
 
-    for (const auto &[song_id, time_deltas] : song_time_delta_counts) {
-      for (const auto &[time_delta, count] : time_deltas) {
-        if (count > max_cons_matches) {
-          max_cons_matches = count;
-          best_song_id = song_id;
-          best_time_delta = time_delta;
+  try {
+    SQLiteDB::Transaction transaction(db);
+    SQLiteDB::Statement seed_stmt(db, seed_sql);
+    SQLiteDB::Statement frames_stmt(db, frames_sql);
+
+    // 1. Every query frame found verbatim in a song proposes an alignment of the two,
+    // each distinct value is looked up once
+    std::vector<size_t> order(query.size());
+    for (size_t i = 0; i < order.size(); ++i) { order[i] = i; }
+    std::ranges::sort(order, [&query](size_t a, size_t b) { return query[a] < query[b]; });
+
+    std::unordered_map<int64_t, std::unordered_map<int64_t, int>> song_offset_hits;
+
+    for (size_t run = 0; run < order.size();) {
+      const uint32_t value = query[order[run]];
+      size_t run_end = run + 1;
+      while (run_end < order.size() && query[order[run_end]] == value) { ++run_end; }
+
+      if (value != 0) {
+        seed_stmt.bindInt(1, static_cast<int>(value));
+
+        while (seed_stmt.step() == SQLITE_ROW) {
+          const int64_t song_id = seed_stmt.columnLongLong(0);
+          const int64_t frame = seed_stmt.columnLongLong(1);
+
+          for (size_t i = run; i < run_end; ++i) { song_offset_hits[song_id][frame - int64_t(order[i])]++; }
         }
+
+        seed_stmt.reset();
       }
+
+      run = run_end;
     }
 
-    if (best_song_id != -1) {
-      std::cout << "\n=== MATCH FOUND ===\n";
-      std::cout << "Song ID: " << best_song_id << "\n";
-      std::cout << "Consistent matches: " << max_cons_matches << "\n";
-      std::cout << "Time offset in song: " << best_time_delta << "ms\n";
-    } else {
-      std::cout << "\nNo match found.\n";
+    // 2. Only the alignments with the most seeds are verified
+    struct Candidate
+    {
+      int64_t song_id;
+      int64_t offset;
+      int hits;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto &[song_id, offsets] : song_offset_hits) {
+      for (const auto &[offset, hits] : offsets) { candidates.push_back({ song_id, offset, hits }); }
+    }
+
+    const size_t num_candidates = std::min(candidates.size(), SUB_FINGERPRINT_MAX_CANDIDATES);
+    std::partial_sort(candidates.begin(),
+      candidates.begin() + std::ptrdiff_t(num_candidates),
+      candidates.end(),
+      [](const Candidate &a, const Candidate &b) { return a.hits > b.hits; });
+    candidates.resize(num_candidates);
+
+    // 3. Bit error rate over the whole overlap of query and song
+    std::unordered_map<int64_t, SubFingerprint> song_frames;
+    const size_t min_overlap = std::min(query.size(), SUB_FINGERPRINT_BLOCK);
+
+    SubFingerprintMatch best;
+    best.bit_error_rate = config.max_bit_error_rate;
+    const double frame_ms = 1000.0 * double(config.sub_fingerprint_hop) / double(SUB_FINGERPRINT_SAMPLE_RATE);
+
+    for (const Candidate &candidate : candidates) {
+      auto [it, inserted] = song_frames.try_emplace(candidate.song_id);
+      if (inserted) {
+        frames_stmt.bindLongLong(1, candidate.song_id);
+        if (frames_stmt.step() == SQLITE_ROW) {
+          it->second = unpackSubFingerprint(frames_stmt.columnBlob(0));
+        }
+        frames_stmt.reset();
+      }
+      const SubFingerprint &frames = it->second;
+
+      const int64_t first = std::max<int64_t>(0, -candidate.offset);
+      const int64_t last = std::min<int64_t>(int64_t(query.size()), int64_t(frames.size()) - candidate.offset);
+      if (last - first < int64_t(std::max<size_t>(min_overlap, 1))) { continue; }
+
+      const auto overlap = size_t(last - first);
+      const size_t errors = bitErrors(std::span(query).subspan(size_t(first), overlap),
+        std::span(frames).subspan(size_t(first + candidate.offset), overlap));
+      const double bit_error_rate = double(errors) / double(overlap * SUB_FINGERPRINT_BITS);
+
+      if (bit_error_rate < best.bit_error_rate) {
+        best.song_id = candidate.song_id;
+        best.bit_error_rate = bit_error_rate;
+        best.num_frames = overlap;
+        best.time_offset_ms = static_cast<int>(double(candidate.offset) * frame_ms);
+      }
     }
 
     transaction.commit();
+    return best;
   } catch (const SQLiteException &e) {
-    std::cerr << "Failed to retrieve fingerprint values from database. Rolled back transaction.\n" << e.what() << "\n";
+    std::cerr << "Failed to retrieve sub-fingerprints from database. Rolled back transaction.\n" << e.what() << "\n";
   }
+
+  return {};
 }
 
-Matrix AFS::shortTimeFourierTransform(IAudioFile &audio_file)
+void AFS::printMatch(const SubFingerprintMatch &result)
 {
-  stereoToMono(audio_file);
-  applyLowPassFilter(audio_file);
-  downSampling(audio_file);
+  if (result.song_id != -1) {
+    std::cout << "\n=== MATCH FOUND ===\n";
+    std::cout << "Song ID: " << result.song_id << "\n";
+    std::cout << "Bit error rate: " << result.bit_error_rate << " over " << result.num_frames << " frames\n";
+    std::cout << "Time offset in song: " << result.time_offset_ms << "ms\n";
+  } else {
+    std::cout << "\nNo match found.\n";
+  }
+}
 
-  std::vector<double> pcm_data = audio_file.getPCMData();
+template<typename T>
+std::vector<uint8_t> AFS::gateSilence(std::span<const T> pcm_data, size_t num_blocks, size_t hop, double threshold_db)
+{
+  const size_t sample_window = FFT_WINDOW_SIZE;
 
-  // 1. Define the Hamming window for all calculations
-  const int sample_window = 1024;
-  std::vector<double> window(sample_window);
+  // Running energy of the signal, the energy of a block is the difference of two entries.
+  std::vector<double> energy(pcm_data.size() + 1);
+  for (size_t i = 0; i < pcm_data.size(); ++i) {
+    energy[i + 1] = energy[i] + (double(pcm_data[i]) * double(pcm_data[i]));
+  }
 
-  for (size_t i = 0; i < window.size(); ++i) {
-    const double ans = 0.54 - (0.46 * std::cos((2.0 * M_PI * static_cast<double>(i)) / (sample_window - 1)));// NOLINT
-    window[i] = ans;
+  // RMS over the block, zero padding included, against the threshold in dBFS. A -inf
+  // threshold gives an energy of 0 that every block reaches, digital silence included.
+  const double threshold_energy = std::pow(10.0, threshold_db / 10.0) * double(sample_window);
+
+  std::vector<uint8_t> active(num_blocks);
+  for (size_t b = 0; b < num_blocks; ++b) {
+    const size_t first = std::min(b * hop, pcm_data.size());
+    const size_t last = std::min(first + sample_window, pcm_data.size());
+    active[b] = uint8_t(energy[last] - energy[first] >= threshold_energy);
   }
 
-  // 2. Slide the window and perform calculations, apply FFT on each data block
-  const int half_window = sample_window / 2;
+  return active;
+}
+
+template std::vector<uint8_t> AFS::gateSilence(std::span<const float>, size_t, size_t, double);
+template std::vector<uint8_t> AFS::gateSilence(std::span<const double>, size_t, size_t, double);
+
+template<typename T>
+PowerSpectrogram<T>
+  AFS::shortTimeFourierTransform(std::span<const T> pcm_data, const FingerprintConfig &config, size_t hop)
+{
+  using FFTW = FFTWTraits<T>;
+
+  // 1. The Hamming window is computed once and shared by all calculations
+  const size_t sample_window = FFT_WINDOW_SIZE;
+  const size_t num_bins = PowerSpectrogram<T>::NUM_BINS;
 
-  int end_of_last_win = 0;
-  for (size_t x = 0; x < pcm_data.size(); x += half_window) {// NOLINT
+  // 2. Slide the window by `hop` and perform calculations, apply FFT on each data block.
+  // The signal is zero padded so the last block that starts inside it is complete.
+  PowerSpectrogram<T> spectrogram;
+  for (size_t x = 0; x < pcm_data.size(); x += hop) {// NOLINT
     if (x + sample_window > pcm_data.size()) {
-      end_of_last_win = int(x) + (sample_window - 1);
+      spectrogram.num_blocks = (x / hop) + 1;
       break;
     }
   }
+  spectrogram.power.resize(spectrogram.num_blocks * num_bins);
 
-  const int num_of_zeros = end_of_last_win - (int(pcm_data.size()) - 1);
+  // 3. Silent blocks are not transformed, they keep their place so the times stay right
+  spectrogram.active = gateSilence(pcm_data, spectrogram.num_blocks, hop, config.silence_threshold_db);
 
-  std::vector<double> zeros_arr(static_cast<size_t>(num_of_zeros));
-  pcm_data.append_range(zeros_arr);
+  FFTWBuffer<T> ys(sample_window);
+  FFTWBuffer<T, typename FFTW::Complex> hs(num_bins);
+  const FFTWPlan<T> plan(FFTW::planR2C(int(sample_window), ys.data(), hs.data(), FFTW_ESTIMATE));
 
-  Matrix matrix{};
+  std::vector<T> padded_block(sample_window);
 
-  for (size_t i = 0; i < pcm_data.size(); i += half_window) {
-    const std::vector<double> data_block(pcm_data.begin() + int(i), pcm_data.begin() + int(i) + sample_window);
-    std::vector<double> ys(sample_window);
+  for (size_t b = 0; b < spectrogram.num_blocks; ++b) {
+    if (spectrogram.active[b] == 0) { continue; }
 
-    for (size_t j = 0; j < window.size(); ++j) { ys[j] = data_block[j] * window[j]; }
+    const size_t i = b * hop;
+    const T *block = pcm_data.data() + i;// NOLINT
 
-    const VecComplexDoub hs_vec = FFT::convertToFrequencyDomain(ys);
-    std::vector<std::pair<int, double>> magnitudes(hs_vec.size());
-    for (size_t x = 0; x < hs_vec.size(); ++x) { magnitudes[x] = std::make_pair(int(x), std::abs(hs_vec[x])); }// NOLINT
-    matrix.push_back(magnitudes);
+    if (i + sample_window > pcm_data.size()) {
+      std::ranges::fill(padded_block, T(0));
+      std::copy(block, pcm_data.data() + pcm_data.size(), padded_block.begin());// NOLINT
+      block = padded_block.data();
+    }
+
+    FingerprintWindow<T>::apply(block, ys.data());
+    FFTW::execute(plan.get());
+
+    // 4. |X|^2 straight from the FFTW output, the peak picking only needs the ordering
+    powerSpectrum(reinterpret_cast<const T *>(hs.data()), spectrogram.power.data() + (b * num_bins), num_bins);// NOLINT
   }
 
-  return matrix;
+  return spectrogram;
 }
 
-void AFS::filtering(Matrix &matrix)
+template<typename T> Matrix AFS::filtering(const PowerSpectrogram<T> &spectrogram)
 {
   Matrix filtered_matrix;
+  filtered_matrix.reserve(spectrogram.num_blocks);
+
+  for (size_t b = 0; b < spectrogram.num_blocks; ++b) {
+    // Gated blocks keep an empty row, the row index is the block's time.
+    if (spectrogram.active[b] == 0) {
+      filtered_matrix.emplace_back();
+      continue;
+    }
+
+    const std::span<const T> power = spectrogram.row(b);
 
-  for (auto &bins : matrix) {
     // 1. Divide the bins int logarithmic bands
-    std::vector<std::pair<int, double>> very_low_sound_bins(bins.begin(), bins.begin() + 10);
-    std::vector<std::pair<int, double>> low_sound_bins(bins.begin() + 10, bins.begin() + 20);
-    std::vector<std::pair<int, double>> low_mid_sound_bins(bins.begin() + 20, bins.begin() + 40);
-    std::vector<std::pair<int, double>> mid_sound_bins(bins.begin() + 40, bins.begin() + 80);
-    std::vector<std::pair<int, double>> mid_high_sound_bins(bins.begin() + 80, bins.begin() + 160);
-    std::vector<std::pair<int, double>> high_sound_bins(bins.begin() + 160, bins.begin() + 513);
-
-    // 2. Keep the strongest bin in each band
-    std::vector<std::pair<int, double>> strongest_bins;
-    auto cmp_fn = [](const std::pair<int, double> &a, const std::pair<int, double> &b) {// NOLINT
-      return a.second < b.second;
-    };
-    strongest_bins.push_back(*std::ranges::max_element(very_low_sound_bins, cmp_fn));
-    strongest_bins.push_back(*std::ranges::max_element(low_sound_bins, cmp_fn));
-    strongest_bins.push_back(*std::ranges::max_element(low_mid_sound_bins, cmp_fn));
-    strongest_bins.push_back(*std::ranges::max_element(mid_sound_bins, cmp_fn));
-    strongest_bins.push_back(*std::ranges::max_element(mid_high_sound_bins, cmp_fn));
-    strongest_bins.push_back(*std::ranges::max_element(high_sound_bins, cmp_fn));
-
-    // 3. Compute the average of these 6 powerful bins
-    double sum = 0.0;
-    for (const auto &bin : strongest_bins) { sum += bin.second; }
-    const double average = sum / 6;
+    // 2. Keep the strongest bin in each band, the power ranks them like the magnitude
+    const auto strongest_idx = FingerprintBands::argmaxPerBand(power);
+
+    // 3. Compute the average of these 6 powerful bins, only they need a square root
+    std::array<T, FingerprintBands::NUM_BANDS> strongest_amps{};
+    T sum = 0;
+    for (size_t j = 0; j < strongest_idx.size(); ++j) {
+      strongest_amps[j] = std::sqrt(power[strongest_idx[j]]);
+      sum += strongest_amps[j];
+    }
+    const T average = sum / T(FingerprintBands::NUM_BANDS);
 
     // 4. Keep the bins that are above the mean
-    const double coeff = 1.2;
-    const double threshold = average * coeff;
+    const T coeff = T(1.2);
+    const T threshold = average * coeff;
     std::vector<std::pair<int, double>> filtered_strongest_bins;
 
-    for (const auto &val : strongest_bins) {
-      if (val.second > threshold) { filtered_strongest_bins.push_back(val); }
+    for (size_t j = 0; j < strongest_idx.size(); ++j) {
+      if (strongest_amps[j] > threshold) { filtered_strongest_bins.emplace_back(int(strongest_idx[j]), strongest_amps[j]); }
     }
 
     filtered_matrix.push_back(filtered_strongest_bins);
   }
 
-  matrix.swap(filtered_matrix);
+  return filtered_matrix;
 }
 
-Fingerprint AFS::generateFingerprints(Matrix &matrix, std::optional<long long> rsong_id)
+Fingerprint AFS::generateFingerprints(const Matrix &matrix, const FingerprintConfig &config)
 {
-  // tuple -> index, time, bin
-  std::vector<std::tuple<int, int, int>> points;
+  struct Peak
+  {
+    uint32_t time;
+    uint32_t bin;
+  };
+
+  // All peaks in time order, the pairing below walks this one array in place.
+  std::vector<Peak> peaks;
+  size_t num_peaks = 0;
+  for (const auto &bins : matrix) { num_peaks += bins.size(); }
+  peaks.reserve(num_peaks);
 
-  int index = 0;
   for (size_t i = 0; i < matrix.size(); ++i) {
-    int current_time = static_cast<int>(double(i) * TIME_STEP * 1000);
-    std::ranges::for_each(matrix[i], [&](std::pair<int, double> &bin) {
-      points.emplace_back(index, current_time, bin.first);
-      index++;
-    });
+    const auto current_time = static_cast<uint32_t>(double(i) * config.time_step * 1000);
+    for (const auto &bin : matrix[i]) { peaks.push_back({ current_time, uint32_t(bin.first) }); }
   }
 
   // Fingerprint database blueprint
-  std::unordered_map<uint32_t, std::vector<uint64_t>> fingerprint_table;
+  Fingerprint fingerprints;
+  fingerprints.reserve(num_peaks * config.fan_out);
+
+  // An anchor needs a full target zone after it.
+  const size_t zone_span = size_t(config.anchor_offset) + config.fan_out;
+  const uint32_t max_time_delta_ms = config.maxTimeDeltaMs();
 
-  for (size_t idx = 0; idx < points.size(); ++idx) {
-    if (idx + 3 >= points.size()) { break; }
-    if (idx + 3 + 4 >= points.size()) { break; }
+  for (size_t idx = 0; idx + zone_span <= peaks.size(); ++idx) {
+    const Peak &anchor = peaks[idx];
 
-    auto anchor_point = points[idx];
-    const size_t starting_freq_idx = idx + 3;
-    const std::vector<std::tuple<int, int, int>> target_zone(
-      points.begin() + int(starting_freq_idx), points.begin() + int(starting_freq_idx) + 5);
+    uint32_t paired = 0;
+    for (size_t j = idx + config.anchor_offset; j < peaks.size() && paired < config.fan_out; ++j) {
+      const Peak &point = peaks[j];
+      const uint32_t delta_time = point.time - anchor.time;
 
-    for (const auto &point : target_zone) {
-      const int delta_time = std::get<1>(point) - std::get<1>(anchor_point);
+      // Peaks are in time order, none further on can be in the zone either.
+      if (delta_time > max_time_delta_ms) { break; }
+      if (!config.inTargetZone(delta_time, anchor.bin, point.bin)) { continue; }
 
-      // Packing into one value
-      uint16_t freq_anchor = std::get<2>(anchor_point) & NINE_BITS_MASK;// NOLINT
-      uint16_t freq_point = std::get<2>(point) & NINE_BITS_MASK;// NOLINT
-      uint16_t delta_bits = delta_time & FOURTEEN_BITS_MASK;// NOLINT
+      fingerprints.push_back({ config.makeAddress(anchor.bin, point.bin, delta_time), anchor.time });
+      ++paired;
+    }
+  }
 
-      uint32_t address = 0;
-      address |= freq_anchor;
-      address |= (static_cast<uint32_t>(freq_point) << 9U);
-      address |= (static_cast<uint32_t>(delta_bits) << 18U);
+  deduplicate(fingerprints, config.dedupe_tolerance_ms);
 
-      uint64_t couple = 0;
-      const uint32_t time_of_anchor = static_cast<uint32_t>(std::get<1>(anchor_point)) & THIRTY_TWO_BITS_MASK;
-      if (rsong_id.has_value()) {
-        const uint32_t song_id = static_cast<uint64_t>(rsong_id.value()) & THIRTY_TWO_BITS_MASK;
+  return fingerprints;
+}
 
-        couple |= time_of_anchor;
-        couple |= (static_cast<uint64_t>(song_id) << 32U);
-      } else {
-        couple |= time_of_anchor;
-      }
+void AFS::deduplicate(Fingerprint &fingerprints, uint32_t tolerance_ms)
+{
+  // Sort-unique: a repeated address is dropped when its anchor lies within the tolerance
+  // of the last kept entry of that address. A tolerance of 0 only drops exact duplicates.
+  std::ranges::sort(fingerprints, [](const FingerprintEntry &a, const FingerprintEntry &b) {
+    return std::pair(a.address, a.anchor_time) < std::pair(b.address, b.anchor_time);
+  });
 
-      if (fingerprint_table.contains(address)) {
-        fingerprint_table[address].push_back(couple);
-      } else {
-        fingerprint_table[address] = { couple };
-      }
+  size_t kept = 0;
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    const FingerprintEntry &entry = fingerprints[i];
+    if (kept > 0 && fingerprints[kept - 1].address == entry.address
+        && entry.anchor_time - fingerprints[kept - 1].anchor_time <= tolerance_ms) {
+      continue;
     }
+    fingerprints[kept++] = entry;
   }
 
-  return fingerprint_table;
+  fingerprints.resize(kept);
 }
 
 }// namespace afs
@@ -1,25 +1,115 @@
 #include <afsproject/audio_engine.h>
 #include <afsproject/audio_file.h>
 #include <afsproject/flac_file.h>
+#include <afsproject/pipe_audio_file.h>
 #include <afsproject/wave_file.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace afs {
 
-std::unique_ptr<IAudioFile> AudioEngine::loadAudioFile(const std::string &file_path)
+namespace {
+
+  bool readHeader(const std::string &file_path, std::vector<uint8_t> &header)
+  {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file) { return false; }
+
+    header.resize(PROBE_SIZE);
+    file.read(reinterpret_cast<char *>(header.data()), std::streamsize(header.size()));// NOLINT
+    header.resize(size_t(file.gcount()));
+
+    return true;
+  }
+
+  bool hasMagic(std::span<const uint8_t> header, size_t offset, std::string_view magic)
+  {
+    return header.size() >= offset + magic.size() && std::ranges::equal(header.subspan(offset, magic.size()), magic);
+  }
+
+}// namespace
+
+bool isWaveHeader(std::span<const uint8_t> header) { return hasMagic(header, 0, "RIFF") && hasMagic(header, 8, "WAVE"); }// NOLINT
+
+bool isFlacHeader(std::span<const uint8_t> header) { return hasMagic(header, 0, "fLaC"); }
+
+AudioEngine::AudioEngine()
+{
+  // WAV files are mapped rather than read, samples are decoded window by window
+  // when the fingerprinting pipeline pulls them.
+  registerDecoder({ "wav", &isWaveHeader, [](const std::string &file_path) -> std::unique_ptr<IAudioFile> {
+                     auto file = std::make_unique<WaveFile>();
+                     if (file->open(file_path)) { return file; }
+                     return nullptr;
+                   },
+    &WaveFile::scan });
+
+  registerDecoder({ "flac", &isFlacHeader, [](const std::string &file_path) -> std::unique_ptr<IAudioFile> {
+                     auto file = std::make_unique<FlacFile>();
+                     if (file->load(file_path)) { return file; }
+                     return nullptr;
+                   },
+    &FlacFile::scan });
+}
+
+void AudioEngine::registerDecoder(AudioDecoder decoder) { m_decoders.push_back(std::move(decoder)); }
+
+const AudioDecoder *AudioEngine::probe(std::span<const uint8_t> header) const
 {
-  // NOTE: Using file extensions to determine audio file types.
-  // TODO: Use file magic bytes to robustly determine the file type.
-
-  if (file_path.ends_with(".wav")) {
-    auto file = std::make_unique<WaveFile>();
-    if (file->load(file_path)) { return file; }
-  } else if (file_path.ends_with(".flac")) {
-    auto file = std::make_unique<FlacFile>();
-    if (file->load(file_path)) { return file; }
+  const auto decoder = std::ranges::find_if(m_decoders, [header](const AudioDecoder &d) { return d.probe(header); });
+  return decoder == m_decoders.end() ? nullptr : &*decoder;
+}
+
+const AudioDecoder *AudioEngine::probe(const std::string &file_path) const
+{
+  std::vector<uint8_t> header;
+  if (!readHeader(file_path, header)) { return nullptr; }
+
+  return probe(header);
+}
+
+std::unique_ptr<IAudioFile> AudioEngine::loadAudioFile(const std::string &file_path) const
+{
+  if (file_path == "-") { return loadAudioStream(file_path); }
+
+  std::vector<uint8_t> header;
+  if (!readHeader(file_path, header)) {
+    std::cerr << "Failed to open file: " << file_path << "\n";
+    return nullptr;
+  }
+
+  // The content decides, not the extension, so a misnamed file still loads.
+  const AudioDecoder *decoder = probe(header);
+  if (decoder == nullptr) {
+    std::cerr << "Unsupported audio format: " << file_path << "\n";
+    return nullptr;
   }
 
+  return decoder->open(file_path);
+}
+
+bool AudioEngine::scanAudioFile(const std::string &file_path, AudioInfo &info) const
+{
+  const AudioDecoder *decoder = probe(file_path);
+  if (decoder == nullptr || !decoder->scan) { return false; }
+
+  return decoder->scan(file_path, info);
+}
+
+std::unique_ptr<IAudioFile> AudioEngine::loadAudioStream(const std::string &source, const RawPCMFormat &raw_format)
+{
+  auto file = std::make_unique<PipeAudioFile>(raw_format);
+  if (file->load(source)) { return file; }
+
   return nullptr;
 }
 
@@ -0,0 +1,104 @@
+#include <afsproject/audio_file.h>
+#include <afsproject/downmix.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace afs {
+
+namespace {
+
+  template<typename T> double normFactor(uint16_t bit_depth)
+  {
+    if constexpr (std::is_floating_point_v<T>) {
+      return 1.0;
+    } else {
+      return 1.0 / double(1ULL << (bit_depth - 1U));
+    }
+  }
+
+  template<typename T> std::vector<double> convertSamples(std::span<const T> samples, double norm_factor)
+  {
+    std::vector<double> out(samples.size());
+
+    // Plain indexed loop so the compiler can vectorize the int -> double conversion.
+    for (size_t i = 0; i < samples.size(); ++i) { out[i] = double(samples[i]) * norm_factor; }
+
+    return out;
+  }
+
+  template<typename T> std::vector<T> downmixBuffer(const PCMBuffer &samples, uint16_t bit_depth, const DownmixMatrix &matrix)
+  {
+    return std::visit(
+      [bit_depth, &matrix](const auto &buffer) -> std::vector<T> {
+        using B = std::decay_t<decltype(buffer)>;
+        if constexpr (std::is_same_v<B, std::monostate>) {
+          return {};
+        } else {
+          using Sample = typename B::value_type;
+          const size_t channels = std::max<size_t>(matrix.getNumChannels(), 1);
+          std::vector<T> out(buffer.size() / channels);
+          downmix(std::span(buffer.data(), buffer.size()), normFactor<Sample>(bit_depth), matrix, std::span(out));
+          return out;
+        }
+      },
+      samples);
+  }
+
+}// namespace
+
+std::vector<double> convertToDouble(const PCMBuffer &samples, uint16_t bit_depth)
+{
+  return std::visit(
+    [bit_depth](const auto &buffer) -> std::vector<double> {
+      using T = std::decay_t<decltype(buffer)>;
+      if constexpr (std::is_same_v<T, std::monostate>) {
+        return {};
+      } else {
+        using Sample = typename T::value_type;
+        return convertSamples(std::span(buffer.data(), buffer.size()), normFactor<Sample>(bit_depth));
+      }
+    },
+    samples);
+}
+
+std::vector<double> downmixToMono(const PCMBuffer &samples, uint16_t bit_depth, const DownmixMatrix &matrix)
+{
+  if (matrix.getNumChannels() <= 1) { return convertToDouble(samples, bit_depth); }
+
+  return downmixBuffer<double>(samples, bit_depth, matrix);
+}
+
+std::vector<double> downmixToMono(std::span<const double> samples, const DownmixMatrix &matrix)
+{
+  if (matrix.getNumChannels() <= 1) { return { samples.begin(), samples.end() }; }
+
+  std::vector<double> out(samples.size() / matrix.getNumChannels());
+  downmix(samples, 1.0, matrix, std::span(out));
+  return out;
+}
+
+std::vector<float> downmixToMonoFloat(const PCMBuffer &samples, uint16_t bit_depth, const DownmixMatrix &matrix)
+{
+  return downmixBuffer<float>(samples, bit_depth, matrix);
+}
+
+size_t getNumStoredSamples(const PCMBuffer &samples)
+{
+  return std::visit(
+    [](const auto &buffer) -> size_t {
+      using T = std::decay_t<decltype(buffer)>;
+      if constexpr (std::is_same_v<T, std::monostate>) {
+        return 0;
+      } else {
+        return buffer.size();
+      }
+    },
+    samples);
+}
+
+}// namespace afs
@@ -0,0 +1,88 @@
+#include <afsproject/crc.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace afs {
+
+namespace {
+
+  constexpr uint8_t CRC8_POLYNOMIAL = 0x07;
+  constexpr uint16_t CRC16_POLYNOMIAL = 0x8005;
+
+  constexpr std::array<uint8_t, 256> makeCrc8Table()
+  {
+    std::array<uint8_t, 256> table{};
+
+    for (size_t byte = 0; byte < table.size(); ++byte) {
+      auto crc = uint8_t(byte);
+      for (int bit = 0; bit < 8; ++bit) {// NOLINT
+        crc = bool(crc & 0x80U) ? uint8_t((crc << 1U) ^ CRC8_POLYNOMIAL) : uint8_t(crc << 1U);// NOLINT
+      }
+      table.at(byte) = crc;
+    }
+
+    return table;
+  }
+
+  // Slice-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes, which
+  // lets eight input bytes be folded into the CRC with eight independent lookups.
+  constexpr std::array<std::array<uint16_t, 256>, 8> makeCrc16Tables()
+  {
+    std::array<std::array<uint16_t, 256>, 8> tables{};
+
+    for (size_t byte = 0; byte < 256; ++byte) {// NOLINT
+      auto crc = uint16_t(byte << 8U);// NOLINT
+      for (int bit = 0; bit < 8; ++bit) {// NOLINT
+        crc = bool(crc & 0x8000U) ? uint16_t((crc << 1U) ^ CRC16_POLYNOMIAL) : uint16_t(crc << 1U);// NOLINT
+      }
+      tables[0].at(byte) = crc;
+    }
+
+    for (size_t k = 1; k < tables.size(); ++k) {
+      for (size_t byte = 0; byte < 256; ++byte) {// NOLINT
+        const uint16_t prev = tables.at(k - 1).at(byte);
+        tables.at(k).at(byte) = uint16_t((prev << 8U) ^ tables[0].at(prev >> 8U));// NOLINT
+      }
+    }
+
+    return tables;
+  }
+
+  constexpr auto CRC8_TABLE = makeCrc8Table();
+  constexpr auto CRC16_TABLES = makeCrc16Tables();
+
+}// namespace
+
+uint8_t crc8(std::span<const uint8_t> data, uint8_t crc)
+{
+  for (const uint8_t byte : data) { crc = CRC8_TABLE[crc ^ byte]; }// NOLINT
+
+  return crc;
+}
+
+uint16_t crc16(std::span<const uint8_t> data, uint16_t crc)
+{
+  const uint8_t *ptr = data.data();
+  size_t len = data.size();
+
+  // NOLINTBEGIN
+  while (len >= 8) {
+    const auto hi = uint8_t((crc >> 8U) ^ ptr[0]);
+    const auto lo = uint8_t((crc & 0xFFU) ^ ptr[1]);
+
+    crc = CRC16_TABLES[7][hi] ^ CRC16_TABLES[6][lo] ^ CRC16_TABLES[5][ptr[2]] ^ CRC16_TABLES[4][ptr[3]]
+          ^ CRC16_TABLES[3][ptr[4]] ^ CRC16_TABLES[2][ptr[5]] ^ CRC16_TABLES[1][ptr[6]] ^ CRC16_TABLES[0][ptr[7]];
+
+    ptr += 8;
+    len -= 8;
+  }
+
+  for (; len > 0; --len, ++ptr) { crc = uint16_t((crc << 8U) ^ CRC16_TABLES[0][(crc >> 8U) ^ *ptr]); }
+  // NOLINTEND
+
+  return crc;
+}
+
+}// namespace afs
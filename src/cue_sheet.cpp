@@ -0,0 +1,136 @@
+#include <afsproject/cue_sheet.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace afs {
+
+namespace {
+
+  constexpr uint64_t CD_FRAMES_PER_SECOND = 75;
+
+  // Rest of the line after the command, without the quotes around it.
+  std::string readValue(std::istringstream &line)
+  {
+    std::string value;
+    std::getline(line >> std::ws, value);
+
+    while (!value.empty() && (value.back() == '\r' || value.back() == ' ')) { value.pop_back(); }
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') { value = value.substr(1, value.size() - 2); }
+
+    return value;
+  }
+
+  // mm:ss:ff with 75 frames a second, the minutes may go past 99 on long images.
+  std::optional<uint64_t> parseMSF(const std::string &time, uint32_t sample_rate)
+  {
+    uint64_t minutes = 0;
+    uint64_t seconds = 0;
+    uint64_t frames = 0;
+    char sep1 = 0;
+    char sep2 = 0;
+
+    std::istringstream stream(time);
+    if (!(stream >> minutes >> sep1 >> seconds >> sep2 >> frames) || sep1 != ':' || sep2 != ':') {
+      return std::nullopt;
+    }
+
+    const uint64_t cd_frames = (((minutes * 60) + seconds) * CD_FRAMES_PER_SECOND) + frames;// NOLINT
+    return (cd_frames * sample_rate) / CD_FRAMES_PER_SECOND;
+  }
+
+}// namespace
+
+std::optional<CueSheet> parseCueSheet(std::istream &input, uint32_t sample_rate)
+{
+  CueSheet cue_sheet;
+  int num_files = 0;
+  std::string line_str;
+
+  while (std::getline(input, line_str)) {
+    std::istringstream line(line_str);
+    std::string command;
+    if (!(line >> command)) { continue; }
+
+    CueTrack *track = cue_sheet.tracks.empty() ? nullptr : &cue_sheet.tracks.back();
+
+    if (command == "FILE") {
+      // Every track has to index into the one decoded stream.
+      if (++num_files > 1) {
+        std::cerr << "Cue sheets spanning several files are not supported.\n";
+        return std::nullopt;
+      }
+    } else if (command == "TRACK") {
+      int number = 0;
+      std::string type;
+      line >> number >> type;
+
+      CueTrack new_track;
+      new_track.number = uint8_t(number);
+      new_track.is_audio = type == "AUDIO";
+      cue_sheet.tracks.push_back(std::move(new_track));
+    } else if (command == "INDEX" && track != nullptr) {
+      int number = 0;
+      std::string time;
+      line >> number >> time;
+
+      const std::optional<uint64_t> sample = parseMSF(time, sample_rate);
+      if (!sample) {
+        std::cerr << "Invalid cue sheet time: " << time << "\n";
+        return std::nullopt;
+      }
+
+      // INDEX 00 only counts when the track has no INDEX 01.
+      if (number == 1 || (number == 0 && track->start_sample == 0)) { track->start_sample = *sample; }
+    } else if (command == "TITLE") {
+      (track != nullptr ? track->title : cue_sheet.title) = readValue(line);
+    } else if (command == "PERFORMER") {
+      (track != nullptr ? track->performer : cue_sheet.performer) = readValue(line);
+    } else if (command == "ISRC" && track != nullptr) {
+      track->isrc = readValue(line);
+    } else if (command == "CATALOG") {
+      cue_sheet.catalog = readValue(line);
+    }
+  }
+
+  if (cue_sheet.tracks.empty()) {
+    std::cerr << "The cue sheet has no tracks.\n";
+    return std::nullopt;
+  }
+
+  return cue_sheet;
+}
+
+std::optional<CueSheet> loadCueFile(const std::string &file_path, uint32_t sample_rate)
+{
+  std::ifstream file(file_path);
+  if (!file) {
+    std::cerr << "Failed to open cue sheet: " << file_path << "\n";
+    return std::nullopt;
+  }
+
+  return parseCueSheet(file, sample_rate);
+}
+
+uint64_t getTrackEnd(const CueSheet &cue_sheet, size_t track_index, uint64_t total_samples)
+{
+  if (track_index + 1 < cue_sheet.tracks.size()) {
+    return std::min(cue_sheet.tracks[track_index + 1].start_sample, total_samples);
+  }
+
+  return cue_sheet.lead_out > 0 ? std::min(cue_sheet.lead_out, total_samples) : total_samples;
+}
+
+size_t countAudioTracks(const CueSheet &cue_sheet)
+{
+  return size_t(std::ranges::count_if(cue_sheet.tracks, [](const CueTrack &track) { return track.is_audio; }));
+}
+
+}// namespace afs
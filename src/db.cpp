@@ -1,5 +1,7 @@
 #include <afsproject/db.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -84,6 +86,11 @@ void SQLiteDB::Statement::bindDouble(int index, double value) { sqlite3_bind_dou
 
 void SQLiteDB::Statement::bindLongLong(int index, long long value) { sqlite3_bind_int64(m_stmt, index, value); }
 
+void SQLiteDB::Statement::bindBlob(int index, const void *data, size_t size)
+{
+  sqlite3_bind_blob64(m_stmt, index, data, sqlite3_uint64(size), SQLITE_TRANSIENT);
+}
+
 int SQLiteDB::Statement::step()
 {
   const int result = sqlite3_step(m_stmt);
@@ -105,6 +112,13 @@ double SQLiteDB::Statement::columnDouble(int index) { return sqlite3_column_doub
 
 long long SQLiteDB::Statement::columnLongLong(int index) { return sqlite3_column_int64(m_stmt, index); }
 
+std::vector<uint8_t> SQLiteDB::Statement::columnBlob(int index)
+{
+  const auto *data = static_cast<const uint8_t *>(sqlite3_column_blob(m_stmt, index));
+  const auto size = size_t(sqlite3_column_bytes(m_stmt, index));
+  return data ? std::vector<uint8_t>(data, data + size) : std::vector<uint8_t>();// NOLINT
+}
+
 void SQLiteDB::Statement::reset() { sqlite3_reset(m_stmt); }
 
 sqlite3 *SQLiteDB::get() const { return m_db.get(); }
@@ -0,0 +1,269 @@
+#include <afsproject/downmix.h>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace afs {
+
+namespace {
+
+  constexpr double MINUS_3DB = 0.70710678118654752;// 1 / sqrt(2)
+  constexpr double MINUS_6DB = 0.5;
+
+  // Gain of one speaker in the ITU-R BS.775 3/2 to 1/0 downmix, positions the
+  // recommendation does not name are treated like their nearest neighbour.
+  double ituGain(uint32_t speaker)
+  {
+    switch (speaker) {
+    case SPEAKER_FRONT_CENTER:
+      return 1.0;
+    case SPEAKER_LOW_FREQUENCY:
+      return 0.0;
+    case SPEAKER_FRONT_LEFT:
+    case SPEAKER_FRONT_RIGHT:
+    case SPEAKER_FRONT_LEFT_OF_CENTER:
+    case SPEAKER_FRONT_RIGHT_OF_CENTER:
+    case SPEAKER_BACK_CENTER:
+      return MINUS_3DB;
+    default:
+      // Back, side and height speakers
+      return MINUS_6DB;
+    }
+  }
+
+  // The channel count is a template parameter so the inner loop is unrolled.
+  template<size_t N, typename S, typename T>
+  void mixFixed(std::span<const S> samples, std::span<const T> gains, size_t first, std::span<T> out)
+  {
+    for (size_t i = first; i < out.size(); ++i) {
+      T sum = 0;
+      for (size_t chn = 0; chn < N; ++chn) { sum += static_cast<T>(samples[(i * N) + chn]) * gains[chn]; }
+      out[i] = sum;
+    }
+  }
+
+  template<typename S, typename T>
+  void mixGeneric(std::span<const S> samples, std::span<const T> gains, size_t first, std::span<T> out)
+  {
+    const size_t channels = gains.size();
+    for (size_t i = first; i < out.size(); ++i) {
+      T sum = 0;
+      for (size_t chn = 0; chn < channels; ++chn) { sum += static_cast<T>(samples[(i * channels) + chn]) * gains[chn]; }
+      out[i] = sum;
+    }
+  }
+
+  template<typename S, typename T>
+  void mixFrames(std::span<const S> samples, std::span<const T> gains, size_t first, std::span<T> out)
+  {
+    switch (gains.size()) {
+    case 1:
+      mixFixed<1>(samples, gains, first, out);
+      break;
+    case 2:
+      mixFixed<2>(samples, gains, first, out);
+      break;
+    case 3:
+      mixFixed<3>(samples, gains, first, out);
+      break;
+    case 4:
+      mixFixed<4>(samples, gains, first, out);
+      break;
+    case 5:// NOLINT
+      mixFixed<5>(samples, gains, first, out);// NOLINT
+      break;
+    case 6:// NOLINT
+      mixFixed<6>(samples, gains, first, out);// NOLINT
+      break;
+    case 7:// NOLINT
+      mixFixed<7>(samples, gains, first, out);// NOLINT
+      break;
+    case 8:// NOLINT
+      mixFixed<8>(samples, gains, first, out);// NOLINT
+      break;
+    default:
+      mixGeneric(samples, gains, first, out);
+      break;
+    }
+  }
+
+#if defined(__AVX2__)
+
+  constexpr size_t AVX2_FRAMES = 8;
+
+  // 16 consecutive samples widened to float.
+  template<typename S> void load16(const S *src, __m256 &low, __m256 &high)
+  {
+    if constexpr (std::is_same_v<S, float>) {
+      low = _mm256_loadu_ps(src);
+      high = _mm256_loadu_ps(src + 8);// NOLINT
+    } else if constexpr (std::is_same_v<S, int32_t>) {
+      low = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)));// NOLINT
+      high = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 8)));// NOLINT
+    } else {
+      const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));// NOLINT
+      low = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(words)));
+      high = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(words, 1)));
+    }
+  }
+
+  // One channel of 8 frames, `offsets` holds the index of each frame's sample relative to `src`.
+  template<typename S> __m256 gatherChannel(const S *src, __m256i offsets)
+  {
+    if constexpr (std::is_same_v<S, float>) {
+      return _mm256_i32gather_ps(src, offsets, 4);
+    } else if constexpr (std::is_same_v<S, int32_t>) {
+      return _mm256_cvtepi32_ps(_mm256_i32gather_epi32(reinterpret_cast<const int *>(src), offsets, 4));// NOLINT
+    } else {
+      // There is no 16 bit gather, the 32 bits at each sample are loaded and the low half sign extended.
+      const __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int *>(src), offsets, 2);// NOLINT
+      return _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(words, 16), 16));// NOLINT
+    }
+  }
+
+  // Mixes 8 frames per iteration and returns how many frames it covered, the scalar loop does the rest.
+  template<typename S> size_t mixAVX2(std::span<const S> samples, std::span<const float> gains, std::span<float> out)
+  {
+    const size_t channels = gains.size();
+    const size_t num_frames = out.size();
+    size_t i = 0;
+
+    if (channels == 1) {
+      const __m256 gain = _mm256_set1_ps(gains[0]);
+      for (; i + (2 * AVX2_FRAMES) <= num_frames; i += 2 * AVX2_FRAMES) {
+        __m256 low;
+        __m256 high;
+        load16(&samples[i], low, high);
+        _mm256_storeu_ps(&out[i], _mm256_mul_ps(low, gain));
+        _mm256_storeu_ps(&out[i + AVX2_FRAMES], _mm256_mul_ps(high, gain));
+      }
+    } else if (channels == 2) {
+      // L R L R ... weighted, then the pairs are added up and put back in frame order.
+      const __m256 gain = _mm256_setr_ps(gains[0], gains[1], gains[0], gains[1], gains[0], gains[1], gains[0], gains[1]);
+      for (; i + AVX2_FRAMES <= num_frames; i += AVX2_FRAMES) {
+        __m256 low;
+        __m256 high;
+        load16(&samples[2 * i], low, high);
+        const __m256 sums = _mm256_hadd_ps(_mm256_mul_ps(low, gain), _mm256_mul_ps(high, gain));
+        _mm256_storeu_ps(&out[i], _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), 0b11011000)));// NOLINT
+      }
+    } else {
+      const auto stride = int(channels);
+      const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+
+      // The 16 bit gather reads one sample past the last one, so the final frame is left to the scalar loop.
+      for (; i + AVX2_FRAMES < num_frames; i += AVX2_FRAMES) {
+        const S *frames = &samples[i * channels];
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t chn = 0; chn < channels; ++chn) {
+          sum = _mm256_add_ps(sum, _mm256_mul_ps(gatherChannel(frames + chn, offsets), _mm256_set1_ps(gains[chn])));
+        }
+        _mm256_storeu_ps(&out[i], sum);
+      }
+    }
+
+    return i;
+  }
+
+#endif
+
+}// namespace
+
+uint32_t defaultChannelMask(uint16_t num_channels)
+{
+  constexpr uint32_t stereo = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+  constexpr uint32_t quad = stereo | SPEAKER_BACK_LEFT | SPEAKER_BACK_RIGHT;
+  constexpr uint32_t surround_51 = quad | SPEAKER_FRONT_CENTER | SPEAKER_LOW_FREQUENCY;
+
+  switch (num_channels) {
+  case 1:
+    return SPEAKER_FRONT_CENTER;
+  case 2:
+    return stereo;
+  case 3:
+    return stereo | SPEAKER_FRONT_CENTER;
+  case 4:
+    return quad;
+  case 5:// NOLINT
+    return quad | SPEAKER_FRONT_CENTER;
+  case 6:// NOLINT
+    return surround_51;
+  case 7:// NOLINT
+    return stereo | SPEAKER_FRONT_CENTER | SPEAKER_LOW_FREQUENCY | SPEAKER_BACK_CENTER | SPEAKER_SIDE_LEFT
+           | SPEAKER_SIDE_RIGHT;
+  case 8:// NOLINT
+    return surround_51 | SPEAKER_SIDE_LEFT | SPEAKER_SIDE_RIGHT;
+  default:
+    return 0;
+  }
+}
+
+DownmixMatrix makeDownmixMatrix(uint16_t num_channels, uint32_t channel_mask)
+{
+  if (num_channels == 0 || num_channels > MAX_DOWNMIX_CHANNELS) { return averageDownmixMatrix(num_channels); }
+  if (std::popcount(channel_mask) != num_channels) { channel_mask = defaultChannelMask(num_channels); }
+
+  // 1. One gain per speaker, lowest bit first as that is the order of the channels
+  DownmixMatrix matrix;
+  double sum = 0.0;
+  for (uint32_t mask = channel_mask; mask != 0; mask &= mask - 1) {
+    matrix.gains.push_back(ituGain(uint32_t(1) << std::countr_zero(mask)));
+    sum += matrix.gains.back();
+  }
+
+  // A lone LFE channel has nothing else to mix.
+  if (sum == 0.0) { return averageDownmixMatrix(num_channels); }
+
+  // 2. Scale so a signal common to all channels keeps its level
+  for (double &gain : matrix.gains) { gain /= sum; }
+
+  return matrix;
+}
+
+DownmixMatrix averageDownmixMatrix(uint16_t num_channels)
+{
+  if (num_channels == 0) { return {}; }
+
+  return { std::vector<double>(num_channels, 1.0 / double(num_channels)) };
+}
+
+template<typename S, typename T>
+void downmix(std::span<const S> samples, double norm_factor, const DownmixMatrix &matrix, std::span<T> out)
+{
+  const size_t channels = matrix.getNumChannels();
+  if (channels == 0) { return; }
+
+  const std::span<T> frames = out.first(std::min(out.size(), samples.size() / channels));
+
+  // The normalization is folded into the gains, one multiply per sample.
+  std::vector<T> gains(channels);
+  for (size_t chn = 0; chn < channels; ++chn) { gains[chn] = static_cast<T>(matrix.gains[chn] * norm_factor); }
+
+  size_t first = 0;
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<T, float> && !std::is_same_v<S, double>) {
+    first = mixAVX2(samples, std::span<const float>(gains), frames);
+  }
+#endif
+
+  mixFrames(samples, std::span<const T>(gains), first, frames);
+}
+
+template void downmix(std::span<const int16_t>, double, const DownmixMatrix &, std::span<float>);
+template void downmix(std::span<const int32_t>, double, const DownmixMatrix &, std::span<float>);
+template void downmix(std::span<const float>, double, const DownmixMatrix &, std::span<float>);
+template void downmix(std::span<const double>, double, const DownmixMatrix &, std::span<float>);
+template void downmix(std::span<const int16_t>, double, const DownmixMatrix &, std::span<double>);
+template void downmix(std::span<const int32_t>, double, const DownmixMatrix &, std::span<double>);
+template void downmix(std::span<const float>, double, const DownmixMatrix &, std::span<double>);
+template void downmix(std::span<const double>, double, const DownmixMatrix &, std::span<double>);
+
+}// namespace afs
@@ -0,0 +1,162 @@
+#include <afsproject/db.h>
+#include <afsproject/fingerprint_config.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+
+namespace afs {
+
+bool FingerprintConfig::isValid() const
+{
+  return fan_out > 0 && freq_bits > 0 && time_delta_bits > 0 && (2 * freq_bits) + time_delta_bits <= 32
+         && time_step > 0.0 && time_quantum_ms > 0
+         && max_time_delta_ms <= timeDeltaRangeMs() && min_time_delta_ms <= maxTimeDeltaMs()
+         && (peak_extractor == PeakExtractor::BandMax || peak_extractor == PeakExtractor::LocalMax)
+         && peaks_per_second > 0.0 && stop_hash_max_fraction > 0.0
+         && (fingerprint_mode == FingerprintMode::Constellation || fingerprint_mode == FingerprintMode::SubFingerprint)
+         && sub_fingerprint_hop > 0 && max_bit_error_rate > 0.0 && max_bit_error_rate <= 0.5;// NOLINT
+}
+
+uint32_t FingerprintConfig::timeDeltaRangeMs() const
+{
+  const uint64_t range_ms = (uint64_t(1) << std::min<uint32_t>(time_delta_bits, 32)) * time_quantum_ms;
+  return uint32_t(std::min<uint64_t>(range_ms - 1, UINT32_MAX));
+}
+
+uint32_t FingerprintConfig::maxTimeDeltaMs() const
+{
+  return max_time_delta_ms == 0 ? timeDeltaRangeMs() : std::min(max_time_delta_ms, timeDeltaRangeMs());
+}
+
+bool FingerprintConfig::inTargetZone(uint32_t time_delta_ms, uint32_t freq_anchor, uint32_t freq_point) const
+{
+  if (time_delta_ms < min_time_delta_ms || time_delta_ms > maxTimeDeltaMs()) { return false; }
+
+  const uint32_t freq_delta = freq_anchor > freq_point ? freq_anchor - freq_point : freq_point - freq_anchor;
+  return max_freq_delta == 0 || freq_delta <= max_freq_delta;
+}
+
+uint32_t FingerprintConfig::makeAddress(uint32_t freq_anchor, uint32_t freq_point, uint32_t time_delta_ms) const
+{
+  const uint32_t freq_mask = (1U << freq_bits) - 1U;
+  const uint32_t delta_mask = (1U << time_delta_bits) - 1U;
+  const uint32_t delta = time_delta_ms / time_quantum_ms;
+
+  uint32_t address = 0;
+  address |= freq_anchor & freq_mask;
+  address |= (freq_point & freq_mask) << freq_bits;
+  address |= (delta & delta_mask) << (2U * freq_bits);
+
+  return address;
+}
+
+FingerprintConfig loadFingerprintConfig(SQLiteDB &db)// NOLINT
+{
+  FingerprintConfig config;
+
+  const std::string select_sql =
+    "SELECT fan_out, anchor_offset, min_time_delta_ms, max_time_delta_ms, max_freq_delta, freq_bits, "
+    "time_delta_bits, time_step, time_quantum_ms, peak_extractor, peak_time_radius, peak_freq_radius, "
+    "peaks_per_second, stop_hash_max_fraction, stop_hash_min_songs, dedupe_tolerance_ms, silence_threshold_db, "
+    "fingerprint_mode, sub_fingerprint_hop, max_bit_error_rate FROM fingerprint_config WHERE id = 1;";
+
+  try {
+    SQLiteDB::Statement stmt(db, select_sql);
+    if (stmt.step() != SQLITE_ROW) { return config; }
+
+    FingerprintConfig stored;
+    stored.fan_out = uint32_t(stmt.columnInt(0));
+    stored.anchor_offset = uint32_t(stmt.columnInt(1));
+    stored.min_time_delta_ms = uint32_t(stmt.columnInt(2));
+    stored.max_time_delta_ms = uint32_t(stmt.columnInt(3));
+    stored.max_freq_delta = uint32_t(stmt.columnInt(4));
+    stored.freq_bits = uint8_t(stmt.columnInt(5));
+    stored.time_delta_bits = uint8_t(stmt.columnInt(6));
+    stored.time_step = stmt.columnDouble(7);
+    stored.time_quantum_ms = uint32_t(stmt.columnInt(8));// NOLINT
+    stored.peak_extractor = PeakExtractor(stmt.columnInt(9));// NOLINT
+    stored.peak_time_radius = uint32_t(stmt.columnInt(10));// NOLINT
+    stored.peak_freq_radius = uint32_t(stmt.columnInt(11));// NOLINT
+    stored.peaks_per_second = stmt.columnDouble(12);// NOLINT
+    stored.stop_hash_max_fraction = stmt.columnDouble(13);// NOLINT
+    stored.stop_hash_min_songs = uint32_t(stmt.columnInt(14));// NOLINT
+    stored.dedupe_tolerance_ms = uint32_t(stmt.columnInt(15));// NOLINT
+    stored.silence_threshold_db = stmt.columnDouble(16);// NOLINT
+    stored.fingerprint_mode = FingerprintMode(stmt.columnInt(17));// NOLINT
+    stored.sub_fingerprint_hop = uint32_t(stmt.columnInt(18));// NOLINT
+    stored.max_bit_error_rate = stmt.columnDouble(19);// NOLINT
+
+    if (!stored.isValid()) {
+      std::cerr << "Ignoring invalid fingerprint config in the database, using the defaults.\n";
+      return config;
+    }
+
+    config = stored;
+  } catch (const SQLiteException &e) {
+    // A catalogue from before the config was stored, it was built with the defaults.
+    std::cerr << "Could not read the fingerprint config, using the defaults.\n" << e.what() << "\n";
+  }
+
+  return config;
+}
+
+bool hasFingerprintConfig(SQLiteDB &db)// NOLINT
+{
+  try {
+    SQLiteDB::Statement stmt(db, "SELECT 1 FROM fingerprint_config WHERE id = 1;");
+    return stmt.step() == SQLITE_ROW;
+  } catch (const SQLiteException &e) {
+    std::cerr << "Could not read the fingerprint config.\n" << e.what() << "\n";
+  }
+
+  return false;
+}
+
+bool storeFingerprintConfig(SQLiteDB &db, const FingerprintConfig &config)// NOLINT
+{
+  if (!config.isValid()) {
+    std::cerr << "Refusing to store an invalid fingerprint config.\n";
+    return false;
+  }
+
+  const std::string upsert_sql =
+    "INSERT OR REPLACE INTO fingerprint_config (id, fan_out, anchor_offset, min_time_delta_ms, max_time_delta_ms, "
+    "max_freq_delta, freq_bits, time_delta_bits, time_step, time_quantum_ms, peak_extractor, peak_time_radius, "
+    "peak_freq_radius, peaks_per_second, stop_hash_max_fraction, stop_hash_min_songs, dedupe_tolerance_ms, "
+    "silence_threshold_db, fingerprint_mode, sub_fingerprint_hop, max_bit_error_rate) VALUES (1, ?, ?, ?, ?, ?, ?, ?, "
+    "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+  try {
+    SQLiteDB::Statement stmt(db, upsert_sql);
+    stmt.bindLongLong(1, config.fan_out);
+    stmt.bindLongLong(2, config.anchor_offset);
+    stmt.bindLongLong(3, config.min_time_delta_ms);
+    stmt.bindLongLong(4, config.max_time_delta_ms);
+    stmt.bindLongLong(5, config.max_freq_delta);
+    stmt.bindInt(6, config.freq_bits);
+    stmt.bindInt(7, config.time_delta_bits);
+    stmt.bindDouble(8, config.time_step);
+    stmt.bindLongLong(9, config.time_quantum_ms);// NOLINT
+    stmt.bindInt(10, int(config.peak_extractor));// NOLINT
+    stmt.bindLongLong(11, config.peak_time_radius);// NOLINT
+    stmt.bindLongLong(12, config.peak_freq_radius);// NOLINT
+    stmt.bindDouble(13, config.peaks_per_second);// NOLINT
+    stmt.bindDouble(14, config.stop_hash_max_fraction);// NOLINT
+    stmt.bindLongLong(15, config.stop_hash_min_songs);// NOLINT
+    stmt.bindLongLong(16, config.dedupe_tolerance_ms);// NOLINT
+    stmt.bindDouble(17, config.silence_threshold_db);// NOLINT
+    stmt.bindInt(18, int(config.fingerprint_mode));// NOLINT
+    stmt.bindLongLong(19, config.sub_fingerprint_hop);// NOLINT
+    stmt.bindDouble(20, config.max_bit_error_rate);// NOLINT
+    stmt.step();
+  } catch (const SQLiteException &e) {
+    std::cerr << "Failed to store the fingerprint config.\n" << e.what() << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+}// namespace afs
@@ -0,0 +1,213 @@
+#include <afsproject/flac_metadata.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace afs {
+
+namespace {
+
+  // Bounds checked cursor over a block body, every read fails once the body runs out.
+  class BlockCursor// NOLINT
+  {
+  public:
+    explicit BlockCursor(std::span<const uint8_t> block) : m_block(block) {}
+
+    std::optional<uint32_t> readBigEndian32()
+    {
+      if (m_block.size() - m_pos < 4) { return std::nullopt; }
+
+      const uint32_t value = (uint32_t(m_block[m_pos]) << 24U) | (uint32_t(m_block[m_pos + 1]) << 16U)// NOLINT
+                             | (uint32_t(m_block[m_pos + 2]) << 8U) | uint32_t(m_block[m_pos + 3]);// NOLINT
+      m_pos += 4;
+      return value;
+    }
+
+    // Vorbis comments are the one little endian structure in FLAC.
+    std::optional<uint32_t> readLittleEndian32()
+    {
+      if (m_block.size() - m_pos < 4) { return std::nullopt; }
+
+      const uint32_t value = uint32_t(m_block[m_pos]) | (uint32_t(m_block[m_pos + 1]) << 8U)// NOLINT
+                             | (uint32_t(m_block[m_pos + 2]) << 16U) | (uint32_t(m_block[m_pos + 3]) << 24U);// NOLINT
+      m_pos += 4;
+      return value;
+    }
+
+    std::optional<std::span<const uint8_t>> readBytes(uint32_t length)
+    {
+      if (m_block.size() - m_pos < length) { return std::nullopt; }
+
+      const auto bytes = m_block.subspan(m_pos, length);
+      m_pos += length;
+      return bytes;
+    }
+
+    std::optional<std::string_view> readString(uint32_t length)
+    {
+      const auto bytes = readBytes(length);
+      if (!bytes) { return std::nullopt; }
+
+      return std::string_view(reinterpret_cast<const char *>(bytes->data()), bytes->size());// NOLINT
+    }
+
+  private:
+    std::span<const uint8_t> m_block;
+    size_t m_pos{};
+  };
+
+}// namespace
+
+std::optional<VorbisComment> parseVorbisComment(std::span<const uint8_t> block)
+{
+  BlockCursor cursor(block);
+  VorbisComment comment{};
+
+  const auto vendor_length = cursor.readLittleEndian32();
+  if (!vendor_length) { return std::nullopt; }
+
+  const auto vendor = cursor.readString(*vendor_length);
+  const auto num_fields = cursor.readLittleEndian32();
+  if (!vendor || !num_fields) { return std::nullopt; }
+
+  comment.vendor = *vendor;
+
+  for (uint32_t i = 0; i < *num_fields; ++i) {
+    const auto field_length = cursor.readLittleEndian32();
+    if (!field_length) { return std::nullopt; }
+
+    const auto field = cursor.readString(*field_length);
+    if (!field) { return std::nullopt; }
+
+    // Fields without a separator are not valid comments, they are passed over.
+    const size_t equals_pos = field->find('=');
+    if (equals_pos != std::string_view::npos) {
+      comment.fields.emplace_back(field->substr(0, equals_pos), field->substr(equals_pos + 1));
+    }
+  }
+
+  return comment;
+}
+
+std::optional<FlacPicture> parsePicture(std::span<const uint8_t> block)
+{
+  BlockCursor cursor(block);
+  FlacPicture picture{};
+
+  const auto picture_type = cursor.readBigEndian32();
+  const auto mime_length = picture_type ? cursor.readBigEndian32() : std::nullopt;
+  const auto mime_type = mime_length ? cursor.readString(*mime_length) : std::nullopt;
+  const auto desc_length = mime_type ? cursor.readBigEndian32() : std::nullopt;
+  const auto description = desc_length ? cursor.readString(*desc_length) : std::nullopt;
+  if (!description) { return std::nullopt; }
+
+  picture.picture_type = *picture_type;
+  picture.mime_type = *mime_type;
+  picture.description = *description;
+
+  const auto width = cursor.readBigEndian32();
+  const auto height = cursor.readBigEndian32();
+  const auto color_depth = cursor.readBigEndian32();
+  const auto num_colors = cursor.readBigEndian32();
+  const auto data_length = cursor.readBigEndian32();
+  if (!width || !height || !color_depth || !num_colors || !data_length) { return std::nullopt; }
+
+  const auto data = cursor.readBytes(*data_length);
+  if (!data) { return std::nullopt; }
+
+  picture.width = *width;
+  picture.height = *height;
+  picture.color_depth = *color_depth;
+  picture.num_colors = *num_colors;
+  picture.data = *data;
+
+  return picture;
+}
+
+/*
+ * FlacMetadataIndex class implementation
+ */
+
+bool FlacMetadataIndex::open(const std::string &file_path)
+{
+  m_blocks.clear();
+
+  if (!m_mapped_file.open(file_path)) {
+    std::cerr << "Opening that file failed badly or it doesn't exist in this universe: " << file_path << "\n";
+    return false;
+  }
+
+  const std::span<const uint8_t> file = m_mapped_file.data();
+  if (file.size() < 4 || std::memcmp(file.data(), "fLaC", 4) != 0) {
+    std::cerr << "Invalid FLAC marker.\n";
+    return false;
+  }
+
+  // Only the 4 byte block headers are touched, each one tells how far to jump.
+  size_t pos = 4;
+  while (true) {
+    if (file.size() - pos < 4) {
+      std::cerr << "Ran out of data while reading a metadata block header.\n";
+      return false;
+    }
+
+    const bool is_last = (file[pos] & 0x80U) != 0;
+    const auto type = MetadataBlockType(file[pos] & 0x7FU);
+    const uint32_t size = (uint32_t(file[pos + 1]) << 16U) | (uint32_t(file[pos + 2]) << 8U) | uint32_t(file[pos + 3]);
+    pos += 4;
+
+    if (file.size() - pos < size) {
+      std::cerr << "Ran out of data while reading a metadata block.\n";
+      return false;
+    }
+
+    m_blocks.push_back({ type, pos, size });
+    pos += size;
+
+    if (is_last) { break; }
+  }
+
+  m_first_frame_offset = pos;
+
+  return true;
+}
+
+const std::vector<MetadataBlockInfo> &FlacMetadataIndex::getBlocks() const { return m_blocks; }
+
+uint64_t FlacMetadataIndex::getFirstFrameOffset() const { return m_first_frame_offset; }
+
+std::span<const uint8_t> FlacMetadataIndex::getBlockData(const MetadataBlockInfo &block) const
+{
+  return m_mapped_file.data().subspan(size_t(block.offset), block.size);
+}
+
+std::optional<VorbisComment> FlacMetadataIndex::getVorbisComment() const
+{
+  for (const MetadataBlockInfo &block : m_blocks) {
+    if (block.type == MetadataBlockType::VorbisComment) { return parseVorbisComment(getBlockData(block)); }
+  }
+
+  return std::nullopt;
+}
+
+std::vector<FlacPicture> FlacMetadataIndex::getPictures() const
+{
+  std::vector<FlacPicture> pictures;
+
+  for (const MetadataBlockInfo &block : m_blocks) {
+    if (block.type != MetadataBlockType::Picture) { continue; }
+
+    const std::optional<FlacPicture> picture = parsePicture(getBlockData(block));
+    if (picture) { pictures.push_back(*picture); }
+  }
+
+  return pictures;
+}
+
+}// namespace afs
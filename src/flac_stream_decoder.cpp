@@ -0,0 +1,1607 @@
+#include <afsproject/audio_file.h>
+#include <afsproject/crc.h>
+#include <afsproject/flac_predictor.h>
+#include <afsproject/flac_stream_decoder.h>
+#include <afsproject/md5.h>
+#include <afsproject/md5_worker.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <etl/bit_stream.h>
+#include <etl/endianness.h>
+#include <etl/span.h>
+#include <exception>
+#include <fstream>
+#include <ios>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+/*
+ * FlacStreamDecoder class implementation
+ */
+
+bool FlacStreamDecoder::open(const std::string &file_path)
+{
+  m_file.open(file_path, std::ios_base::binary);
+
+  if (!m_file.good()) {
+    std::cerr << "Opening that file failed badly or it doesn't exist in this universe: " << file_path << "\n";
+    return false;
+  }
+
+  return decodeMetadata();
+}
+
+bool FlacStreamDecoder::scan(const std::string &file_path)
+{
+  m_headers_only = true;
+  m_end_of_stream = true;
+
+  return open(file_path);
+}
+
+size_t FlacStreamDecoder::readFrames(std::span<int32_t> out)
+{
+  const size_t num_channels = m_stream_info.num_channels;
+  if (num_channels == 0) { return 0; }
+
+  const size_t capacity = out.size() / num_channels;
+  size_t written = 0;
+
+  while (written < capacity) {
+    if (m_block_pos == m_block_frames && !decodeNextFrame()) { break; }
+
+    const size_t count = std::min(m_block_frames - m_block_pos, capacity - written);
+    std::copy_n(m_block.begin() + long(m_block_pos * num_channels),
+      count * num_channels,
+      out.begin() + long(written * num_channels));
+
+    m_block_pos += count;
+    written += count;
+  }
+
+  return written;
+}
+
+bool FlacStreamDecoder::seek(uint64_t sample)
+{
+  if (m_headers_only || !m_file.is_open()) { return false; }
+
+  if (m_stream_info.total_samples > 0 && sample >= m_stream_info.total_samples) {
+    std::cerr << "Cannot seek to sample " << sample << ", the stream has " << m_stream_info.total_samples << ".\n";
+    return false;
+  }
+
+  m_md5_worker.reset();
+
+  m_file.clear();
+  m_file.seekg(0, std::ios_base::end);
+  uint64_t low = m_first_frame_offset;
+  auto high = uint64_t(m_file.tellg());
+
+  // 1. The seek points on either side of `sample` bound the search, they are sorted by sample.
+  for (const SeekPoint &point : m_seek_points) {
+    const uint64_t offset = m_first_frame_offset + point.offset;
+
+    if (point.sample_number <= sample) {
+      low = offset;
+    } else {
+      high = std::min(high, offset);
+      break;
+    }
+  }
+
+  // 2. Bisect on frame headers, `low` always is a frame that starts at or before `sample`.
+  while (high - low > 2 * m_frame_bound) {
+    const uint64_t middle = low + ((high - low) / 2);
+    const auto frame = findFrameAfter(middle);
+
+    if (frame.has_value() && frame->first < high && frame->second <= sample) {
+      low = frame->first;
+    } else {
+      high = middle;
+    }
+  }
+
+  // 3. Decode up to the frame that holds `sample`, a couple of frames at most.
+  if (!seekToOffset(low)) { return false; }
+
+  while (decodeNextFrame()) {
+    if (sample < m_block_first_sample + m_block_frames) {
+      m_block_pos = sample - std::min(sample, m_block_first_sample);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const StreamInfo &FlacStreamDecoder::getStreamInfo() const { return m_stream_info; }
+
+Metadata FlacStreamDecoder::getMetadata() const { return m_metadata; }
+
+uint32_t FlacStreamDecoder::getChannelMask() const { return m_channel_mask; }
+
+const std::vector<SeekPoint> &FlacStreamDecoder::getSeekPoints() const { return m_seek_points; }
+
+const std::vector<MetadataBlockInfo> &FlacStreamDecoder::getMetadataBlocks() const { return m_metadata_blocks; }
+
+const std::optional<CueSheet> &FlacStreamDecoder::getCueSheet() const { return m_cue_sheet; }
+
+uint64_t FlacStreamDecoder::getFramesDecoded() const { return m_frames_decoded; }
+
+bool FlacStreamDecoder::isEndOfStream() const { return m_end_of_stream && m_block_pos == m_block_frames; }
+
+bool FlacStreamDecoder::failed() const { return m_failed; }
+
+void FlacStreamDecoder::setVerifyMode(VerifyMode mode) { m_verify_mode = mode; }
+
+bool FlacStreamDecoder::decodeMetadata()
+{
+  std::array<uint8_t, 4> flac_marker{};
+  m_file.read(reinterpret_cast<char *>(flac_marker.data()), std::streamsize(flac_marker.size()));
+
+  if (m_file.gcount() != std::streamsize(flac_marker.size()) || std::memcmp(flac_marker.data(), "fLaC", 4) != 0) {
+    std::cerr << "Invalid FLAC marker.\n";
+    return false;
+  }
+
+  bool has_streaminfo = false;
+  std::vector<uint8_t> block_data;
+  m_metadata_blocks.clear();
+
+  // process an unknown amount of metadata blocks
+  while (true) {
+    std::array<uint8_t, 4> block_header{};
+    m_file.read(reinterpret_cast<char *>(block_header.data()), std::streamsize(block_header.size()));
+
+    if (m_file.gcount() != std::streamsize(block_header.size())) {
+      std::cerr << "Ran out of data while reading a metadata block header.\n";
+      return false;
+    }
+
+    const uint8_t is_last = (block_header[0] >> 7U) & 0x01U;
+    const uint8_t block_type = block_header[0] & 0x7FU;
+    const uint32_t block_size =
+      (uint32_t(block_header[1]) << 16U) | (uint32_t(block_header[2]) << 8U) | uint32_t(block_header[3]);
+
+    const auto type = MetadataBlockType(block_type);
+    m_metadata_blocks.push_back({ type, uint64_t(m_file.tellg()), block_size });
+
+    // Cover art can be megabytes, only the blocks decoding depends on are read and a scan
+    // skips the seek table and cue sheet as well.
+    const bool wanted = type == MetadataBlockType::StreamInfo || type == MetadataBlockType::VorbisComment
+                        || type == MetadataBlockType::Forbidden
+                        || (!m_headers_only
+                            && (type == MetadataBlockType::SeekTable || type == MetadataBlockType::CueSheet));
+
+    if (!wanted) {
+      m_file.seekg(std::streamoff(block_size), std::ios_base::cur);
+      if (is_last == 1) { break; }
+      continue;
+    }
+
+    block_data.resize(block_size);
+    m_file.read(reinterpret_cast<char *>(block_data.data()), std::streamsize(block_size));
+
+    if (m_file.gcount() != std::streamsize(block_size)) {
+      std::cerr << "Ran out of data while reading a metadata block.\n";
+      return false;
+    }
+
+    const etl::span<const uint8_t> data_span(block_data.data(), block_data.size());
+    etl::bit_stream_reader reader(data_span, etl::endian::big);
+    m_bits_read = 0;
+
+    switch (static_cast<int>(block_type)) {
+    case 0:
+      if (!decodeStreaminfo(reader, block_size, is_last)) { return false; }
+      has_streaminfo = true;
+      break;
+    case 3:
+      if (!decodeSeektable(reader, block_size)) { return false; }
+      break;
+    case 4:
+      if (!decodeVorbiscomment(block_data)) { return false; }
+      break;
+    case 5:
+      if (!decodeCuesheet(reader, block_size)) { return false; }
+      break;
+    case 127:
+      throw std::runtime_error("This metadata block type is forbidden.\n");
+    default:
+      break;
+    }
+
+    if (is_last == 1) {
+      break;
+    }
+  }
+
+  if (!has_streaminfo) {
+    std::cerr << "The STREAMINFO metadata block is missing.\n";
+    return false;
+  }
+
+  m_first_frame_offset = uint64_t(m_file.tellg());
+
+  if (m_headers_only) { return true; }
+
+  m_frame_bound = computeFrameBound();
+  m_buffer.resize(std::max(2 * m_frame_bound, READ_CHUNK_SIZE));
+  m_buffer_begin = 0;
+  m_buffer_end = 0;
+  m_block.reserve(size_t(m_stream_info.max_block_size) * m_stream_info.num_channels);
+
+  if (m_verify_mode == VerifyMode::Full && m_has_md5_signature) {
+    m_md5_worker = std::make_unique<MD5Worker>(m_stream_info.bit_depth);
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::fillBuffer()
+{
+  if (m_end_of_file || (m_buffer_end - m_buffer_begin) >= m_frame_bound) { return true; }
+
+  // Move what is left of the previous read to the front and top the buffer up.
+  std::copy(m_buffer.begin() + long(m_buffer_begin), m_buffer.begin() + long(m_buffer_end), m_buffer.begin());
+  m_buffer_end -= m_buffer_begin;
+  m_buffer_begin = 0;
+
+  const auto to_read = std::streamsize(m_buffer.size() - m_buffer_end);
+  m_file.read(reinterpret_cast<char *>(m_buffer.data() + m_buffer_end), to_read);// NOLINT
+  const auto bytes_read = m_file.gcount();
+  m_buffer_end += size_t(bytes_read);
+
+  if (bytes_read < to_read) {
+    if (m_file.bad()) {
+      std::cerr << "Uh oh, reading the FLAC file failed midway.\n";
+      return false;
+    }
+    m_end_of_file = true;
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeNextFrame()
+{
+  if (m_end_of_stream) { return false; }
+
+  if (!fillBuffer()) {
+    m_failed = true;
+    m_end_of_stream = true;
+    return false;
+  }
+
+  if (m_buffer_begin >= m_buffer_end) {
+    m_end_of_stream = true;
+
+    if (m_md5_worker && !validateMD5Checksum()) {
+      std::cerr << "⚠️ WARNING: MD5 checksum validation failed.\n";
+      m_failed = true;
+    }
+
+    return false;
+  }
+
+  const etl::span<const uint8_t> data_span(m_buffer.data() + m_buffer_begin, m_buffer_end - m_buffer_begin);
+  etl::bit_stream_reader reader(data_span, etl::endian::big);
+  m_bits_read = 0;
+
+  try {
+    if (!decodeFrame(reader)) {
+      std::cerr << "Failed to decode frame " << m_frames_decoded << "\n";
+      m_failed = true;
+      m_end_of_stream = true;
+      return false;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Exception while decoding frame: " << m_frames_decoded << ": " << e.what() << "\n";
+    m_failed = true;
+    m_end_of_stream = true;
+    return false;
+  }
+
+  // Frames always end byte aligned after the CRC-16 footer.
+  m_buffer_begin += m_bits_read / 8;
+  m_frames_decoded++;
+
+  return true;
+}
+
+size_t FlacStreamDecoder::computeFrameBound() const
+{
+  // Worst case is a frame where every subframe fell back to verbatim coding, the side
+  // channel of a stereo frame takes one more bit per sample than the stream bit depth.
+  constexpr size_t max_subframe_header_size = 5;
+
+  const size_t subframe_size =
+    max_subframe_header_size + ((size_t(m_stream_info.max_block_size) * (m_stream_info.bit_depth + 1U)) + 7U) / 8U;
+  const size_t frame_size = MAX_FRAME_HEADER_SIZE + (m_stream_info.num_channels * subframe_size) + FRAME_FOOTER_SIZE;
+
+  return std::max<size_t>(frame_size, m_stream_info.max_frame_size);
+}
+
+bool FlacStreamDecoder::decodeStreaminfo(etl::bit_stream_reader &reader, uint32_t block_size, uint8_t is_last)
+{
+  if (block_size != 34) { std::cerr << "Invalid STREAMINFO block size: " << block_size << " (expected 34)\n"; }
+
+  // u(16) -> minimum block size
+  auto min_block_size = reader.read<uint16_t>(16).value();
+  m_bits_read += 16;
+  // u(16) -> maximum block size
+  auto max_block_size = reader.read<uint16_t>(16).value();
+  m_bits_read += 16;
+  // u(24) -> minimum frame size
+  auto min_frame_size = reader.read<uint32_t>(24).value();
+  m_bits_read += 24;
+  // u(24) -> maximum frame size
+  auto max_frame_size = reader.read<uint32_t>(24).value();
+  m_bits_read += 24;
+  // u(20) -> sample rate in Hz
+  auto sample_rate = reader.read<uint32_t>(20).value();
+  m_bits_read += 20;
+  // u(3) -> number of channels - 1
+  auto num_channels = static_cast<int>(reader.read<uint8_t>(3).value()) + 1;
+  m_bits_read += 3;
+  // u(5) -> bits per sample - 1
+  auto bits_per_samples = static_cast<int>(reader.read<uint8_t>(5).value()) + 1;
+  m_bits_read += 5;
+  // u(36) -> total number of interchannel samples
+  auto total_samples = reader.read<uint64_t>(36).value();
+  m_bits_read += 36;
+
+  // u(128) -> MD5 checksum -> skip
+  for (size_t i = 0; i < 16; ++i) {
+    auto byte = reader.read<uint8_t>(8).value();
+    m_md5_checksum.at(i) = byte;
+  }
+  m_bits_read += 128;
+
+  m_has_md5_signature = false;
+  for (size_t i = 0; i < 16; ++i) {
+    if (m_md5_checksum.at(i) != 0) {
+      m_has_md5_signature = true;
+      break;
+    }
+  }
+
+  /*
+  std::cout << "STREAMINFO:\n"
+            << " Block size: " << block_size << "\n"
+            << " Min block size: " << min_block_size << "\n"
+            << " Max block size: " << max_block_size << "\n"
+            << " Min frame size: " << min_frame_size << "\n"
+            << " Max frame size: " << max_frame_size << "\n"
+            << " Sample rate: " << sample_rate << "\n"
+            << " Channels: " << num_channels << "\n"
+            << " Bits per sample: " << bits_per_samples << "\n"
+            << " Total samples: " << total_samples << "\n";
+
+  if (m_has_md5_signature) {
+    std::cout << " MD5 signature: " << MD5::toHex(m_md5_checksum) << "\n";
+  } else {
+    std::cout << " MD5 signature: (not set)\n";
+  }*/
+
+  if (min_block_size < 16 || max_block_size < 16 || min_block_size > max_block_size) {
+    std::cerr << "Invalid minimum/maxmimum block sizes.\n";
+    return false;
+  }
+
+  if (min_block_size != max_block_size) {
+    if (is_last == 0) {
+      if (block_size < min_block_size || block_size > max_block_size) {
+        std::cerr << "Invalid block size for not the last frame.\n";
+        return false;
+      }
+    } else if (is_last == 1) {
+      if (block_size > max_block_size) {
+        std::cerr << "Invalid block size for the last frame.\n";
+        return false;
+      }
+    }
+  }
+
+  if (sample_rate == 0) {
+    std::cerr << "Invalid sample rate: " << sample_rate << ".\n";
+    return false;
+  }
+
+  if (num_channels < 1 || num_channels > 8) {
+    std::cerr << "Invalid number of channels: " << num_channels << ".\n";
+    return false;
+  }
+
+  if (bits_per_samples < 4 || bits_per_samples > 32) {
+    std::cerr << "Invalid bits per samples (bit depth): " << bits_per_samples << ".\n";
+    return false;
+  }
+
+  m_stream_info.min_block_size = min_block_size;
+  m_stream_info.max_block_size = max_block_size;
+  m_stream_info.min_frame_size = min_frame_size;
+  m_stream_info.max_frame_size = max_frame_size;
+  m_stream_info.sample_rate = sample_rate;
+  m_stream_info.num_channels = uint8_t(num_channels);
+  m_stream_info.bit_depth = uint8_t(bits_per_samples);
+  m_stream_info.total_samples = total_samples;
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeSeektable(etl::bit_stream_reader &reader, uint32_t block_size)
+{
+  const uint32_t num_of_seek_points = block_size / 18;
+  // std::unordered_map<uint64_t, std::pair<uint64_t, uint16_t>> seek_points;
+
+  m_seek_points.clear();
+  m_seek_points.reserve(num_of_seek_points);
+
+  for (size_t i = 0; i < size_t(num_of_seek_points); ++i) {
+    auto sample_number = reader.read<uint64_t>(64).value();
+    m_bits_read += 64;
+    auto offset = reader.read<uint64_t>(64).value();
+    m_bits_read += 64;
+    auto num_samples = reader.read<uint16_t>(16).value();
+    m_bits_read += 16;
+
+    // Placeholder points are left for an encoder to fill in later.
+    if (sample_number == 0xFFFFFFFFFFFFFFFF) { continue; }
+
+    m_seek_points.push_back({ sample_number, offset, num_samples });
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeVorbiscomment(std::span<const uint8_t> block)
+{
+  const std::optional<VorbisComment> comment = parseVorbisComment(block);
+
+  // Tags are not needed to decode the audio, a broken block only costs us the metadata.
+  if (!comment) {
+    std::cerr << "Malformed VORBIS_COMMENT block, ignoring the tags.\n";
+    return true;
+  }
+
+  auto to_lower = [](std::string_view str) -> std::string {
+    std::string lower(str);
+    std::ranges::transform(lower, lower.begin(), [](unsigned char chr) { return std::tolower(chr); });
+    return lower;
+  };
+
+  for (const auto &[tag, value] : comment->fields) {
+    const std::string lower_tag = to_lower(tag);
+
+    if (lower_tag == "title") { m_metadata.title = value; }
+    if (lower_tag == "artist" || lower_tag == "albumartist") { m_metadata.artist = value; }
+    if (lower_tag == "album") { m_metadata.album = value; }
+    if (lower_tag == "genre") { m_metadata.genre = value; }
+    if (lower_tag == "date") { m_metadata.date = value; }
+
+    if (tag == "WAVEFORMATEXTENSIBLE_CHANNEL_MASK") {
+      m_channel_mask = static_cast<uint32_t>(std::stoul(std::string(value), nullptr, 0));
+    }
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeCuesheet(etl::bit_stream_reader &reader, [[maybe_unused]] uint32_t block_size)
+{
+  CueSheet cue_sheet;
+
+  // u(128 * 8) -> media catalog number (ASCII)
+  for (int i = 0; i < 128; ++i) {
+    auto chr = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    if (chr != 0) { cue_sheet.catalog += static_cast<char>(chr); }
+  }
+
+  // u(64) -> number of lead-in samples
+  [[maybe_unused]] auto num_lead_in = reader.read<uint64_t>(64).value();
+  m_bits_read += 64;
+
+  // u(1) -> if the cuesheet corresponds to CD-DA
+  auto is_cd = static_cast<int>(reader.read<uint8_t>(1).value());
+  m_bits_read += 1;
+
+  // u(7 + 258 * 8) -> reserved (Skip)
+  reader.skip(2071);
+  m_bits_read += 2071;
+
+  // u(8) -> number of tracks in this cuesheet
+  auto num_tracks = static_cast<int>(reader.read<uint8_t>(8).value());
+  m_bits_read += 8;
+
+  //  cuesheet tracks
+  for (int i = 0; i < num_tracks; ++i) {
+    CueTrack track;
+
+    // u(64) -> track offset
+    auto track_offset = reader.read<uint64_t>(64).value();
+    m_bits_read += 64;
+
+    // u(8) -> track number
+    track.number = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    // u(12 * 8) -> track ISRC
+    for (int j = 0; j < 12; ++j) {
+      auto chr = reader.read<uint8_t>(8).value();
+      m_bits_read += 8;
+      if (chr != 0) { track.isrc += static_cast<char>(chr); }
+    }
+
+    // u(1) -> track type
+    auto track_type = static_cast<int>(reader.read<uint8_t>(1).value());
+    m_bits_read += 1;
+    track.is_audio = track_type == 0;
+
+    // u(1) -> pre-emphasis flag
+    [[maybe_unused]] auto pre_emphasis_flag = static_cast<int>(reader.read<uint8_t>(1).value());
+    m_bits_read += 1;
+
+    // u(6 + 13 * 8) -> reserved (Skip)
+    reader.skip(110);
+    m_bits_read += 110;
+
+    // u(8) -> number of track index points
+    auto num_indices = static_cast<int>(reader.read<uint8_t>(8).value());
+    m_bits_read += 8;
+
+    // index points, their offsets are relative to the track offset
+    std::optional<uint64_t> start_offset;
+    for (int j = 0; j < num_indices; ++j) {
+      // u(64) -> offset in samples
+      auto index_offset = reader.read<uint64_t>(64).value();
+      m_bits_read += 64;
+
+      // u(8) -> track index point number
+      auto index_number = static_cast<int>(reader.read<uint8_t>(8).value());
+      m_bits_read += 8;
+
+      // u(3 * 8) -> reserved (skip)
+      reader.skip(24);
+      m_bits_read += 24;
+
+      // The track starts at INDEX 01, INDEX 00 is the pregap and only used without it.
+      if (index_number == 1 || (index_number == 0 && !start_offset)) { start_offset = index_offset; }
+    }
+
+    // The lead-out is the last track, 170 on a CD and 255 otherwise.
+    const uint8_t lead_out_number = is_cd == 1 ? 170 : 255;// NOLINT
+    if (track.number == lead_out_number) {
+      cue_sheet.lead_out = track_offset;
+      continue;
+    }
+
+    track.start_sample = track_offset + start_offset.value_or(0);
+    cue_sheet.tracks.push_back(std::move(track));
+  }
+
+  if (!cue_sheet.tracks.empty()) { m_cue_sheet = std::move(cue_sheet); }
+
+  return true;
+}
+
+bool FlacStreamDecoder::seekToOffset(uint64_t offset)
+{
+  m_file.clear();
+  m_file.seekg(std::streamoff(offset));
+
+  m_buffer_begin = 0;
+  m_buffer_end = 0;
+  m_end_of_file = false;
+  m_end_of_stream = false;
+  m_block_frames = 0;
+  m_block_pos = 0;
+
+  return m_file.good();
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> FlacStreamDecoder::findFrameAfter(uint64_t offset)
+{
+  // No frame is longer than m_frame_bound, so one header starts within the window unless
+  // the stream ends first.
+  std::vector<uint8_t> window(m_frame_bound + MAX_FRAME_HEADER_SIZE);
+
+  m_file.clear();
+  m_file.seekg(std::streamoff(offset));
+  m_file.read(reinterpret_cast<char *>(window.data()), std::streamsize(window.size()));// NOLINT
+  window.resize(size_t(m_file.gcount()));
+
+  for (size_t pos = 0; pos + 1 < window.size(); ++pos) {
+    if (window[pos] != 0xFF || (window[pos + 1] & 0xFEU) != 0xF8) { continue; }// NOLINT
+
+    const auto first_sample = parseFrameStart(std::span<const uint8_t>(window).subspan(pos));
+    if (first_sample.has_value()) { return std::make_pair(offset + pos, first_sample.value()); }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<uint64_t> FlacStreamDecoder::parseFrameStart(std::span<const uint8_t> bytes) const
+{
+  // The checks decodeFrameHeader() does, but quiet, most candidates are just audio data
+  // that happens to look like a sync code.
+  constexpr size_t min_header_size = 6;
+  if (bytes.size() < min_header_size) { return std::nullopt; }
+
+  const int strategy_bit = bytes[1] & 0x01U;
+  const int block_size_bits = bytes[2] >> 4U;
+  const int sample_rate_bits = bytes[2] & 0x0FU;
+  const int channel_bits = bytes[3] >> 4U;
+  const int bit_depth_bits = (bytes[3] >> 1U) & 0x07U;
+
+  if (block_size_bits == 0 || sample_rate_bits == 15 || channel_bits > 10 || bit_depth_bits == 3// NOLINT
+      || (bytes[3] & 0x01U) != 0) {
+    return std::nullopt;
+  }
+
+  if (determineChannels(channel_bits) != m_stream_info.num_channels
+      || (bit_depth_bits != 0 && determineBitDepth(bit_depth_bits) != m_stream_info.bit_depth)) {
+    return std::nullopt;
+  }
+
+  // UTF-8 like coded frame or sample number.
+  const auto length = size_t(utf8SequenceLength(bytes[4]));
+  if (length == 0 || bytes.size() < 4 + length + 1) { return std::nullopt; }
+
+  uint64_t coded_number = length == 1 ? bytes[4] : bytes[4] & (0xFFU >> (length + 1));
+  for (size_t i = 1; i < length; ++i) {
+    if ((bytes[4 + i] & 0xC0U) != 0x80) { return std::nullopt; }// NOLINT
+    coded_number = (coded_number << 6U) | (bytes[4 + i] & 0x3FU);// NOLINT
+  }
+
+  size_t header_size = 4 + length;
+  if (block_size_bits == 6) { header_size += 1; }// NOLINT
+  if (block_size_bits == 7) { header_size += 2; }// NOLINT
+  if (sample_rate_bits == 12) { header_size += 1; }// NOLINT
+  if (sample_rate_bits == 13 || sample_rate_bits == 14) { header_size += 2; }// NOLINT
+
+  if (bytes.size() <= header_size || afs::crc8(bytes.first(header_size)) != bytes[header_size]) { return std::nullopt; }
+
+  const uint64_t first_sample = firstSampleOf(strategy_bit, coded_number);
+  if (m_stream_info.total_samples > 0 && first_sample >= m_stream_info.total_samples) { return std::nullopt; }
+
+  return first_sample;
+}
+
+uint64_t FlacStreamDecoder::firstSampleOf(int strategy_bit, uint64_t coded_number) const
+{
+  // Fixed blocking streams count frames, every frame but the last one is max_block_size long.
+  if (strategy_bit == 0) { return coded_number * m_stream_info.max_block_size; }
+
+  return coded_number;
+}
+
+bool FlacStreamDecoder::decodeFrame(etl::bit_stream_reader &reader)
+{
+  // decode frame header
+  auto tframe_header = decodeFrameHeader(reader);
+  if (!tframe_header.has_value()) { return false; }
+  auto frame_header = tframe_header.value();
+  m_block_first_sample = firstSampleOf(frame_header.strategy_bit, frame_header.coded_number);
+
+  if (frame_header.num_channels != m_stream_info.num_channels) {
+    std::cerr << "Frame has " << frame_header.num_channels << " channels but STREAMINFO says "
+              << static_cast<int>(m_stream_info.num_channels) << ".\n";
+    return false;
+  }
+
+  // decode subframes for each channel
+  if (!decodeSubframes(reader, frame_header)) { return false; }
+  auto &samples = m_subframes;
+
+  if (frame_header.channel_bits >= 8 && frame_header.channel_bits <= 10) {
+    if (!decorrelateChannels(samples, frame_header.channel_bits)) {
+      std::cerr << "Failed to decorrelate channels.\n";
+      return false;
+    }
+  }
+
+  storeBlock(samples);
+
+  // Hashing happens on the worker thread, this only hands the block over.
+  if (m_md5_worker) { m_md5_worker->push(m_block); }
+
+  const uint32_t bits_to_align = (8 - (m_bits_read % 8)) % 8;
+  if (bits_to_align > 0) {
+    reader.skip(bits_to_align);
+    m_bits_read += bits_to_align;
+  }
+
+  if (!decodeFrameFooter(reader)) {
+    std::cerr << "Failed to decode frame footer.\n";
+    return false;
+  }
+
+  return true;
+}
+
+std::optional<FrameHeader> FlacStreamDecoder::decodeFrameHeader(etl::bit_stream_reader &reader)
+{
+  FrameHeader frame_header{};
+
+  //  u(15) -> frame sync code (0b111111111111100)
+  auto frame_sync_code = reader.read<uint16_t>(15).value();
+  m_bits_read += 15;
+  if (frame_sync_code != 0x7ffc) {
+    std::cerr << "Invalid frame sync code: 0x" << std::hex << frame_sync_code << std::dec << "\n";
+    return std::nullopt;
+  }
+  frame_header.frame_sync_code = frame_sync_code;
+
+  // u(1) -> blocking strategy bit
+  auto strategy_bit = static_cast<int>(reader.read<uint8_t>(1).value());
+  m_bits_read += 1;
+  frame_header.strategy_bit = strategy_bit;
+
+  // u(4) -> block size bits
+  auto block_size_bits = static_cast<int>(reader.read<uint8_t>(4).value());
+  m_bits_read += 4;
+  frame_header.block_size_bits = block_size_bits;
+  uint32_t block_size = determineBlockSize(block_size_bits);
+  frame_header.block_size = block_size;
+
+  // u(4) -> sample rate bits
+  auto sample_rate_bits = static_cast<int>(reader.read<uint8_t>(4).value());
+  m_bits_read += 4;
+  frame_header.sample_rate_bits = sample_rate_bits;
+  uint32_t sample_rate = determineSampleRate(sample_rate_bits);
+
+  if (sample_rate == 0) { sample_rate = m_stream_info.sample_rate; }
+
+  // u(4) -> channel bits
+  auto channel_bits = static_cast<int>(reader.read<uint8_t>(4).value());
+  m_bits_read += 4;
+  frame_header.channel_bits = channel_bits;
+  const uint16_t num_channels = determineChannels(channel_bits);
+  frame_header.num_channels = num_channels;
+
+  // u(3) -> bit depth bits
+  auto bit_depth_bits = static_cast<int>(reader.read<uint8_t>(3).value());
+  frame_header.bit_depth_bits = bit_depth_bits;
+  m_bits_read += 3;
+  uint16_t bit_depth = determineBitDepth(bit_depth_bits);
+
+  if (bit_depth == 0) { bit_depth = m_stream_info.bit_depth; }
+
+  frame_header.bit_depth = bit_depth;
+
+  // u(1) -> reserved bit
+  auto reserved_bit = static_cast<int>(reader.read<uint8_t>(1).value());
+  m_bits_read += 1;
+  if (reserved_bit != 0) {
+    std::cerr << "\tReserved bit is not 0.\n";
+    return std::nullopt;
+  }
+
+  // UTF-8 coded sample/frame number (coded number)
+  uint64_t coded_number = 0;
+  if (strategy_bit == 0) {
+    // fixed
+    auto res = readUTF8(reader);
+    if (res.has_value()) {
+      coded_number = res.value();
+    } else {
+      throw std::runtime_error("Error decoding UTF-8 bytes");
+    }
+  } else {
+    // variable
+    auto res = readUTF8(reader);
+    if (res.has_value()) {
+      coded_number = res.value();
+    } else {
+      throw std::runtime_error("Error decoding UTF-8 bytes");
+    }
+  }
+  frame_header.coded_number = coded_number;
+
+  if (block_size_bits == 6) {
+    block_size = reader.read<uint8_t>(8).value() + 1;
+    m_bits_read += 8;
+  } else if (block_size_bits == 7) {
+    block_size = reader.read<uint16_t>(16).value() + 1;
+    m_bits_read += 16;
+  }
+  frame_header.block_size = block_size;
+
+  if (sample_rate_bits == 12) {
+    sample_rate = reader.read<uint8_t>(8).value() * 1000;
+    m_bits_read += 8;
+  } else if (sample_rate_bits == 13) {
+    sample_rate = reader.read<uint16_t>(16).value();
+    m_bits_read += 16;
+  } else if (sample_rate_bits == 14) {
+    sample_rate = reader.read<uint16_t>(16).value() * 10;
+    m_bits_read += 16;
+  }
+
+  frame_header.sample_rate = sample_rate;
+
+  // u(8) -> CRC-8 of the frame header
+  const size_t header_size = m_bits_read / 8;
+  auto crc8 = static_cast<int>(reader.read<uint8_t>(8).value());
+  m_bits_read += 8;
+
+  if (m_verify_mode != VerifyMode::Off && afs::crc8(frameBytes(header_size)) != crc8) {
+    std::cerr << "Frame header CRC-8 mismatch.\n";
+    return std::nullopt;
+  }
+
+  frame_header.crc8 = crc8;
+
+  return frame_header;
+}
+
+bool FlacStreamDecoder::decodeSubframes(etl::bit_stream_reader &reader, const FrameHeader &frame_header)
+{
+  // The channel buffers are reused from frame to frame, resizing only allocates when
+  // a frame is bigger than any frame seen before.
+  m_subframes.resize(frame_header.num_channels);
+
+  for (uint16_t i = 0; i < frame_header.num_channels; ++i) {
+    m_subframes[i].resize(frame_header.block_size);
+
+    uint16_t subframe_bit_depth = frame_header.bit_depth;
+    if (frame_header.channel_bits == 8 && i == 1) {// NOLINT
+      subframe_bit_depth = frame_header.bit_depth + 1;
+    } else if (frame_header.channel_bits == 9 && i == 0) {
+      subframe_bit_depth = frame_header.bit_depth + 1;
+    } else if (frame_header.channel_bits == 10 && i == 1) {
+      subframe_bit_depth = frame_header.bit_depth + 1;
+    }
+
+    if (!decodeSubframe(reader, m_subframes[i], frame_header.block_size, subframe_bit_depth)) {
+      std::cerr << "Failed to decode subframe " << i << "\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeSubframe(etl::bit_stream_reader &reader,
+  std::vector<int32_t> &samples,
+  uint32_t block_size,
+  uint16_t subframe_bit_depth)
+{
+  // decode subframe header
+  // u(1) -> reserved bit (must be 0)
+  auto reserved_bit = reader.read<uint8_t>(1).value();
+  m_bits_read += 1;
+
+  if (static_cast<int>(reserved_bit) != 0) { throw std::runtime_error("The reserved bit must be 0.\n"); }
+
+  // u(6) -> subframe type bits
+  auto subframe_type_bits = static_cast<int>(reader.read<uint8_t>(6).value());
+  m_bits_read += 6;
+  [[maybe_unused]] auto subframe_type = determineSubframeType(subframe_type_bits);
+
+  // u(1) -> does subframe uses wasted bits
+  auto is_wasted_bits = static_cast<int>(reader.read<uint8_t>(1).value());
+  m_bits_read += 1;
+
+  // u(n) -> wasted bits per sample
+  uint8_t wasted_bits = 0;
+  if (is_wasted_bits == 1) {
+    wasted_bits = 1;
+
+    while (static_cast<int>(reader.read<uint8_t>(1).value()) == 0) { wasted_bits++; }
+
+    m_bits_read += wasted_bits;
+  }
+
+  const uint16_t adjusted_bit_depth = subframe_bit_depth - wasted_bits;
+
+  bool decoded = false;
+
+  if (subframe_type_bits == 0) {
+    decoded = decodeConstantSubframe(reader, samples, adjusted_bit_depth);
+  } else if (subframe_type_bits == 1) {
+    decoded = decodeVerbatimSubframe(reader, samples, block_size, adjusted_bit_depth);
+  } else if (subframe_type_bits >= 8 && subframe_type_bits <= 12) {
+    const uint8_t order = uint(subframe_type_bits) & 0x07U;
+
+    decoded = decodeFixedSubframe(reader, samples, block_size, adjusted_bit_depth, order);
+  } else if (subframe_type_bits >= 32) {
+    const uint8_t order = (uint(subframe_type_bits) & 0x1FU) + 1;
+
+    decoded = decodeLPCSubframe(reader, samples, block_size, adjusted_bit_depth, order);
+  } else {
+    std::cerr << "Reserved subframe type: " << subframe_type_bits << "\n";
+  }
+
+  if (!decoded) { return false; }
+
+  // Prediction runs on the samples with the wasted bits stripped, they are put back
+  // only once the whole subframe has been restored.
+  if (wasted_bits > 0) {
+    for (auto &sample : samples) { sample = int32_t(uint32_t(sample) << wasted_bits); }// NOLINT
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeConstantSubframe(etl::bit_stream_reader &reader,
+  std::vector<int32_t> &samples,
+  uint16_t bit_depth)
+{
+  const int32_t value = readSignedValue(reader, bit_depth);
+
+  std::fill(samples.begin(), samples.end(), value);
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeVerbatimSubframe(etl::bit_stream_reader &reader,
+  std::vector<int32_t> &samples,
+  uint32_t block_size,
+  uint16_t bit_depth)
+{
+  for (uint32_t i = 0; i < block_size; ++i) { samples[i] = readSignedValue(reader, bit_depth); }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeFixedSubframe(etl::bit_stream_reader &reader,
+  std::vector<int32_t> &samples,
+  uint32_t block_size,
+  uint16_t bit_depth,
+  uint8_t order)
+{
+  if (order > MAX_FIXED_ORDER || order > block_size) {
+    std::cerr << "Unsupported order: " << static_cast<int>(order) << "\n";
+    return false;
+  }
+
+  //  s(n) -> unencoded warm-up samples
+  for (uint8_t i = 0; i < order; ++i) { samples[i] = readSignedValue(reader, bit_depth); }
+
+  // The residual goes straight behind the warm-up samples, the predictor then
+  // restores the signal in place.
+  const std::span<int32_t> signal(samples.data(), block_size);
+  if (!decodeResidual(reader, signal.subspan(order), block_size, order)) { return false; }
+
+  restoreFixed(signal, bit_depth, order);
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeLPCSubframe(etl::bit_stream_reader &reader,
+  std::vector<int32_t> &samples,
+  uint32_t block_size,
+  uint16_t bit_depth,
+  uint8_t order)
+{
+  if (order > block_size) {
+    std::cerr << "LPC order " << static_cast<int>(order) << " exceeds block size " << block_size << "\n";
+    return false;
+  }
+
+  //  u(n) -> unencoded warm-up samples
+  for (uint8_t i = 0; i < order; ++i) { samples[i] = readSignedValue(reader, bit_depth); }
+
+  // u(4) -> predictor coefficient precision in bits
+  auto precision = static_cast<int>(reader.read<uint8_t>(4).value());
+  m_bits_read += 4;
+
+  if (precision == 15) {
+    std::cerr << "LPC precision of value 15 is invalid\n";
+    return false;
+  }
+  precision++;
+
+  // s(5) -> prediction right shift needed in bits
+  auto shift = static_cast<int8_t>(readSignedValue(reader, 5));
+
+  if (shift < 0) {
+    std::cerr << "LCP shift must not be negative.\n";
+    return false;
+  }
+
+  //  s(n) -> predictor coefficients
+  std::array<int32_t, MAX_LPC_ORDER> coefficients{};
+  for (uint8_t i = 0; i < order; ++i) {
+    coefficients[i] = readSignedValue(reader, uint16_t(precision));
+  }
+
+  const std::span<int32_t> signal(samples.data(), block_size);
+  if (!decodeResidual(reader, signal.subspan(order), block_size, order)) { return false; }
+
+  restoreLPC(signal, coefficients.data(), shift, bit_depth, precision, order);
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeResidual(etl::bit_stream_reader &reader,
+  std::span<int32_t> residual,
+  uint32_t block_size,
+  uint8_t predictor_order)
+{
+  // u(2) -> coding method bits
+  auto coding_method = static_cast<int>(reader.read<uint8_t>(2).value());
+  m_bits_read += 2;
+
+  if (coding_method > 1) {
+    std::cerr << "Reserved residual coding method.\n";
+    return false;
+  }
+
+  // u(4) -> partition order
+  auto partition_order = static_cast<int>(reader.read<uint8_t>(4).value());
+  m_bits_read += 4;
+
+  const uint32_t num_partitions = 1U << uint(partition_order);
+
+  if (block_size % num_partitions != 0) {
+    std::cerr << "Invalid data stream: block_size " << block_size << " is not divisible by " << num_partitions
+              << " partitions\n";
+    return false;
+  }
+
+  const uint32_t samples_per_partition = block_size >> uint(partition_order);
+
+  if (samples_per_partition <= predictor_order) {
+    std::cerr << "Invalid data stream: block_size " << block_size << " >> partition_order " << partition_order
+              << " is less than predictor_order " << static_cast<int>(predictor_order) << "\n";
+    return false;
+  }
+
+  const uint32_t total_res_samples = block_size - predictor_order;
+
+  if (residual.size() != total_res_samples) {
+    std::cerr << "Residual buffer size mismatch: " << residual.size() << " vs expected " << total_res_samples << "\n";
+    return false;
+  }
+
+  uint32_t sample_idx = 0;
+
+  for (uint32_t part_idx = 0; part_idx < num_partitions; ++part_idx) {
+    uint32_t partition_samples{};
+
+    if (part_idx == 0) {
+      partition_samples = samples_per_partition - predictor_order;
+    } else {
+      partition_samples = samples_per_partition;
+    }
+
+    if (partition_samples == 0) {
+      std::cerr << "⚠️ Warning: partition " << part_idx << " has 0 samples.\n";
+      continue;
+    }
+
+    const uint8_t rice_param_bits = (coding_method == 0) ? 4 : 5;
+    auto rice_param = reader.read<uint32_t>(uint_least8_t(rice_param_bits)).value();
+    m_bits_read += rice_param_bits;
+
+    const uint32_t escape_code = (coding_method == 0) ? 15 : 31;
+
+    if (rice_param == escape_code) {
+      // u(5) -> unencoded binary partition
+      auto bps = reader.read<uint8_t>(5).value();
+      m_bits_read += 5;
+
+      for (uint32_t i = 0; i < partition_samples; ++i) {
+        if (sample_idx >= residual.size()) {
+          std::cerr << "Residual buffer overflow at sample " << sample_idx << "\n";
+          return false;
+        }
+        residual[sample_idx++] = readSignedValue(reader, bps);
+      }
+    } else {
+      for (uint32_t i = 0; i < partition_samples; ++i) {
+        if (sample_idx >= residual.size()) {
+          std::cerr << "Residual buffer overflow at sample " << sample_idx << "\n";
+          return false;
+        }
+        residual[sample_idx++] = readRiceSignedValue(reader, rice_param);
+      }
+    }
+  }
+
+  if (sample_idx != total_res_samples) {
+    std::cerr << "Residual sample count mismatch: decoded " << sample_idx << ", expected " << total_res_samples << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+bool FlacStreamDecoder::decodeFrameFooter(etl::bit_stream_reader &reader)
+{
+  const size_t frame_size = m_bits_read / 8;
+  auto crc16 = reader.read<uint16_t>(16).value();
+  m_bits_read += 16;
+
+  if (m_verify_mode != VerifyMode::Off && afs::crc16(frameBytes(frame_size)) != crc16) {
+    std::cerr << "Frame CRC-16 mismatch.\n";
+    return false;
+  }
+
+  return true;
+}
+
+std::optional<uint64_t> FlacStreamDecoder::readUTF8(etl::bit_stream_reader &reader)
+{
+  auto first_byte = reader.read<uint8_t>(8).value();
+  m_bits_read += 8;
+  const int num_bytes = utf8SequenceLength(first_byte);
+
+  if (num_bytes == 0) { return std::nullopt; }
+
+  uint64_t result = 0;
+
+  switch (num_bytes) {
+  case 1:
+    result = first_byte & 0x7FU;
+    break;
+  case 2: {
+    auto byte2 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    if ((byte2 & 0xC0U) != 0x80) { return std::nullopt; }
+
+    result = static_cast<uint64_t>(((first_byte & 0x1FU) << 6U) | (byte2 & 0x3FU));
+
+    break;
+  }
+  case 3: {
+    auto byte2 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte3 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    if ((byte2 & 0xC0U) != 0x80 || (byte3 & 0xC0U) != 0x80) { return std::nullopt; }
+
+    result = static_cast<uint64_t>(((first_byte & 0x0FU) << 12U) | ((byte2 & 0x3FU) << 6U) | (byte3 & 0x3FU));
+
+    break;
+  }
+  case 4: {
+    auto byte2 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte3 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte4 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    if ((byte2 & 0xC0U) != 0x80 || (byte3 & 0xC0U) != 0x80 || (byte4 & 0xC0U) != 0x80) { return std::nullopt; }
+
+    result = static_cast<uint64_t>(
+      ((first_byte & 0x07U) << 18U) | ((byte2 & 0x3FU) << 12U) | ((byte3 & 0x3FU) << 6U) | (byte4 & 0x3FU));
+
+    break;
+  }
+  case 5: {
+    auto byte2 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte3 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte4 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte5 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    if ((byte2 & 0xC0U) != 0x80 || (byte3 & 0xC0U) != 0x80 || (byte4 & 0xC0U) != 0x80 || (byte5 & 0xC0U) != 0x80) {
+      return std::nullopt;
+    }
+
+    result = static_cast<uint64_t>(((first_byte & 0x03U) << 24U) | ((byte2 & 0x3FU) << 18U) | ((byte3 & 0x3FU) << 12U)
+                                   | ((byte4 & 0x3FU) << 6U) | (byte5 & 0x3FU));
+
+    break;
+  }
+  case 6: {
+    auto byte2 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte3 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte4 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte5 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte6 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    if ((byte2 & 0xC0U) != 0x80 || (byte3 & 0xC0U) != 0x80 || (byte4 & 0xC0U) != 0x80 || (byte5 & 0xC0U) != 0x80
+        || (byte6 & 0xC0U) != 0x80) {
+      return std::nullopt;
+    }
+
+    result = static_cast<uint64_t>(((first_byte & 0x01U) << 30U) | ((byte2 & 0x3FU) << 24U) | ((byte3 & 0x3FU) << 18U)
+                                   | ((byte4 & 0x3FU) << 12U) | ((byte5 & 0x3FU) << 6U) | (byte6 & 0x3FU));
+
+    break;
+  }
+  case 7: {
+    auto byte2 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte3 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte4 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte5 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte6 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+    auto byte7 = reader.read<uint8_t>(8).value();
+    m_bits_read += 8;
+
+    if ((byte2 & 0xC0U) != 0x80 || (byte3 & 0xC0U) != 0x80 || (byte4 & 0xC0U) != 0x80 || (byte5 & 0xC0U) != 0x80
+        || (byte6 & 0xC0U) != 0x80 || (byte7 & 0xC0U) != 0x80) {
+      return std::nullopt;
+    }
+
+    result = static_cast<uint64_t>(((byte2 & 0x3FU) << 30U) | ((byte3 & 0x3FU) << 24U) | ((byte4 & 0x3FU) << 18U)
+                                   | ((byte5 & 0x3FU) << 12U) | ((byte6 & 0x3FU) << 6U) | (byte7 & 0x3FU));
+
+    break;
+  }
+  default:
+    return std::nullopt;
+  }
+
+  return result;
+}
+
+int32_t FlacStreamDecoder::readSignedValue(etl::bit_stream_reader &reader, uint16_t bits)
+{
+  if (bits == 0) { return 0; }
+
+  if (bits < 1 || bits > 32) { throw std::invalid_argument("bits must be between 1 and 32"); }
+
+  const auto value = reader.read<uint32_t>(static_cast<uint_least8_t>(bits)).value();
+  m_bits_read += bits;
+
+  if (bits == 32) { return static_cast<int32_t>(value); }
+
+  const uint32_t sign_bit_mask = 1U << (bits - 1U);
+  const uint32_t two_power = 1U << bits;
+
+  if (bool(value & sign_bit_mask)) {
+    const int32_t result = static_cast<int32_t>(value) - static_cast<int32_t>(two_power);
+    return result;
+  } else {
+    return static_cast<int32_t>(value);
+  }
+}
+
+int32_t FlacStreamDecoder::readRiceSignedValue(etl::bit_stream_reader &reader, uint32_t param)
+{
+  uint32_t quotient = 0;
+  while (static_cast<int>(reader.read<uint8_t>(1).value()) == 0) { quotient++; }
+  m_bits_read += (quotient + 1);
+
+  uint32_t remainder = 0;
+  if (param > 0) {
+    remainder = reader.read<uint32_t>(uint_least8_t(param)).value();
+    m_bits_read += param;
+  }
+
+  const uint32_t value = (quotient << param) | remainder;
+
+  if (bool(value & 1U)) {
+    auto value2 = -static_cast<int32_t>((value + 1) >> 1U);
+    return value2;
+  } else {
+    auto value2 = static_cast<int32_t>(value >> 1U);
+    return value2;
+  }
+}
+
+bool FlacStreamDecoder::decorrelateChannels(std::vector<std::vector<int32_t>> &channels, int channel_assignment)
+{
+  if (channels.size() != 2) {
+    std::cerr << "Decorrelation requires exactly 2 channels.\n";
+    return false;
+  }
+
+  const size_t num_samples = channels[0].size();
+
+  switch (channel_assignment) {
+  case 8:
+    for (size_t i = 0; i < num_samples; ++i) { channels[1][i] = channels[0][i] - channels[1][i]; }
+    break;
+  case 9:
+    for (size_t i = 0; i < num_samples; ++i) { channels[0][i] = channels[1][i] + channels[0][i]; }
+    break;
+  case 10:
+    for (size_t i = 0; i < num_samples; ++i) {
+      const int32_t side = channels[1][i];
+      // The encoder dropped the lowest bit of mid, it is the same as the lowest bit of side.
+      const int64_t mid = (int64_t(channels[0][i]) * 2) | (side & 1);// NOLINT
+
+      channels[0][i] = static_cast<int32_t>((mid + side) >> 1);// NOLINT
+      channels[1][i] = static_cast<int32_t>((mid - side) >> 1);// NOLINT
+    }
+    break;
+  default:
+    break;
+  }
+
+  return true;
+}
+
+std::span<const uint8_t> FlacStreamDecoder::frameBytes(size_t size) const
+{
+  return { m_buffer.data() + m_buffer_begin, size };
+}
+
+void FlacStreamDecoder::storeBlock(const std::vector<std::vector<int32_t>> &channel_data)
+{
+  const size_t num_samples = channel_data[0].size();
+  const size_t num_channels = channel_data.size();
+
+  m_block.resize(num_samples * num_channels);
+
+  for (size_t i = 0; i < num_samples; ++i) {
+    for (size_t chn = 0; chn < num_channels; ++chn) { m_block[(i * num_channels) + chn] = channel_data[chn][i]; }
+  }
+
+  m_block_frames = num_samples;
+  m_block_pos = 0;
+}
+
+bool FlacStreamDecoder::validateMD5Checksum()
+{
+  auto computed_md5 = m_md5_worker->finish();
+
+  const bool match = std::equal(computed_md5.begin(), computed_md5.end(), m_md5_checksum.begin());
+
+  if (!match) {
+    std::cerr << "Expected MD5: " << MD5::toHex(m_md5_checksum) << "\n";
+    std::cerr << "Computed MD5: " << MD5::toHex(computed_md5) << "\n";
+  }
+
+  return match;
+}
+
+/*
+ * Utility functions
+ */
+
+std::string determinePictureTypeStr(uint32_t picture_type)
+{
+  std::string picture_type_str = "Unknown";
+
+  switch (picture_type) {
+  case 0:
+    picture_type_str = "Other";
+    break;
+  case 1:
+    picture_type_str = "PNG file icon of 32x32 pixels";
+    break;
+  case 2:
+    picture_type_str = "General file icon";
+    break;
+  case 3:
+    picture_type_str = "Front cover";
+    break;
+  case 4:
+    picture_type_str = "Back cover";
+    break;
+  case 5:
+    picture_type_str = "Liner notes page";
+    break;
+  case 6:
+    picture_type_str = "Media label";
+    break;
+  case 7:
+    picture_type_str = "Lead artist";
+    break;
+  case 8:
+    picture_type_str = "Artist or performer";
+    break;
+  case 9:
+    picture_type_str = "Conductor";
+    break;
+  case 10:
+    picture_type_str = "Band or orchestra";
+    break;
+  case 11:
+    picture_type_str = "Composer";
+    break;
+  case 12:
+    picture_type_str = "Lyricist or text writer";
+    break;
+  case 13:
+    picture_type_str = "Recording location";
+    break;
+  case 14:
+    picture_type_str = "During recording";
+    break;
+  case 15:
+    picture_type_str = "During performance";
+    break;
+  case 16:
+    picture_type_str = "Movie or video screen capture";
+    break;
+  case 17:
+    picture_type_str = "A bright colored fish";
+    break;
+  case 18:
+    picture_type_str = "Illustration";
+    break;
+  case 19:
+    picture_type_str = "Band or artist logotype";
+    break;
+  case 20:
+    picture_type_str = "Publisher or studio logotype";
+    break;
+  default:
+    std::cerr << "Unsupported picture type.\n";
+    return "";
+  }
+
+  return picture_type_str;
+}
+
+uint32_t determineBlockSize(int block_size_bits)
+{
+  uint32_t block_size{};
+
+  if (block_size_bits == 0) {
+    throw std::runtime_error("Invalid block size bits (reserved)");
+  } else if (block_size_bits == 1) {
+    block_size = 192;
+  } else if (block_size_bits >= 2 && block_size_bits <= 5) {
+    block_size = 144 * (1U << uint(block_size_bits));
+  } else if (block_size_bits >= 8 && block_size_bits <= 15) {
+    block_size = 1U << uint(block_size_bits);
+  }
+
+  return block_size;
+}
+
+uint32_t determineSampleRate(int sample_rate_bits)
+{
+  uint32_t sample_rate{};
+
+  switch (sample_rate_bits) {
+  case 0:
+    break;
+  case 1:
+    sample_rate = 88'200;
+    break;
+  case 2:
+    sample_rate = 176'400;
+    break;
+  case 3:
+    sample_rate = 192'000;
+    break;
+  case 4:
+    sample_rate = 8'000;
+    break;
+  case 5:
+    sample_rate = 16'000;
+    break;
+  case 6:
+    sample_rate = 22'050;
+    break;
+  case 7:
+    sample_rate = 24'000;
+    break;
+  case 8:
+    sample_rate = 32'000;
+    break;
+  case 9:
+    sample_rate = 44'100;
+    break;
+  case 10:
+    sample_rate = 48'000;
+    break;
+  case 11:
+    sample_rate = 96'000;
+    break;
+  case 15:
+    throw std::runtime_error("Sample rate bits are forbidden.\n");
+  default:
+    throw std::runtime_error("Unsupported sample rate bits.\n");
+  }
+
+  return sample_rate;
+}
+
+uint16_t determineChannels(int channel_bits)
+{
+  uint16_t channels{};
+
+  if (channel_bits <= 7) {
+    channels = static_cast<uint16_t>(channel_bits + 1);
+  } else if (channel_bits == 8 || channel_bits == 9 || channel_bits == 10) {
+    channels = 2;
+  } else {
+    throw std::runtime_error("Reserved channel bits.\n");
+  }
+
+  return channels;
+}
+
+uint16_t determineBitDepth(int bit_depth_bits)
+{
+  uint16_t bit_depth{};
+
+  switch (bit_depth_bits) {
+  case 0:
+    break;
+  case 1:
+    bit_depth = 8;
+    break;
+  case 2:
+    bit_depth = 12;
+    break;
+  case 3:
+    std::cerr << "Reserved space for bit depth bits.\n";
+    break;
+  case 4:
+    bit_depth = 16;
+    break;
+  case 5:
+    bit_depth = 20;
+    break;
+  case 6:
+    bit_depth = 24;
+    break;
+  case 7:
+    bit_depth = 32;
+    break;
+  default:
+    throw std::runtime_error("Unsupported bit depth bits.\n");
+  }
+
+  return bit_depth;
+}
+
+std::string determineSubframeType(int subframe_type_bits)
+{
+  std::string subframe_type{};
+
+  if (subframe_type_bits == 0) {
+    subframe_type = "Constant subframe";
+  } else if (subframe_type_bits == 1) {
+    subframe_type = "Verbatim subframe";
+  } else if ((subframe_type_bits >= 2 && subframe_type_bits <= 7)
+             || (subframe_type_bits >= 13 && subframe_type_bits <= 31)) {
+    subframe_type = "Reserved";
+  } else if (subframe_type_bits >= 8 && subframe_type_bits <= 12) {
+    subframe_type = "Subframe with a fixed predictor of order " + std::to_string(subframe_type_bits - 8);
+  } else if (subframe_type_bits >= 32 && subframe_type_bits <= 63) {
+    subframe_type = "Subframe with a linear predictor of order " + std::to_string(subframe_type_bits - 31);
+  }
+
+  return subframe_type;
+}
+
+int utf8SequenceLength(uint8_t first_byte)
+{
+  if ((first_byte & 0x80U) == 0x00) { return 1; }
+  if ((first_byte & 0xE0U) == 0xC0) { return 2; }
+  if ((first_byte & 0xF0U) == 0xE0) { return 3; }
+  if ((first_byte & 0xF8U) == 0xF0) { return 4; }
+  if ((first_byte & 0xFCU) == 0xF8) { return 5; }
+  if ((first_byte & 0xFEU) == 0xFC) { return 6; }
+  if (first_byte == 0xFE) { return 7; }
+  return 0;
+}
+
+}// namespace afs
@@ -0,0 +1,56 @@
+#include <afsproject/db.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/hash_stats.h>
+#include <cmath>
+#include <cstdint>
+#include <sqlite3.h>
+
+namespace afs {
+
+HashStats::HashStats(SQLiteDB &db, const FingerprintConfig &config)
+  : m_max_fraction(config.stop_hash_max_fraction), m_min_songs(config.stop_hash_min_songs),
+    m_select(db, "SELECT song_count FROM hash_stats WHERE hash = ?;"),
+    m_upsert(db,
+      "INSERT INTO hash_stats (hash, song_count) VALUES (?, 1) ON CONFLICT(hash) DO UPDATE SET song_count = "
+      "song_count + 1;")
+{
+  SQLiteDB::Statement count_stmt(db, "SELECT COUNT(*) FROM songs;");
+  if (count_stmt.step() == SQLITE_ROW) { m_num_songs = count_stmt.columnLongLong(0); }
+}
+
+long long HashStats::getNumSongs() const { return m_num_songs; }
+
+uint32_t HashStats::documentFrequency(uint32_t hash)
+{
+  uint32_t document_frequency = 0;
+
+  m_select.bindInt(1, static_cast<int>(hash));
+  if (m_select.step() == SQLITE_ROW) { document_frequency = uint32_t(m_select.columnLongLong(0)); }
+  m_select.reset();
+
+  return document_frequency;
+}
+
+void HashStats::addSong(uint32_t hash)
+{
+  m_upsert.bindInt(1, static_cast<int>(hash));
+  m_upsert.step();
+  m_upsert.reset();
+}
+
+bool HashStats::isStopHash(uint32_t document_frequency) const
+{
+  if (m_num_songs < m_min_songs) { return false; }
+
+  return double(document_frequency) > m_max_fraction * double(m_num_songs);
+}
+
+double HashStats::weight(uint32_t document_frequency) const
+{
+  // Unknown frequencies weigh like a plain vote.
+  if (document_frequency == 0 || m_num_songs <= 0) { return 1.0; }
+
+  return std::log(1.0 + (double(m_num_songs) / double(document_frequency)));
+}
+
+}// namespace afs
@@ -1,23 +1,62 @@
 #include <afsproject/afs.h>
 #include <afsproject/audio_engine.h>
 #include <afsproject/audio_file.h>
+#include <afsproject/cue_sheet.h>
 #include <afsproject/db.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/flac_metadata.h>
+#include <afsproject/flac_stream_decoder.h>
+#include <afsproject/pipe_audio_file.h>
+#include <afsproject/stream_recognizer.h>
+#include <afsproject/wave_file.h>
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <span>
 #include <sqlite3.h>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 using namespace afs;
 namespace fs = std::filesystem;
 
-long long storeSongMetadata(IAudioFile &audio_file, SQLiteDB &db, const std::string &filepath)// NOLINT
+// One row of the songs table.
+struct SongRecord
+{
+  Metadata metadata;
+  double duration_seconds{};
+  std::string file_path;
+  uint32_t sample_rate{};
+  uint16_t bit_depth{};
+  // Only set for a track of an album image, along with where it starts in the image.
+  int track_number{};
+  double start_seconds{};
+};
+
+SongRecord makeSongRecord(const IAudioFile &audio_file, const std::string &filepath)
+{
+  return { audio_file.getMetadata(),
+    audio_file.getDurationSeconds(),
+    filepath,
+    audio_file.getSampleRate(),
+    audio_file.getBitDepth() };
+}
+
+long long storeSongMetadata(const SongRecord &song, SQLiteDB &db)// NOLINT
 {
   const std::string sql =
     "INSERT INTO songs (title, artist, album, genre, release_date, duration_seconds, file_path, sample_rate_hz, "
-    "bitrate_kbps) VALUES (?, ?, ?, ?, "
-    "?, ?, ?, ?, ?);";
+    "bitrate_kbps, track_number, start_seconds) VALUES (?, ?, ?, ?, "
+    "?, ?, ?, ?, ?, ?, ?);";
   long long song_id = -1;
 
   try {
@@ -25,7 +64,7 @@ long long storeSongMetadata(IAudioFile &audio_file, SQLiteDB &db, const std::str
 
     SQLiteDB::Statement stmt(db, sql);
 
-    auto metadata = audio_file.getMetadata();
+    const Metadata &metadata = song.metadata;
 
     std::cout << "Metadata in storeSongMetadata:\n"
               << " Title: " << metadata.title << "\n"
@@ -34,17 +73,20 @@ long long storeSongMetadata(IAudioFile &audio_file, SQLiteDB &db, const std::str
               << " Date: " << metadata.date << "\n"
               << " Genre: " << metadata.genre << "\n";
 
-    const std::filesystem::path path(filepath);
+    const std::filesystem::path path(song.file_path);
 
     stmt.bindText(1, metadata.title);
     stmt.bindText(2, metadata.artist);
     stmt.bindText(3, metadata.album);
     stmt.bindText(4, metadata.genre);
     stmt.bindText(5, metadata.date);
-    stmt.bindText(6, std::to_string(audio_file.getDurationSeconds()));
-    stmt.bindText(7, filepath);
-    stmt.bindText(8, std::to_string(audio_file.getSampleRate()));// NOLINT
-    stmt.bindText(9, std::to_string(audio_file.getBitDepth()));// NOLINT
+    stmt.bindText(6, std::to_string(song.duration_seconds));
+    stmt.bindText(7, song.file_path);
+    stmt.bindText(8, std::to_string(song.sample_rate));// NOLINT
+    stmt.bindText(9, std::to_string(song.bit_depth));// NOLINT
+    // Left NULL for a whole file.
+    if (song.track_number > 0) { stmt.bindInt(10, song.track_number); }// NOLINT
+    stmt.bindDouble(11, song.start_seconds);// NOLINT
 
 
     stmt.step();
@@ -61,26 +103,67 @@ long long storeSongMetadata(IAudioFile &audio_file, SQLiteDB &db, const std::str
   return song_id;
 }
 
-void processAudioFile(const std::string &filepath)
+// Stores every audio track of an album image as a song of its own, `<image>#<track>` in the
+// file_path column. Tracks without a title are named after the image.
+void storeTracks(IAudioFile &audio_file, const CueSheet &cue_sheet, SQLiteDB &db, const std::string &filepath)
 {
-  const AudioEngine engine;
-  const std::unique_ptr<IAudioFile> audio_file = engine.loadAudioFile(filepath);
-
-  if (!audio_file) {
-    std::cerr << "Failed to load audio file: " << filepath << "\n";
-    return;
+  const std::vector<double> mono = audio_file.getMonoPCMData();
+  const uint32_t sample_rate = audio_file.getSampleRate();
+  const Metadata album = audio_file.getMetadata();
+  std::vector<TrackSlice> slices;
+
+  // 1. One songs row per track
+  for (size_t i = 0; i < cue_sheet.tracks.size(); ++i) {
+    const CueTrack &track = cue_sheet.tracks[i];
+    const uint64_t end_sample = getTrackEnd(cue_sheet, i, mono.size());
+    if (!track.is_audio || track.start_sample >= end_sample) { continue; }
+
+    const std::string number = (track.number < 10 ? "0" : "") + std::to_string(track.number);// NOLINT
+
+    SongRecord song = makeSongRecord(audio_file, filepath + "#" + number);
+    song.metadata.title = !track.title.empty() ? track.title : fs::path(filepath).stem().string() + " #" + number;
+    song.metadata.artist = !track.performer.empty()   ? track.performer
+                           : !cue_sheet.performer.empty() ? cue_sheet.performer
+                                                          : album.artist;
+    if (!cue_sheet.title.empty()) { song.metadata.album = cue_sheet.title; }
+    song.duration_seconds = double(end_sample - track.start_sample) / sample_rate;
+    song.track_number = track.number;
+    song.start_seconds = double(track.start_sample) / sample_rate;
+
+    const long long song_id = storeSongMetadata(song, db);
+    if (song_id < 0) { continue; }
+
+    slices.push_back({ song_id, track.start_sample, end_sample });
   }
 
+  // 2. Fingerprints of all tracks, hashed in parallel
+  AFS::storingTrackFingerprints(mono, sample_rate, slices, db);
+  std::cout << "Fingerprints of " << slices.size() << " tracks stored successfully.\n";
+}
+
+void storeAudio(IAudioFile &audio_file, const std::string &filepath)
+{
   try {
     SQLiteDB my_db("afs.db");
 
     if (afs::run(my_db, "db/migration")) { std::cout << "Database migration completed successfuly.\n"; }
 
     std::cout << "Processing: " << filepath << " ...\n";
+
+    // An album image is split into its tracks, a .cue next to it wins over an embedded cue sheet.
+    const fs::path cue_path = fs::path(filepath).replace_extension(".cue");
+    const std::optional<CueSheet> cue_sheet =
+      fs::exists(cue_path) ? loadCueFile(cue_path.string(), audio_file.getSampleRate()) : audio_file.getCueSheet();
+
+    if (cue_sheet && countAudioTracks(*cue_sheet) > 1) {
+      storeTracks(audio_file, *cue_sheet, my_db, filepath);
+      return;
+    }
+
     // 1. Store the song metadata
-    const long long song_id = storeSongMetadata(*audio_file, my_db, filepath);
+    const long long song_id = storeSongMetadata(makeSongRecord(audio_file, filepath), my_db);
     // 2. Store fingerprints of said song
-    AFS::storingFingerprints(*audio_file, song_id, my_db);
+    AFS::storingFingerprints(audio_file, song_id, my_db);
     std::cout << "Fingerprints stored successfully.\n";
   } catch (const std::exception &e) {
     std::cerr << "An unrecoverable error occurred: " << e.what() << "\n";
@@ -88,21 +171,339 @@ void processAudioFile(const std::string &filepath)
   }
 }
 
-void searchAudioFile(const std::string &file)
+void processAudioFile(const AudioEngine &engine, const std::string &filepath)
 {
-  const AudioEngine engine;
-  const std::unique_ptr<IAudioFile> audio = engine.loadAudioFile(file);
+  const std::unique_ptr<IAudioFile> audio_file = engine.loadAudioFile(filepath);
 
-  if (!audio) {
-    std::cerr << "Failed to load audio file: " << file << "\n";
+  if (!audio_file) {
+    std::cerr << "Failed to load audio file: " << filepath << "\n";
+    return;
+  }
+
+  storeAudio(*audio_file, filepath);
+}
+
+// Stores a song piped into stdin by a transcoder under `name`, no temporary file involved.
+void ingestStdin(const std::string &name, const RawPCMFormat &raw_format)
+{
+  const std::unique_ptr<IAudioFile> audio_file = AudioEngine::loadAudioStream("-", raw_format);
+
+  if (!audio_file) {
+    std::cerr << "Failed to read audio from stdin.\n";
     return;
   }
 
+  storeAudio(*audio_file, name);
+}
+
+// Every argument is an audio file, or `@path` for a file that lists one audio file per line.
+std::vector<std::string> expandSearchArguments(const std::vector<std::string> &args)
+{
+  std::vector<std::string> files;
+
+  for (const std::string &arg : args) {
+    if (!arg.starts_with('@')) {
+      files.push_back(arg);
+      continue;
+    }
+
+    std::ifstream list(arg.substr(1));
+    if (!list) {
+      std::cerr << "Failed to open list file: " << arg.substr(1) << "\n";
+      continue;
+    }
+
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+      if (!line.empty()) { files.push_back(line); }
+    }
+  }
+
+  return files;
+}
+
+void searchAudioFiles(const std::vector<std::string> &files)
+{
   try {
     SQLiteDB my_db("afs.db");
 
-    std::cout << "Searching for " << file << "...\n";
-    AFS::searchForRecord(*audio, my_db);
+    if (!afs::run(my_db, "db/migration")) { std::cerr << "Database migration failed, searching anyway.\n"; }
+
+    const AudioEngine engine;
+    const FingerprintConfig config = loadFingerprintConfig(my_db);
+
+    // Sub-fingerprints have no shared posting lists to batch, every clip is searched on its own.
+    if (config.fingerprint_mode == FingerprintMode::SubFingerprint) {
+      for (const std::string &file : files) {
+        const std::unique_ptr<IAudioFile> audio = engine.loadAudioFile(file);
+        if (!audio) {
+          std::cerr << "Failed to load audio file: " << file << "\n";
+          continue;
+        }
+
+        std::cout << "Searching for " << file << "...\n";
+        AFS::searchForRecord(*audio, my_db);
+      }
+      return;
+    }
+
+    // Only the hashes of a clip are kept, its samples are released before the next one is loaded.
+    std::vector<std::string> searched;
+    std::vector<Fingerprint> queries;
+
+    for (const std::string &file : files) {
+      const std::unique_ptr<IAudioFile> audio = engine.loadAudioFile(file);
+      if (!audio) {
+        std::cerr << "Failed to load audio file: " << file << "\n";
+        continue;
+      }
+
+      searched.push_back(file);
+      queries.push_back(AFS::computeFingerprints(*audio, DEFAULT_SAMPLE_PRECISION, config));
+    }
+
+    std::cout << "Searching for " << searched.size() << " file(s)...\n";
+    const std::vector<MatchResult> results = AFS::matchFingerprints(queries, my_db, config);
+
+    for (size_t i = 0; i < results.size(); ++i) {
+      std::cout << "\nResult for " << searched[i] << ":";
+      AFS::printMatch(results[i]);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "An unrecoverable error occurred: " << e.what() << "\n";
+    return;
+  }
+}
+
+// Prints what the headers of every audio file in `paths` say, directories are walked. Nothing
+// is decoded, so this keeps up with large libraries. With `update` the songs already in the
+// catalogue get their metadata rewritten from the headers, matched by file path.
+void scanAudioFiles(const std::vector<std::string> &paths, bool update)
+{
+  std::vector<std::string> files;
+  for (const std::string &path : paths) {
+    if (!fs::is_directory(path)) {
+      files.push_back(path);
+      continue;
+    }
+
+    for (const auto &entry : fs::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file()) { files.push_back(entry.path().string()); }
+    }
+  }
+
+  try {
+    std::unique_ptr<SQLiteDB> my_db;
+    std::unique_ptr<SQLiteDB::Transaction> transaction;
+    std::unique_ptr<SQLiteDB::Statement> stmt;
+
+    if (update) {
+      my_db = std::make_unique<SQLiteDB>("afs.db");
+      if (!afs::run(*my_db, "db/migration")) { std::cerr << "Database migration failed, updating anyway.\n"; }
+
+      transaction = std::make_unique<SQLiteDB::Transaction>(*my_db);
+      stmt = std::make_unique<SQLiteDB::Statement>(*my_db,
+        "UPDATE songs SET title = ?, artist = ?, album = ?, genre = ?, release_date = ?, duration_seconds = ?, "
+        "sample_rate_hz = ?, bitrate_kbps = ? WHERE file_path = ?;");
+    }
+
+    const AudioEngine engine;
+    size_t num_scanned = 0;
+    int num_updated = 0;
+
+    for (const std::string &file : files) {
+      AudioInfo info;
+
+      try {
+        if (!engine.scanAudioFile(file, info)) { continue; }
+      } catch (const std::exception &e) {
+        std::cerr << "Failed to scan " << file << ": " << e.what() << "\n";
+        continue;
+      }
+
+      ++num_scanned;
+      const double duration_seconds = info.sample_rate == 0 ? 0.0 : double(info.num_frames) / info.sample_rate;
+
+      std::cout << file << "\t" << duration_seconds << "s\t" << info.sample_rate << " Hz\t" << info.bit_depth
+                << " bit\t" << info.num_channels << " ch\t" << info.metadata.artist << "\t" << info.metadata.title
+                << "\n";
+
+      if (!stmt) { continue; }
+
+      // Same column layout storeSongMetadata writes.
+      stmt->bindText(1, info.metadata.title);
+      stmt->bindText(2, info.metadata.artist);
+      stmt->bindText(3, info.metadata.album);
+      stmt->bindText(4, info.metadata.genre);
+      stmt->bindText(5, info.metadata.date);
+      stmt->bindText(6, std::to_string(duration_seconds));
+      stmt->bindText(7, std::to_string(info.sample_rate));// NOLINT
+      stmt->bindText(8, std::to_string(info.bit_depth));// NOLINT
+      stmt->bindText(9, file);// NOLINT
+      stmt->step();
+      stmt->reset();
+
+      num_updated += sqlite3_changes(my_db->get());
+    }
+
+    if (transaction) {
+      stmt.reset();
+      transaction->commit();
+      std::cout << "Updated " << num_updated << " catalogued song(s).\n";
+    }
+
+    std::cout << "Scanned " << num_scanned << " of " << files.size() << " file(s).\n";
+  } catch (const std::exception &e) {
+    std::cerr << "An unrecoverable error occurred: " << e.what() << "\n";
+    return;
+  }
+}
+
+// Writes the front cover of a FLAC file, or its first picture when none is marked as the
+// front cover. Only the block headers and the picture itself are read from the file.
+bool extractCover(const std::string &file_path, std::string output_path)
+{
+  FlacMetadataIndex index;
+  if (!index.open(file_path)) { return false; }
+
+  const std::vector<FlacPicture> pictures = index.getPictures();
+  if (pictures.empty()) {
+    std::cerr << "No picture in " << file_path << "\n";
+    return false;
+  }
+
+  constexpr uint32_t front_cover = 3;
+  const auto front =
+    std::ranges::find_if(pictures, [](const FlacPicture &picture) { return picture.picture_type == front_cover; });
+  const FlacPicture &picture = front != pictures.end() ? *front : pictures.front();
+
+  // A MIME type of "-->" means the data is the URL of the picture.
+  if (picture.mime_type == "-->") {
+    std::cout << "The cover is linked: " << std::string_view(reinterpret_cast<const char *>(picture.data.data()), picture.data.size()) << "\n";// NOLINT
+    return true;
+  }
+
+  if (output_path.empty()) {
+    std::string_view extension = ".bin";
+    if (picture.mime_type == "image/jpeg" || picture.mime_type == "image/jpg") {
+      extension = ".jpg";
+    } else if (picture.mime_type == "image/png") {
+      extension = ".png";
+    }
+    output_path = fs::path(file_path).stem().string() + std::string(extension);
+  }
+
+  std::ofstream output(output_path, std::ios::binary);
+  output.write(reinterpret_cast<const char *>(picture.data.data()), std::streamsize(picture.data.size()));// NOLINT
+  if (!output) {
+    std::cerr << "Writing the cover failed: " << output_path << "\n";
+    return false;
+  }
+
+  std::cout << "Wrote the " << picture.width << "x" << picture.height << " " << picture.mime_type << " cover to "
+            << output_path << "\n";
+  return true;
+}
+
+void printSegments(StreamRecognizer &recognizer)
+{
+  for (const StreamSegment &segment : recognizer.takeSegments()) {
+    std::cout << segment.start_seconds << "s - " << segment.end_seconds << "s  Song ID: " << segment.song_id
+              << " (confidence " << segment.confidence << ")\n";
+  }
+}
+
+// `-` reads a WAV stream or raw PCM in `raw_format` from stdin, anything else is a FLAC or
+// WAV file. Every source is decoded a chunk at a time as it is matched, so memory stays
+// the same however long the recording is.
+void runStreamMode(const std::string &source, const RawPCMFormat &raw_format)
+{
+  try {
+    SQLiteDB my_db("afs.db");
+
+    if (!afs::run(my_db, "db/migration")) { std::cerr << "Database migration failed, searching anyway.\n"; }
+
+    if (loadFingerprintConfig(my_db).fingerprint_mode != FingerprintMode::Constellation) {
+      std::cerr << "Stream recognition needs a catalogue of constellation hashes.\n";
+      return;
+    }
+
+    constexpr size_t CHUNK_FRAMES = 4096;
+
+    if (source == "-") {
+      PipeAudioFile pipe(raw_format);
+      std::optional<StreamRecognizer> recognizer;
+
+      // The format is only known once the header, if any, has been read.
+      pipe.stream(source, [&](PCMBuffer &&chunk) {
+        if (!recognizer) { recognizer.emplace(my_db, pipe.getSampleRate(), pipe.getNumChannels()); }
+        recognizer->push(convertToDouble(chunk, pipe.getBitDepth()));
+        printSegments(*recognizer);
+      });
+
+      if (!recognizer) {
+        std::cerr << "No samples on stdin.\n";
+        return;
+      }
+
+      recognizer->finish();
+      printSegments(*recognizer);
+      return;
+    }
+
+    const AudioEngine engine;
+    const AudioDecoder *format = engine.probe(source);
+
+    if (format != nullptr && format->name == "flac") {
+      FlacStreamDecoder decoder;
+      if (!decoder.open(source)) {
+        std::cerr << "Failed to load audio file: " << source << "\n";
+        return;
+      }
+
+      const StreamInfo &info = decoder.getStreamInfo();
+      StreamRecognizer recognizer(my_db, info.sample_rate, info.num_channels);
+      std::vector<int32_t> block(size_t(std::max<uint16_t>(info.max_block_size, 1)) * info.num_channels);
+      std::vector<double> samples;
+      const double norm_factor = 1.0 / double(1ULL << (info.bit_depth - 1U));
+
+      for (size_t num_frames = 0; (num_frames = decoder.readFrames(block)) > 0;) {
+        samples.resize(num_frames * info.num_channels);
+        for (size_t i = 0; i < samples.size(); ++i) { samples[i] = double(block[i]) * norm_factor; }
+
+        recognizer.push(samples);
+        printSegments(recognizer);
+      }
+
+      recognizer.finish();
+      printSegments(recognizer);
+      return;
+    }
+
+    if (format == nullptr || format->name != "wav") {
+      std::cerr << "Stream mode reads FLAC and WAV files: " << source << "\n";
+      return;
+    }
+
+    // The file stays mapped and only the window being matched is decoded.
+    WaveFile wave;
+    if (!wave.open(source)) {
+      std::cerr << "Failed to load audio file: " << source << "\n";
+      return;
+    }
+
+    StreamRecognizer recognizer(my_db, wave.getSampleRate(), wave.getNumChannels());
+    const size_t num_frames = wave.getNumFrames();
+
+    for (size_t first = 0; first < num_frames; first += CHUNK_FRAMES) {
+      const PCMBuffer window = wave.decodeWindow(first, std::min(CHUNK_FRAMES, num_frames - first));
+      recognizer.push(convertToDouble(window, wave.getBitDepth()));
+      printSegments(recognizer);
+    }
+
+    recognizer.finish();
+    printSegments(recognizer);
   } catch (const std::exception &e) {
     std::cerr << "An unrecoverable error occurred: " << e.what() << "\n";
     return;
@@ -118,7 +519,44 @@ void printHelp()
   std::cout << "  --version                    Display tool version.\n";
   std::cout << "  --populate <directory_path>  Process audio files in directory_path.\n";
   std::cout << "  --server                     Run a server.\n";
-  std::cout << "  --search <file>              Search for the audio file.\n";
+  std::cout << "  --search <file>...           Search for the audio files, @<list> reads them from a file.\n";
+  std::cout << "  --scan [--update] <path>...   List the stream properties and tags of audio files without\n";
+  std::cout << "                               decoding them, --update writes them to catalogued songs.\n";
+  std::cout << "  --cover <file.flac> [output]  Write the embedded front cover of a FLAC file, named\n";
+  std::cout << "                               after the file by default.\n";
+  std::cout << "  --ingest <name> [format] [rate] [channels]\n";
+  std::cout << "                               Store a WAV stream or raw PCM (default s16le, 44100 Hz, 2\n";
+  std::cout << "                               channels) read from stdin as the song <name>.\n";
+  std::cout << "  --stream <file> | - [format] [rate] [channels]\n";
+  std::cout << "                               Print a timeline of the songs in a long recording, - reads\n";
+  std::cout << "                               a WAV stream or raw PCM from stdin like --ingest.\n";
+}
+
+// A positive decimal that fits T, nullopt for anything else.
+template<typename T> std::optional<T> parseCount(std::string_view arg)
+{
+  T value{};
+  const auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  if (error != std::errc{} || end != arg.data() + arg.size() || value == 0) { return std::nullopt; }
+
+  return value;
+}
+
+// The [format] [rate] [channels] arguments of --ingest and --stream.
+std::optional<RawPCMFormat> parseRawPCMArguments(const std::vector<std::string> &args)
+{
+  const std::string format_name = !args.empty() ? args[0] : "s16le";
+  const std::optional<uint32_t> sample_rate = args.size() > 1 ? parseCount<uint32_t>(args[1]) : 44100U;
+  const std::optional<uint16_t> num_channels = args.size() > 2 ? parseCount<uint16_t>(args[2]) : uint16_t(2);
+  if (!sample_rate || !num_channels) {
+    std::cerr << "The sample rate and the channel count have to be positive integers.\n";
+    return std::nullopt;
+  }
+
+  const std::optional<RawPCMFormat> raw_format = makeRawPCMFormat(format_name, *sample_rate, *num_channels);
+  if (!raw_format) { std::cerr << "Unsupported raw PCM format: " << format_name << "\n"; }
+
+  return raw_format;
 }
 
 void printVersion() { std::cout << "AFS v0.0.1\n"; }
@@ -140,11 +578,19 @@ void runCLIMode(const std::string &directory_path)
     return;
   }
 
+  const AudioEngine engine;
+
   for (const auto &entry : fs::directory_iterator(dir_path)) {
-    if (entry.is_regular_file()) {
-      std::cout << "Processing: " << entry.path().string() << "\n";
-      processAudioFile(entry.path().string());
+    if (!entry.is_regular_file()) { continue; }
+
+    // Covers, playlists and the like cost one small read each and are passed over.
+    if (engine.probe(entry.path().string()) == nullptr) {
+      std::cout << "Skipping: " << entry.path().string() << "\n";
+      continue;
     }
+
+    std::cout << "Processing: " << entry.path().string() << "\n";
+    processAudioFile(engine, entry.path().string());
   }
 
   std::cout << "CLI mode finished. All supported files processed.\n";
@@ -176,7 +622,47 @@ int main(int argc, char *argv[])
   } else if (command == "--server") {
     runServerMode();
   } else if (command == "--search") {
-    searchAudioFile(argv[2]);// NOLINT
+    if (argc <= 2) {
+      std::cerr << "Missing path for audio file.\n";
+      return 1;
+    }
+    searchAudioFiles(expandSearchArguments({ argv + 2, argv + argc }));// NOLINT
+  } else if (command == "--scan") {
+    const bool update = argc > 2 && std::string(argv[2]) == "--update";// NOLINT
+    const int first = update ? 3 : 2;
+    if (argc <= first) {
+      std::cerr << "Missing path for audio file.\n";
+      return 1;
+    }
+    scanAudioFiles({ argv + first, argv + argc }, update);// NOLINT
+  } else if (command == "--cover") {
+    if (argc <= 2) {
+      std::cerr << "Missing path for audio file.\n";
+      return 1;
+    }
+    if (!extractCover(argv[2], argc > 3 ? argv[3] : "")) { return 1; }// NOLINT
+  } else if (command == "--ingest") {
+    if (argc <= 2) {
+      std::cerr << "Missing name for the song.\n";
+      return 1;
+    }
+    const std::optional<RawPCMFormat> raw_format = parseRawPCMArguments({ argv + 3, argv + argc });// NOLINT
+    if (!raw_format) {
+      printHelp();
+      return 1;
+    }
+    ingestStdin(argv[2], *raw_format);// NOLINT
+  } else if (command == "--stream") {
+    if (argc <= 2) {
+      std::cerr << "Missing path for audio file.\n";
+      return 1;
+    }
+    const std::optional<RawPCMFormat> raw_format = parseRawPCMArguments({ argv + 3, argv + argc });// NOLINT
+    if (!raw_format) {
+      printHelp();
+      return 1;
+    }
+    runStreamMode(argv[2], *raw_format);// NOLINT
   } else {
     std::cerr << "Unknown command: " << command << "\n";
     printHelp();
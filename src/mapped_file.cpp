@@ -0,0 +1,140 @@
+#include <afsproject/mapped_file.h>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace afs {
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+{}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+  if (this != &other) {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+  }
+
+  return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &file_path)
+{
+  close();
+
+  HANDLE file = ::CreateFileA(
+    file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) { return false; }// NOLINT
+
+  LARGE_INTEGER file_size{};
+  if (::GetFileType(file) != FILE_TYPE_DISK || ::GetFileSizeEx(file, &file_size) == 0 || file_size.QuadPart <= 0) {
+    ::CloseHandle(file);
+    return false;
+  }
+
+  // The mapping keeps the file open and the view keeps the mapping, both handles can go.
+  HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  ::CloseHandle(file);
+  if (mapping == nullptr) {
+    std::cerr << "Could not map " << file_path << " into memory.\n";
+    return false;
+  }
+
+  const void *addr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  ::CloseHandle(mapping);
+  if (addr == nullptr) {
+    std::cerr << "Could not map " << file_path << " into memory.\n";
+    return false;
+  }
+
+  m_data = static_cast<const uint8_t *>(addr);
+  m_size = size_t(file_size.QuadPart);
+
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (m_data != nullptr) {
+    ::UnmapViewOfFile(m_data);
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+#else
+
+bool MappedFile::open(const std::string &file_path)
+{
+  close();
+
+  const int fd = ::open(file_path.c_str(), O_RDONLY);// NOLINT
+  if (fd < 0) { return false; }
+
+  struct stat file_stat{};
+  if (::fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0) {// NOLINT
+    ::close(fd);
+    return false;
+  }
+
+  const auto size = size_t(file_stat.st_size);
+  void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid once the descriptor is closed.
+  ::close(fd);
+
+  if (addr == MAP_FAILED) {// NOLINT
+    std::cerr << "Could not map " << file_path << " into memory.\n";
+    return false;
+  }
+
+  // Decoding walks the file front to back, let the kernel read ahead aggressively.
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+
+  m_data = static_cast<const uint8_t *>(addr);
+  m_size = size;
+
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (m_data != nullptr) {
+    ::munmap(const_cast<uint8_t *>(m_data), m_size);// NOLINT
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+#endif
+
+std::span<const uint8_t> MappedFile::data() const { return { m_data, m_size }; }
+
+size_t MappedFile::size() const { return m_size; }
+
+bool MappedFile::isOpen() const { return m_data != nullptr; }
+
+}// namespace afs
@@ -0,0 +1,95 @@
+#include <afsproject/md5.h>
+#include <afsproject/md5_worker.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+MD5Worker::MD5Worker(uint16_t bit_depth)
+  : m_bytes_per_sample((bit_depth + 7U) / 8U), m_thread([this] { run(); })
+{}
+
+MD5Worker::~MD5Worker()
+{
+  {
+    const std::lock_guard lock(m_mutex);
+    m_done = true;
+  }
+  m_cv.notify_all();
+
+  if (m_thread.joinable()) { m_thread.join(); }
+}
+
+void MD5Worker::push(std::span<const int32_t> samples)
+{
+  std::unique_lock lock(m_mutex);
+  m_cv.wait(lock, [this] { return m_pending.size() < MAX_PENDING_BLOCKS; });
+
+  // Recycle the buffers the worker is done with so steady state does not allocate.
+  std::vector<int32_t> block;
+  if (!m_free.empty()) {
+    block = std::move(m_free.back());
+    m_free.pop_back();
+  }
+  block.assign(samples.begin(), samples.end());
+
+  m_pending.push_back(std::move(block));
+  lock.unlock();
+  m_cv.notify_all();
+}
+
+std::array<uint8_t, 16> MD5Worker::finish()
+{
+  {
+    const std::lock_guard lock(m_mutex);
+    m_done = true;
+  }
+  m_cv.notify_all();
+
+  if (m_thread.joinable()) { m_thread.join(); }
+
+  return m_md5.finalize();
+}
+
+void MD5Worker::run()
+{
+  while (true) {
+    std::vector<int32_t> block;
+
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [this] { return !m_pending.empty() || m_done; });
+
+      if (m_pending.empty()) { return; }
+
+      block = std::move(m_pending.front());
+      m_pending.pop_front();
+    }
+    m_cv.notify_all();
+
+    hashBlock(block);
+
+    const std::lock_guard lock(m_mutex);
+    m_free.push_back(std::move(block));
+  }
+}
+
+void MD5Worker::hashBlock(const std::vector<int32_t> &samples)
+{
+  m_bytes.resize(samples.size() * m_bytes_per_sample);
+
+  size_t l = 0;// NOLINT
+  for (const int32_t sample : samples) {
+    const auto usample = static_cast<uint32_t>(sample);
+    for (size_t k = 0; k < m_bytes_per_sample; ++k, ++l) { m_bytes[l] = static_cast<uint8_t>(usample >> (k << 3U)); }
+  }
+
+  m_md5.update(m_bytes.data(), m_bytes.size());
+}
+
+}// namespace afs
@@ -0,0 +1,127 @@
+#include <afsproject/afs.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/peak_extractor.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+namespace {
+
+  // Power below this fraction of the loudest bin is treated as silence, ~ -100 dB.
+  constexpr double SILENCE_FLOOR = 1e-10;
+
+  template<typename T> struct Candidate
+  {
+    size_t block;
+    size_t bin;
+    T power;
+  };
+
+}// namespace
+
+template<typename T>
+void slidingMax(const T *in, T *out, size_t n, size_t stride, size_t radius, std::vector<T> &scratch)
+{
+  if (n == 0) { return; }
+
+  const size_t window = (2 * radius) + 1;
+  // The input padded with `radius` lowest values on both sides, rounded up to whole blocks.
+  const size_t padded = ((n + (2 * radius) + window - 1) / window) * window;
+  constexpr T lowest = std::numeric_limits<T>::lowest();
+
+  scratch.resize(2 * padded);
+  T *prefix = scratch.data();
+  T *suffix = scratch.data() + padded;// NOLINT
+
+  for (size_t i = 0; i < padded; ++i) {
+    const T value = (i >= radius && i - radius < n) ? in[(i - radius) * stride] : lowest;// NOLINT
+    prefix[i] = (i % window == 0) ? value : std::max(prefix[i - 1], value);// NOLINT
+    suffix[i] = value;// NOLINT
+  }
+
+  for (size_t i = padded - 1; i-- > 0;) {
+    if ((i + 1) % window != 0) { suffix[i] = std::max(suffix[i], suffix[i + 1]); }// NOLINT
+  }
+
+  // Output i covers padded [i, i + window - 1], which spans at most two blocks.
+  for (size_t i = 0; i < n; ++i) { out[i * stride] = std::max(suffix[i], prefix[i + window - 1]); }// NOLINT
+}
+
+template<typename T>
+Matrix extractLocalMaxima(std::span<const T> power, size_t num_blocks, size_t num_bins, const FingerprintConfig &config)
+{
+  Matrix matrix(num_blocks);
+  if (num_blocks == 0 || num_bins == 0) { return matrix; }
+
+  // 1. Separable 2D max filter, along the frequency axis and then along the time axis
+  std::vector<T> neighbourhood_max(power.size());
+  std::vector<T> scratch;
+
+  for (size_t b = 0; b < num_blocks; ++b) {
+    const T *row = power.data() + (b * num_bins);// NOLINT
+    slidingMax(row, neighbourhood_max.data() + (b * num_bins), num_bins, 1, config.peak_freq_radius, scratch);// NOLINT
+  }
+
+  for (size_t k = 0; k < num_bins; ++k) {
+    T *column = neighbourhood_max.data() + k;// NOLINT
+    slidingMax(column, column, num_blocks, num_bins, config.peak_time_radius, scratch);
+  }
+
+  // 2. A bin is a peak when it is the maximum of its neighbourhood and not silence
+  const T loudest = *std::ranges::max_element(power);
+  const T floor = std::max(T(loudest * T(SILENCE_FLOOR)), std::numeric_limits<T>::min());
+
+  std::vector<Candidate<T>> candidates;
+  for (size_t b = 0; b < num_blocks; ++b) {
+    for (size_t k = 0; k < num_bins; ++k) {
+      const T value = power[(b * num_bins) + k];
+      if (value >= floor && value == neighbourhood_max[(b * num_bins) + k]) { candidates.push_back({ b, k, value }); }
+    }
+  }
+
+  // 3. Adaptive threshold: in every second of signal keep only the strongest peaks that
+  // fit the budget
+  const auto blocks_per_second = std::max<size_t>(1, size_t(std::lround(1.0 / config.time_step)));
+  const auto budget = std::max<size_t>(1, size_t(std::lround(config.peaks_per_second)));
+
+  auto by_power = [](const Candidate<T> &a, const Candidate<T> &c) { return a.power > c.power; };// NOLINT
+  auto by_position = [](const Candidate<T> &a, const Candidate<T> &c) {// NOLINT
+    return std::pair(a.block, a.bin) < std::pair(c.block, c.bin);
+  };
+
+  size_t first = 0;
+  while (first < candidates.size()) {
+    const size_t segment = candidates[first].block / blocks_per_second;
+    size_t last = first;
+    while (last < candidates.size() && candidates[last].block / blocks_per_second == segment) { ++last; }
+
+    const auto begin = candidates.begin() + ptrdiff_t(first);
+    auto end = candidates.begin() + ptrdiff_t(last);
+
+    if (last - first > budget) {
+      std::nth_element(begin, begin + ptrdiff_t(budget), end, by_power);
+      // Back to time, then frequency order for the pairing.
+      end = begin + ptrdiff_t(budget);
+      std::sort(begin, end, by_position);
+    }
+
+    for (auto it = begin; it != end; ++it) { matrix[it->block].emplace_back(int(it->bin), std::sqrt(double(it->power))); }
+
+    first = last;
+  }
+
+  return matrix;
+}
+
+template void slidingMax<float>(const float *, float *, size_t, size_t, size_t, std::vector<float> &);
+template void slidingMax<double>(const double *, double *, size_t, size_t, size_t, std::vector<double> &);
+template Matrix extractLocalMaxima<float>(std::span<const float>, size_t, size_t, const FingerprintConfig &);
+template Matrix extractLocalMaxima<double>(std::span<const double>, size_t, size_t, const FingerprintConfig &);
+
+}// namespace afs
@@ -0,0 +1,266 @@
+#include <afsproject/audio_file.h>
+#include <afsproject/pipe_audio_file.h>
+#include <afsproject/wave_file.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace afs {
+
+namespace {
+
+  uint32_t readLE32(std::span<const uint8_t> bytes)
+  {
+    return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8U) | (uint32_t(bytes[2]) << 16U)// NOLINT
+           | (uint32_t(bytes[3]) << 24U);// NOLINT
+  }
+
+  uint16_t readLE16(std::span<const uint8_t> bytes) { return uint16_t(bytes[0] | (bytes[1] << 8U)); }// NOLINT
+
+  // Reads up to `size` bytes, fewer only at the end of the stream.
+  size_t readBytes(std::istream &in, uint8_t *data, size_t size)
+  {
+    in.read(reinterpret_cast<char *>(data), std::streamsize(size));// NOLINT
+    return size_t(in.gcount());
+  }
+
+  // Appends `chunk` to `samples`, both hold the same sample type. The first chunk is taken
+  // as it is and sets that type.
+  void appendSamples(PCMBuffer &samples, PCMBuffer &&chunk)
+  {
+    if (std::holds_alternative<std::monostate>(samples)) {
+      samples = std::move(chunk);
+      return;
+    }
+
+    std::visit(
+      [](auto &buffer, auto &&more) {
+        using T = std::decay_t<decltype(buffer)>;
+        if constexpr (std::is_same_v<T, std::decay_t<decltype(more)>> && !std::is_same_v<T, std::monostate>) {
+          buffer.insert(buffer.end(), more.begin(), more.end());
+        }
+      },
+      samples,
+      chunk);
+  }
+
+}// namespace
+
+std::optional<RawPCMFormat> makeRawPCMFormat(const std::string &name, uint32_t sample_rate, uint16_t num_channels)
+{
+  struct NamedFormat
+  {
+    const char *name;
+    WaveFormat format;
+    uint16_t bit_depth;
+  };
+
+  static constexpr std::array<NamedFormat, 6> formats{ {
+    { "u8", WaveFormat::PCM, 8 },
+    { "s16le", WaveFormat::PCM, 16 },
+    { "s24le", WaveFormat::PCM, 24 },
+    { "s32le", WaveFormat::PCM, 32 },
+    { "f32le", WaveFormat::IEEE_FLOAT, 32 },
+    { "f64le", WaveFormat::IEEE_FLOAT, 64 },
+  } };
+
+  const auto named = std::ranges::find_if(formats, [&name](const NamedFormat &f) { return name == f.name; });
+  if (named == formats.end() || sample_rate == 0 || num_channels == 0) { return std::nullopt; }
+
+  return RawPCMFormat{ sample_rate, num_channels, named->format, named->bit_depth };
+}
+
+/*
+ * PipeAudioFile class implementation
+ */
+
+PipeAudioFile::PipeAudioFile(const RawPCMFormat &raw_format) : m_raw_format(raw_format) {}
+
+bool PipeAudioFile::load(const std::string &source)
+{
+  return stream(source, [this](PCMBuffer &&chunk) { appendSamples(m_samples, std::move(chunk)); });
+}
+
+bool PipeAudioFile::load(std::istream &in)
+{
+  return stream(in, [this](PCMBuffer &&chunk) { appendSamples(m_samples, std::move(chunk)); });
+}
+
+bool PipeAudioFile::stream(const std::string &source, const PCMSink &sink)
+{
+  m_file_path = source;
+
+  if (source == "-") { return stream(std::cin, sink); }
+
+  std::ifstream file(source, std::ios::binary);
+  if (!file) {
+    std::cerr << "Opening that stream failed: " << source << "\n";
+    return false;
+  }
+
+  return stream(file, sink);
+}
+
+bool PipeAudioFile::stream(std::istream &in, const PCMSink &sink)
+{
+  m_pcm_data.clear();
+  m_samples = std::monostate{};
+  m_duration_seconds = 0.0;
+
+  // The first 12 bytes tell a WAV stream from raw PCM, for raw PCM they are samples.
+  std::array<uint8_t, 12> head{};
+  const size_t head_size = readBytes(in, head.data(), head.size());
+  const auto magic = std::span<const uint8_t>(head).first(head_size);
+
+  const bool is_wave = head_size == head.size() && std::ranges::equal(magic.first(4), std::string_view("RIFF"))
+                       && std::ranges::equal(magic.subspan(8, 4), std::string_view("WAVE"));
+
+  if (!is_wave) { return readSamples(in, m_raw_format, magic, UINT64_MAX, sink); }
+
+  uint64_t data_size = 0;
+  const std::optional<RawPCMFormat> format = readWaveHeader(in, data_size);
+  if (!format) { return false; }
+
+  return readSamples(in, *format, {}, data_size, sink);
+}
+
+std::optional<RawPCMFormat> PipeAudioFile::readWaveHeader(std::istream &in, uint64_t &data_size)
+{
+  std::optional<RawPCMFormat> format;
+  std::array<uint8_t, 8> chunk_header{};
+
+  // Chunks in stream order up to the data chunk, everything but fmt is skipped.
+  while (readBytes(in, chunk_header.data(), chunk_header.size()) == chunk_header.size()) {
+    const std::string id(chunk_header.begin(), chunk_header.begin() + 4);
+    const uint32_t size = readLE32(std::span(chunk_header).subspan(4));
+
+    if (id == "data") {
+      if (!format) { break; }
+
+      data_size = (size == 0 || size == UNKNOWN_DATA_SIZE) ? UINT64_MAX : size;
+      return format;
+    }
+
+    if (id == "fmt " && size >= 16) {// NOLINT
+      std::vector<uint8_t> fmt(size + (size & 1U));
+      if (readBytes(in, fmt.data(), fmt.size()) != fmt.size()) { break; }
+
+      auto wave_format = WaveFormat(readLE16(fmt));
+      // Extensible streams carry the actual format in the first two bytes of their sub format GUID.
+      if (wave_format == WaveFormat::EXTENSIBLE && size >= 26) { wave_format = WaveFormat(readLE16(std::span(fmt).subspan(24))); }// NOLINT
+
+      format = RawPCMFormat{ readLE32(std::span(fmt).subspan(4)),
+        readLE16(std::span(fmt).subspan(2)),
+        wave_format,
+        readLE16(std::span(fmt).subspan(14)) };// NOLINT
+    } else {
+      // Chunks are padded to an even size.
+      in.ignore(std::streamsize(size) + std::streamsize(size & 1U));
+    }
+  }
+
+  std::cerr << "The WAV stream has no fmt chunk before its data.\n";
+  return std::nullopt;
+}
+
+bool PipeAudioFile::readSamples(std::istream &in,
+  const RawPCMFormat &format,
+  std::span<const uint8_t> prefix,
+  uint64_t data_size,
+  const PCMSink &sink)
+{
+  const WaveDecodeKernel kernel = WaveFile::findDecodeKernel(format.format, format.bit_depth);
+  if (kernel == nullptr || format.num_channels == 0 || format.sample_rate == 0) {
+    std::cerr << "That stream format (" << uint16_t(format.format) << ", " << format.bit_depth
+              << " bits) is not supported.\n";
+    return false;
+  }
+
+  m_sample_rate = format.sample_rate;
+  m_num_channels = format.num_channels;
+  m_bit_depth = format.bit_depth;
+  m_format_tag = uint16_t(format.format);
+
+  // Whole frames are decoded chunk by chunk, a partial one is carried to the next read.
+  const size_t block_align = size_t(format.bit_depth / 8) * format.num_channels;// NOLINT
+  std::vector<uint8_t> buffer(READ_CHUNK_SIZE + block_align);
+  std::ranges::copy(prefix.first(std::min<size_t>(prefix.size(), data_size)), buffer.begin());
+
+  size_t filled = std::min<size_t>(prefix.size(), data_size);
+  uint64_t remaining = data_size - filled;
+  size_t num_samples = 0;
+
+  while (true) {
+    // The raw PCM prefix can be longer than a frame, the first read fills what is left.
+    const size_t wanted = size_t(std::min<uint64_t>(buffer.size() - filled, remaining));
+    const size_t count = wanted > 0 ? readBytes(in, buffer.data() + filled, wanted) : 0;// NOLINT
+    filled += count;
+    remaining -= count;
+
+    const size_t whole = filled - (filled % block_align);
+    if (whole > 0) {
+      PCMBuffer chunk = kernel(std::span<const uint8_t>(buffer).first(whole));
+      num_samples += getNumStoredSamples(chunk);
+      sink(std::move(chunk));
+    }
+
+    std::copy(buffer.begin() + std::ptrdiff_t(whole), buffer.begin() + std::ptrdiff_t(filled), buffer.begin());
+    filled -= whole;
+
+    if (count == 0) { break; }
+  }
+
+  m_duration_seconds = double(num_samples / m_num_channels) / double(m_sample_rate);
+
+  return num_samples > 0;
+}
+
+bool PipeAudioFile::save([[maybe_unused]] const std::string &file_path) const { return false; }
+
+std::vector<double> PipeAudioFile::getPCMData() const
+{
+  if (m_pcm_data.empty()) { return convertToDouble(m_samples, m_bit_depth); }
+
+  return m_pcm_data;
+}
+
+uint32_t PipeAudioFile::getSampleRate() const { return m_sample_rate; }
+
+uint16_t PipeAudioFile::getNumChannels() const { return m_num_channels; }
+
+double PipeAudioFile::getDurationSeconds() const
+{
+  // A stream hands its samples to the sink, only their length is left.
+  if (getNumSamplesPerChannel() == 0) { return m_duration_seconds; }
+
+  return double(getNumSamplesPerChannel()) / double(m_sample_rate);
+}
+
+bool PipeAudioFile::isMono() const { return getNumChannels() == 1; }
+
+bool PipeAudioFile::isStereo() const { return getNumChannels() == 2; }
+
+uint16_t PipeAudioFile::getBitDepth() const { return m_bit_depth; }
+
+int PipeAudioFile::getNumSamplesPerChannel() const
+{
+  const size_t num_samples = m_pcm_data.empty() ? getNumStoredSamples(m_samples) : m_pcm_data.size();
+  return m_num_channels > 0 ? int(num_samples / m_num_channels) : 0;
+}
+
+Metadata PipeAudioFile::getMetadata() const { return m_metadata; }
+
+}// namespace afs
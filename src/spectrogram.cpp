@@ -1,59 +1,91 @@
 #include <NumCpp/NdArray/NdArrayCore.hpp>
 #include <afsproject/spectrogram.h>
 #include <afsproject/spectrum.h>
+#include <algorithm>
+#include <complex>
 #include <cstddef>
-#include <map>
+#include <iterator>
 #include <matplot/freestanding/axes_functions.h>
 #include <matplot/freestanding/plot.h>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
 namespace afs {
 
-Spectrogram::Spectrogram(std::map<double, Spectrum> spec_map, int seg_length)
-  : m_spec_map(std::move(spec_map)), m_seg_length(seg_length)
+Spectrogram::Spectrogram(std::vector<std::complex<double>> hs,// NOLINT
+  std::vector<double> amps,
+  std::vector<double> times,
+  std::vector<double> frequencies,
+  int seg_length,
+  int framerate,
+  SpectrogramKind kind)
+  : m_hs(std::move(hs)), m_amps(std::move(amps)), m_times(std::move(times)), m_frequencies(std::move(frequencies)),
+    m_seg_length(seg_length), m_framerate(framerate), m_kind(kind)
 {}
 
-const Spectrum &Spectrogram::anySpectrum() const { return m_spec_map.begin()->second; }
+SpectrogramKind Spectrogram::kind() const { return m_kind; }
 
-double Spectrogram::timeRes() const
+size_t Spectrogram::numTimes() const { return m_times.size(); }
+
+size_t Spectrogram::numFrequencies() const { return m_frequencies.size(); }
+
+Spectrum Spectrogram::anySpectrum() const { return spectrum(0); }
+
+Spectrum Spectrogram::spectrum(size_t time_idx) const
 {
-  const Spectrum &spectrum = anySpectrum();
-  return static_cast<double>(m_seg_length) / spectrum.getFramerate();
+  if (kind() != SpectrogramKind::Complex) {
+    throw std::logic_error("A real valued spectrogram has no phase to build a spectrum from.");
+  }
+  if (time_idx >= numTimes()) { throw std::out_of_range("The spectrogram has no segment at that index."); }
+
+  const std::span<const std::complex<double>> bins = segment(time_idx);
+  nc::NdArray<std::complex<double>> hs(1, uint32_t(bins.size()));
+  std::ranges::copy(bins, hs.begin());
+  const nc::NdArray<double> fs(m_frequencies.begin(), m_frequencies.end());
+
+  return { hs, fs, m_framerate, size_t(m_seg_length) };
 }
 
-double Spectrogram::freqRes() const { return anySpectrum().freqRes(); }
+double Spectrogram::timeRes() const { return static_cast<double>(m_seg_length) / m_framerate; }
+
+double Spectrogram::freqRes() const { return static_cast<double>(m_framerate) / 2.0 / double(numFrequencies() - 1); }
 
-std::vector<double> Spectrogram::times() const
+std::span<const double> Spectrogram::times() const { return m_times; }
+
+std::span<const double> Spectrogram::frequencies() const { return m_frequencies; }
+
+std::span<const std::complex<double>> Spectrogram::segment(size_t time_idx) const
 {
-  std::vector<double> ts;// NOLINT
-  ts.reserve(m_spec_map.size());
-  for (const auto &pair : m_spec_map) { ts.push_back(pair.first); }
-  return ts;
+  if (m_hs.empty()) { return {}; }
+
+  return std::span(m_hs).subspan(time_idx * numFrequencies(), numFrequencies());
 }
 
-nc::NdArray<double> Spectrogram::frequencies() const { return anySpectrum().getMfs(); }
+double Spectrogram::amp(size_t time_idx, size_t freq_idx) const
+{
+  const size_t idx = (time_idx * numFrequencies()) + freq_idx;
+  return m_kind == SpectrogramKind::Complex ? std::abs(m_hs[idx]) : m_amps[idx];
+}
 
 void Spectrogram::plot(std::optional<double> high) const
 {
-  const nc::NdArray<double> fs_full = frequencies();// NOLINT
-  long i = high.has_value() ? findIndex(high.value(), fs_full) : -1;// NOLINT
+  const std::span<const double> fs_full = frequencies();// NOLINT
+  size_t i = fs_full.size();// NOLINT
+  if (high.has_value()) {
+    i = size_t(std::distance(fs_full.begin(), std::ranges::lower_bound(fs_full, high.value())));
+    i = std::min(i, fs_full.size() - 1);
+  }
 
-  const std::vector<double> fs(fs_full.begin(), fs_full.begin() + i);// NOLINT
-  const std::vector<double> ts = times();// NOLINT
+  const std::span<const double> ts = times();// NOLINT
 
   // make the array
-  std::vector<std::vector<double>> arr(fs.size(), std::vector<double>(ts.size()));
-
-  size_t j = 0;// NOLINT
-  for (const auto &pair : m_spec_map) {
-    const Spectrum &spectrum = pair.second;
-    const nc::NdArray<double> amps = spectrum.amps();
-    const nc::NdArray<double> amps_slice(amps.begin(), amps.begin() + i);
+  std::vector<std::vector<double>> arr(i, std::vector<double>(ts.size()));
 
-    for (size_t k = 0; k < amps_slice.size(); ++k) { arr[k][j] = amps_slice[int(k)]; }
-    j++;
+  for (size_t j = 0; j < ts.size(); ++j) {// NOLINT
+    for (size_t k = 0; k < i; ++k) { arr[k][j] = amp(j, k); }
   }
 
   // matplot::plot(ts_vec, fs_vec, arr);
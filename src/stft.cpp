@@ -0,0 +1,125 @@
+#include <afsproject/spectral_kernels.h>
+#include <afsproject/spectrogram.h>
+#include <afsproject/stft.h>
+#include <afsproject/window_table.h>
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <fftw3.h>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+STFT::STFT(int seg_length, int hop, WindowKind window)
+  : m_seg_length(seg_length), m_hop(hop), m_num_bins(size_t(seg_length) / 2 + 1),
+    m_window(makeWindow(window, size_t(seg_length)))
+{
+  // NOLINTBEGIN
+  m_in = static_cast<double *>(fftw_malloc(sizeof(double) * size_t(seg_length) * BATCH_SIZE));
+  m_out = reinterpret_cast<std::complex<double> *>(fftw_malloc(sizeof(fftw_complex) * m_num_bins * BATCH_SIZE));
+  // NOLINTEND
+  m_plan = planFor(BATCH_SIZE);
+}
+
+STFT::~STFT()
+{
+  if (m_plan != nullptr) { fftw_destroy_plan(m_plan); }
+  if (m_tail_plan != nullptr) { fftw_destroy_plan(m_tail_plan); }
+  fftw_free(m_in);
+  fftw_free(m_out);
+}
+
+fftw_plan_s *STFT::planFor(size_t batch)
+{
+  // FFTW_UNALIGNED lets the plan run on any output row of the spectrogram buffer.
+  const int n = m_seg_length;// NOLINT
+  return fftw_plan_many_dft_r2c(1,
+    &n,
+    int(batch),
+    m_in,
+    nullptr,
+    1,
+    m_seg_length,
+    reinterpret_cast<fftw_complex *>(m_out),// NOLINT
+    nullptr,
+    1,
+    int(m_num_bins),
+    FFTW_ESTIMATE | FFTW_UNALIGNED);
+}
+
+size_t STFT::numSegments(size_t num_samples) const
+{
+  // A segment is only taken when it ends strictly before the last sample.
+  if (num_samples <= size_t(m_seg_length)) { return 0; }
+
+  return ((num_samples - size_t(m_seg_length) - 1) / size_t(m_hop)) + 1;
+}
+
+Spectrogram STFT::compute(std::span<const double> ys, int framerate, double start_time, SpectrogramKind kind)
+{
+  const size_t num_segments = numSegments(ys.size());
+  const auto seg_length = size_t(m_seg_length);
+
+  std::vector<double> times(num_segments);
+  std::vector<double> frequencies(m_num_bins);
+
+  // The nominal time of a segment is its midpoint.
+  for (size_t s = 0; s < num_segments; ++s) {
+    times[s] = start_time + ((double(s * size_t(m_hop)) + (double(seg_length - 1) / 2.0)) / double(framerate));
+  }
+  for (size_t k = 0; k < m_num_bins; ++k) { frequencies[k] = double(k) * double(framerate) / double(seg_length); }
+
+  std::vector<std::complex<double>> hs;
+  std::vector<double> amps;
+
+  if (kind == SpectrogramKind::Complex) {
+    hs.resize(num_segments * m_num_bins);
+  } else {
+    amps.resize(num_segments * m_num_bins);
+  }
+
+  for (size_t first = 0; first < num_segments; first += BATCH_SIZE) {
+    const size_t batch = std::min(BATCH_SIZE, num_segments - first);
+
+    for (size_t b = 0; b < batch; ++b) {
+      const double *src = ys.data() + ((first + b) * size_t(m_hop));
+      double *dst = m_in + (b * seg_length);// NOLINT
+      for (size_t i = 0; i < seg_length; ++i) { dst[i] = src[i] * m_window[i]; }// NOLINT
+    }
+
+    fftw_plan_s *plan = m_plan;
+    if (batch != BATCH_SIZE) {
+      if (m_tail_plan == nullptr || m_tail_size != batch) {
+        if (m_tail_plan != nullptr) { fftw_destroy_plan(m_tail_plan); }
+        m_tail_plan = planFor(batch);
+        m_tail_size = batch;
+      }
+      plan = m_tail_plan;
+    }
+
+    if (kind == SpectrogramKind::Complex) {
+      // Transform straight into the rows of the spectrogram.
+      fftw_execute_dft_r2c(plan, m_in, reinterpret_cast<fftw_complex *>(hs.data() + (first * m_num_bins)));// NOLINT
+    } else {
+      fftw_execute_dft_r2c(plan, m_in, reinterpret_cast<fftw_complex *>(m_out));// NOLINT
+
+      const size_t count = batch * m_num_bins;
+      const auto *bins = reinterpret_cast<const double *>(m_out);// NOLINT
+      double *dst = amps.data() + (first * m_num_bins);// NOLINT
+
+      if (kind == SpectrogramKind::Magnitude) {
+        magnitudeSpectrum(bins, dst, count);
+      } else if (kind == SpectrogramKind::Power) {
+        powerSpectrum(bins, dst, count);
+      } else {
+        logPowerSpectrum(bins, dst, count);
+      }
+    }
+  }
+
+  return { std::move(hs), std::move(amps), std::move(times), std::move(frequencies), m_seg_length, framerate, kind };
+}
+
+}// namespace afs
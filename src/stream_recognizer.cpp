@@ -0,0 +1,227 @@
+#include <afsproject/afs.h>
+#include <afsproject/audio_file.h>
+#include <afsproject/db.h>
+#include <afsproject/downmix.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/hash_stats.h>
+#include <afsproject/stream_recognizer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <sqlite3.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace afs {
+
+namespace {
+
+  // Votes that decayed below this are dropped, they could not open a segment any more.
+  constexpr double MIN_VOTE = 0.05;
+
+  int64_t floorDiv(int64_t value, int64_t divisor)
+  {
+    const int64_t quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+  }
+
+  // Votes of the best alignment of a song.
+  double bestAlignment(const std::unordered_map<int64_t, std::unordered_map<int64_t, double>> &votes, int64_t song_id)
+  {
+    const auto song = votes.find(song_id);
+    if (song == votes.end()) { return 0.0; }
+
+    double score = 0.0;
+    for (const auto &[bucket, bucket_votes] : song->second) { score = std::max(score, bucket_votes); }
+
+    return score;
+  }
+
+}// namespace
+
+StreamRecognizer::StreamRecognizer(SQLiteDB &db,
+  uint32_t sample_rate,
+  uint16_t num_channels,
+  const StreamSettings &settings)
+  : m_config(loadFingerprintConfig(db)), m_settings(settings), m_sample_rate(sample_rate),
+    m_num_channels(std::max<uint16_t>(num_channels, 1)), m_downmix(makeDownmixMatrix(m_num_channels)),
+    m_select(db, "SELECT song_id, time_offset FROM fingerprints WHERE hash = ?;"), m_hash_stats(db, m_config),
+    m_window_samples(size_t(settings.window_seconds * sample_rate)),
+    m_hop_samples(std::clamp<size_t>(size_t(settings.hop_seconds * sample_rate), 1, m_window_samples))
+{
+  m_window.reserve(m_window_samples);
+}
+
+void StreamRecognizer::push(std::span<const double> samples)
+{
+  const std::vector<double> mono = downmixToMono(samples, m_downmix);
+  const double margin_ms = 500.0 * double(m_window_samples - m_hop_samples) / m_sample_rate;
+  const double hop_ms = 1000.0 * double(m_hop_samples) / m_sample_rate;
+
+  for (size_t consumed = 0; consumed < mono.size();) {
+    const size_t count = std::min(mono.size() - consumed, m_window_samples - m_window.size());
+    m_window.insert(m_window.end(), mono.begin() + std::ptrdiff_t(consumed), mono.begin() + std::ptrdiff_t(consumed + count));
+    consumed += count;
+
+    if (m_window.size() < m_window_samples) { break; }
+
+    // The first window has nothing before it, its leading context is used as well.
+    matchWindow(m_window_start == 0 ? 0.0 : margin_ms, margin_ms + hop_ms);
+
+    m_window.erase(m_window.begin(), m_window.begin() + std::ptrdiff_t(m_hop_samples));
+    m_window_start += m_hop_samples;
+  }
+}
+
+void StreamRecognizer::finish()
+{
+  const double margin_ms = 500.0 * double(m_window_samples - m_hop_samples) / m_sample_rate;
+
+  if (!m_window.empty()) { matchWindow(m_window_start == 0 ? 0.0 : margin_ms, std::numeric_limits<double>::max()); }
+  m_window.clear();
+
+  if (m_open) {
+    m_segments.push_back(*m_open);
+    m_open.reset();
+  }
+}
+
+void StreamRecognizer::pushHashes(const Fingerprint &fingerprints, double start_seconds)
+{
+  vote(fingerprints, int64_t(1000.0 * start_seconds), 0.0, 1000.0 * m_settings.hop_seconds);
+  updateSegments(start_seconds + m_settings.hop_seconds);
+}
+
+std::vector<StreamSegment> StreamRecognizer::takeSegments() { return std::exchange(m_segments, {}); }
+
+void StreamRecognizer::matchWindow(double first_ms, double last_ms)
+{
+  const Fingerprint fingerprints =
+    AFS::computeFingerprints(m_window, m_sample_rate, DEFAULT_SAMPLE_PRECISION, m_config);
+  const auto window_ms = int64_t(1000.0 * double(m_window_start) / m_sample_rate);
+
+  vote(fingerprints, window_ms, first_ms, last_ms);
+
+  // Where the part of the window this hop is about ends
+  const double window_seconds = double(m_window.size()) / m_sample_rate;
+  const double end_seconds = double(window_ms) / 1000.0 + std::min(last_ms / 1000.0, window_seconds);
+
+  updateSegments(end_seconds);
+}
+
+// Adds the votes of the hashes anchored in [first_ms, last_ms) of the window.
+void StreamRecognizer::vote(const Fingerprint &fingerprints, int64_t window_ms, double first_ms, double last_ms)
+{
+  const auto bucket_ms = int64_t(std::max<uint32_t>(m_settings.delta_bucket_ms, 1));
+
+  decayVotes();
+  m_fresh_votes.clear();
+  m_fresh_start_ms.clear();
+
+  // Postings of every hash anchored in the part of the window this hop is about
+  for (auto run = fingerprints.begin(); run != fingerprints.end();) {
+    const uint32_t hash = run->address;
+    const auto run_end =
+      std::find_if(run, fingerprints.end(), [hash](const FingerprintEntry &entry) { return entry.address != hash; });
+
+    const bool in_hop = std::any_of(run, run_end, [&](const FingerprintEntry &entry) {
+      return double(entry.anchor_time) >= first_ms && double(entry.anchor_time) < last_ms;
+    });
+    const uint32_t document_frequency = in_hop ? m_hash_stats.documentFrequency(hash) : 0;
+
+    if (!in_hop || m_hash_stats.isStopHash(document_frequency)) {
+      run = run_end;
+      continue;
+    }
+    const double weight = m_hash_stats.weight(document_frequency);
+
+    m_select.bindInt(1, static_cast<int>(hash));
+
+    while (m_select.step() == SQLITE_ROW) {
+      const int64_t song_id = m_select.columnLongLong(0);
+      const int64_t db_time = m_select.columnLongLong(1);
+
+      for (auto entry = run; entry != run_end; ++entry) {
+        if (double(entry->anchor_time) < first_ms || double(entry->anchor_time) >= last_ms) { continue; }
+
+        const int64_t anchor_ms = window_ms + int64_t(entry->anchor_time);
+        const int64_t bucket = floorDiv(db_time - anchor_ms, bucket_ms);
+        m_votes[song_id][bucket] += weight;
+        m_fresh_votes[song_id][bucket] += weight;
+
+        const auto [first, inserted] = m_fresh_start_ms.try_emplace(song_id, anchor_ms);
+        if (!inserted) { first->second = std::min(first->second, anchor_ms); }
+      }
+    }
+
+    m_select.reset();
+    run = run_end;
+  }
+}
+
+void StreamRecognizer::decayVotes()
+{
+  const double factor = std::exp(-m_settings.hop_seconds / m_settings.decay_seconds);
+
+  for (auto song = m_votes.begin(); song != m_votes.end();) {
+    auto &buckets = song->second;
+    for (auto &[bucket, score] : buckets) { score *= factor; }
+    std::erase_if(buckets, [](const auto &bucket) { return bucket.second < MIN_VOTE; });
+
+    song = buckets.empty() ? m_votes.erase(song) : std::next(song);
+  }
+}
+
+double StreamRecognizer::decayedScore(int64_t song_id) const { return bestAlignment(m_votes, song_id); }
+
+double StreamRecognizer::freshScore(int64_t song_id) const { return bestAlignment(m_fresh_votes, song_id); }
+
+void StreamRecognizer::updateSegments(double end_seconds)
+{
+  // The song this window voted for most and the total of the decayed votes
+  double total = 0.0;
+  int64_t best_song_id = -1;
+  double best_fresh = 0.0;
+
+  for (const auto &[song_id, buckets] : m_votes) {
+    for (const auto &[bucket, score] : buckets) { total += score; }
+
+    const double fresh = freshScore(song_id);
+    if (fresh > best_fresh) {
+      best_fresh = fresh;
+      best_song_id = song_id;
+    }
+  }
+
+  if (m_open) {
+    const double open_score = decayedScore(m_open->song_id);
+    const double open_fresh = freshScore(m_open->song_id);
+    const bool replaced =
+      best_song_id != m_open->song_id && best_fresh >= m_settings.enter_score && best_fresh > open_fresh;
+
+    // The decayed votes keep the segment open over short dropouts, it only grows over
+    // the windows that still vote for it.
+    if (open_score >= m_settings.exit_score && !replaced) {
+      if (open_fresh >= m_settings.exit_score) {
+        m_open->end_seconds = end_seconds;
+        if (total > 0.0) { m_open->confidence = std::max(m_open->confidence, open_score / total); }
+      }
+      return;
+    }
+
+    m_segments.push_back(*m_open);
+    m_open.reset();
+  }
+
+  // A new segment starts at the first hash of this window that voted for its song.
+  if (best_song_id != -1 && best_fresh >= m_settings.enter_score) {
+    const double start_seconds = double(m_fresh_start_ms[best_song_id]) / 1000.0;
+    m_open = StreamSegment{ start_seconds, end_seconds, best_song_id, decayedScore(best_song_id) / total };
+  }
+}
+
+}// namespace afs
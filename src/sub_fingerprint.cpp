@@ -0,0 +1,101 @@
+#include <afsproject/sub_fingerprint.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace afs {
+
+template<typename T>
+SubFingerprint extractSubFingerprints(std::span<const T> power, size_t num_blocks, size_t num_bins, double bin_hz)
+{
+  constexpr size_t num_bands = SUB_FINGERPRINT_BITS + 1;
+  if (num_blocks < 2 || bin_hz <= 0.0) { return {}; }
+
+  // 1. Bin edges of the logarithmic bands, every band gets at least one bin
+  std::array<size_t, num_bands + 1> edges{};
+  const double ratio = SUB_FINGERPRINT_MAX_FREQ / SUB_FINGERPRINT_MIN_FREQ;
+  for (size_t m = 0; m <= num_bands; ++m) {
+    const double freq = SUB_FINGERPRINT_MIN_FREQ * std::pow(ratio, double(m) / double(num_bands));
+    edges[m] = std::min(size_t(freq / bin_hz), num_bins);// NOLINT
+    if (m > 0) { edges[m] = std::max(edges[m], edges[m - 1] + 1); }// NOLINT
+  }
+  if (edges[num_bands] > num_bins) { return {}; }
+
+  // 2. Band energy differences of the previous block, swapped with the current one each step
+  std::array<double, SUB_FINGERPRINT_BITS> previous{};
+  std::array<double, SUB_FINGERPRINT_BITS> current{};
+
+  auto band_differences = [&](size_t block, std::array<double, SUB_FINGERPRINT_BITS> &out) {
+    const T *row = power.data() + (block * num_bins);// NOLINT
+
+    std::array<double, num_bands> energy{};
+    for (size_t m = 0; m < num_bands; ++m) {
+      double sum = 0.0;
+      for (size_t k = edges[m]; k < edges[m + 1]; ++k) { sum += double(row[k]); }// NOLINT
+      energy[m] = sum;// NOLINT
+    }
+
+    for (size_t m = 0; m < SUB_FINGERPRINT_BITS; ++m) { out[m] = energy[m] - energy[m + 1]; }// NOLINT
+  };
+
+  SubFingerprint frames(num_blocks - 1);
+  band_differences(0, previous);
+
+  // 3. One bit per band pair, the sign of the change of its difference
+  for (size_t b = 1; b < num_blocks; ++b) {
+    band_differences(b, current);
+
+    uint32_t word = 0;
+    for (size_t m = 0; m < SUB_FINGERPRINT_BITS; ++m) {
+      if (current[m] - previous[m] > 0.0) { word |= 1U << m; }// NOLINT
+    }
+
+    frames[b - 1] = word;
+    previous.swap(current);
+  }
+
+  return frames;
+}
+
+std::vector<uint8_t> packSubFingerprint(std::span<const uint32_t> frames)
+{
+  std::vector<uint8_t> bytes;
+  bytes.reserve(frames.size() * sizeof(uint32_t));
+  for (const uint32_t word : frames) {
+    for (size_t k = 0; k < sizeof(uint32_t); ++k) { bytes.push_back(uint8_t(word >> (8 * k))); }// NOLINT
+  }
+  return bytes;
+}
+
+SubFingerprint unpackSubFingerprint(std::span<const uint8_t> bytes)
+{
+  SubFingerprint frames(bytes.size() / sizeof(uint32_t));
+  for (size_t i = 0; i < frames.size(); ++i) {
+    uint32_t word = 0;
+    const std::span<const uint8_t> word_bytes = bytes.subspan(i * sizeof(uint32_t), sizeof(uint32_t));
+    for (size_t k = 0; k < sizeof(uint32_t); ++k) { word |= uint32_t(word_bytes[k]) << (8 * k); }// NOLINT
+    frames[i] = word;
+  }
+  return frames;
+}
+
+size_t bitErrors(std::span<const uint32_t> a, std::span<const uint32_t> b)
+{
+  const size_t n = std::min(a.size(), b.size());// NOLINT
+
+  // Plain indexed loop so the compiler can vectorize the xor and popcount.
+  size_t errors = 0;
+  for (size_t i = 0; i < n; ++i) { errors += size_t(std::popcount(a[i] ^ b[i])); }
+
+  return errors;
+}
+
+template SubFingerprint extractSubFingerprints<float>(std::span<const float>, size_t, size_t, double);
+template SubFingerprint extractSubFingerprints<double>(std::span<const double>, size_t, size_t, double);
+
+}// namespace afs
@@ -15,8 +15,10 @@
 #include <afsproject/signal.h>
 #include <afsproject/spectrogram.h>
 #include <afsproject/spectrum.h>
+#include <afsproject/stft.h>
 #include <afsproject/wave.h>
 #include <afsproject/wave_file.h>
+#include <afsproject/window_table.h>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -26,6 +28,7 @@
 #include <matplot/freestanding/axes_functions.h>
 #include <matplot/freestanding/plot.h>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -67,31 +70,11 @@ void Wave::window(nc::NdArray<double> &window) { m_ys *= window; }
 
 Spectrogram Wave::makeSpectrogram(int seg_length, bool win_flag)
 {
-  nc::NdArray<double> window;
+  // Segments overlap by half, the nominal time of each one is its midpoint.
+  STFT stft(seg_length, seg_length / 2, win_flag ? WindowKind::Hamming : WindowKind::Rectangular);
 
-  if (win_flag) { window = nc::hamming(seg_length); }
-
-  int i = 0;// NOLINT
-  int j = seg_length;// NOLINT
-  const int step = seg_length / 2;
-
-  // map time from Spectrum
-  std::map<double, Spectrum> spec_map = {};
-
-  while (j < int(m_ys.size())) {// NOLINT
-    Wave segment = this->slice(i, j);
-    if (win_flag) { segment.window(window); }
-
-    // the nominal time for this segment is the midpoint
-    const double midpoint = (segment.start() + segment.end()) / 2;
-    // spec_map[midpoint] = segment.makeSpectrum();
-    spec_map.insert({ midpoint, segment.makeSpectrum() });
-
-    i += step;
-    j += step;
-  }
-
-  return { spec_map, seg_length };
+  const double start_time = m_ts.size() > 0 ? start() : 0.0;
+  return stft.compute(std::span<const double>(m_ys.data(), m_ys.size()), m_framerate, start_time);
 }
 
 void Wave::plot(std::map<std::string, double> options) const
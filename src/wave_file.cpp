@@ -1,5 +1,6 @@
 #include <afsproject/audio_file.h>
 #include <afsproject/either.h>
+#include <afsproject/mapped_file.h>
 #include <afsproject/wave_file.h>
 #include <algorithm>
 #include <array>
@@ -12,54 +13,111 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <limits>
 #include <span>
-#include <stdexcept>
 #include <string>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace afs {
 
 bool WaveFile::load(const std::string &file_path)
 {
-  std::ifstream file(file_path, std::ios_base::binary);
+  if (!open(file_path)) { return false; }
 
-  if (!file.good()) {
-    std::cerr << "Opening that file failed badly or it doesn't exist in this universe: " << file_path << "\n";
-    return false;
-  }
+  m_pcm_data.clear();
+  m_samples = decodeWindow(0, getNumFrames());
 
-  file.unsetf(std::ios::skipws);
-  file.seekg(0, std::ios::end);
-  auto file_length = file.tellg();
-  file.seekg(0, std::ios::beg);
+  // Everything is decoded, the file itself is not needed anymore.
+  releaseFile();
 
-  m_file_data.resize(static_cast<size_t>(file_length));
+  return true;
+}
 
-  file.read(reinterpret_cast<char *>(m_file_data.data()), file_length);// NOLINT
-  file.close();
+bool WaveFile::open(const std::string &file_path)
+{
+  releaseFile();
+  m_samples = std::monostate{};
+  m_pcm_data.clear();
+  m_metadata = {};
 
-  if (file.gcount() != file_length) {
-    std::cerr << "Uh oh that did not read the entire file data.\n";
-    return false;
+  if (m_mapped_file.open(file_path)) {
+    m_file_view = m_mapped_file.data();
+  } else {
+    // Not something we can map (a pipe, an empty file...), fall back to reading it.
+    std::ifstream file(file_path, std::ios_base::binary);
+
+    if (!file.good()) {
+      std::cerr << "Opening that file failed badly or it doesn't exist in this universe: " << file_path << "\n";
+      return false;
+    }
+
+    // Read in chunks, a pipe has no size to ask for up front.
+    constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+    m_file_data.clear();
+    while (file) {
+      const size_t filled = m_file_data.size();
+      m_file_data.resize(filled + READ_CHUNK_SIZE);
+      file.read(reinterpret_cast<char *>(m_file_data.data() + filled), std::streamsize(READ_CHUNK_SIZE));// NOLINT
+      m_file_data.resize(filled + size_t(file.gcount()));
+    }
+    m_file_view = m_file_data;
   }
 
   constexpr int MIN_FILE_DATA_SIZE = 12;
-  if (m_file_data.size() < MIN_FILE_DATA_SIZE) {
+  if (m_file_view.size() < MIN_FILE_DATA_SIZE) {
     std::cerr << "The file data size is just too short mate.\n";
     return false;
   }
 
+  m_file_path = file_path;
+
   return decodeWaveFile();
 }
 
+bool WaveFile::scan(const std::string &file_path, AudioInfo &info)
+{
+  WaveFile file;
+  if (!file.open(file_path)) { return false; }
+
+  info = { file.m_sample_rate, file.m_num_channels, file.m_bit_depth, file.getNumFrames(), file.m_metadata };
+
+  return true;
+}
+
 bool WaveFile::save(const std::string &file_path) const
 {
   std::vector<uint8_t> data{};
   return encodeWaveFile(data) && writeDataToFile(data, file_path);
 }
 
-std::vector<double> WaveFile::getPCMData() const { return m_pcm_data; };
+std::vector<double> WaveFile::getPCMData() const
+{
+  if (!m_pcm_data.empty()) { return m_pcm_data; }
+
+  if (isLazy()) { return convertToDouble(decodeWindow(0, getNumFrames()), m_bit_depth); }
+
+  return convertToDouble(m_samples, m_bit_depth);
+}
+
+std::vector<double> WaveFile::getMonoPCMData() const
+{
+  if (!isLazy()) { return IAudioFile::getMonoPCMData(); }
+
+  // Decode a window at a time so only the mono output is ever fully resident.
+  const size_t num_frames = getNumFrames();
+  const DownmixMatrix matrix = getDownmixMatrix();
+  std::vector<double> mono;
+  mono.reserve(num_frames);
+
+  for (size_t first = 0; first < num_frames; first += DECODE_WINDOW_FRAMES) {
+    const size_t count = std::min(DECODE_WINDOW_FRAMES, num_frames - first);
+    const std::vector<double> window = downmixToMono(decodeWindow(first, count), m_bit_depth, matrix);
+    mono.insert(mono.end(), window.begin(), window.end());
+  }
+
+  return mono;
+}
 
 uint32_t WaveFile::getSampleRate() const { return m_sample_rate; }
 
@@ -77,20 +135,56 @@ int WaveFile::getNumSamplesPerChannel() const
 {
   if (!m_pcm_data.empty()) {
     return int(m_pcm_data.size());
+  } else if (isLazy()) {
+    return int(getNumFrames() * m_num_channels);
   } else {
-    return 0;
+    return int(getNumStoredSamples(m_samples));
   }
 }
 
 Metadata WaveFile::getMetadata() const { return m_metadata; }
 
+size_t WaveFile::getNumFrames() const
+{
+  if (m_block_align == 0) { return 0; }
+
+  return m_data_view.size() / m_block_align;
+}
+
+WaveDataView WaveFile::getDataView() const
+{
+  return { m_data_view, m_format, m_bit_depth, m_num_channels, getNumFrames() };
+}
+
+PCMBuffer WaveFile::decodeWindow(size_t first_frame, size_t num_frames) const
+{
+  if (m_decode_kernel == nullptr || first_frame >= getNumFrames()) { return {}; }
+
+  num_frames = std::min(num_frames, getNumFrames() - first_frame);
+
+  return m_decode_kernel(m_data_view.subspan(first_frame * m_block_align, num_frames * m_block_align));
+}
+
+bool WaveFile::isLazy() const
+{
+  return std::holds_alternative<std::monostate>(m_samples) && !m_data_view.empty();
+}
+
+void WaveFile::releaseFile()
+{
+  m_data_view = {};
+  m_file_view = {};
+  m_mapped_file.close();
+  m_file_data = {};
+}
+
 WaveHeaderChunk WaveFile::decodeHeaderChunk()
 {
   WaveHeaderChunk header_chunk{};
 
-  header_chunk.ck_id = { m_file_data.begin(), m_file_data.begin() + 4 };
-  header_chunk.ck_size = convFourBytesToInt32(std::span(m_file_data.begin() + 4, m_file_data.begin() + 8));// NOLINT
-  header_chunk.file_type_header = { m_file_data.begin() + 8, m_file_data.begin() + 12 };// NOLINT
+  header_chunk.ck_id = { m_file_view.begin(), m_file_view.begin() + 4 };
+  header_chunk.ck_size = convFourBytesToInt32(m_file_view.subspan(4, 4));// NOLINT
+  header_chunk.file_type_header = { m_file_view.begin() + 8, m_file_view.begin() + 12 };// NOLINT
 
   return header_chunk;
 }
@@ -108,7 +202,11 @@ Either<WaveFmtChunk, std::string> WaveFile::decodeFmtChunk()
                       .join();
 
   int f = fmt_chunk.index;// NOLINT
-  auto idx = m_file_data.begin() + f;
+  if (f < 0 || size_t(f) + 24 > m_file_view.size()) {// NOLINT
+    const std::string msg{ "There is no complete fmt chunk in this file.\n" };
+    return right(msg);
+  }
+  auto idx = m_file_view.begin() + f;
 
   fmt_chunk.ck_id = { idx, idx + 4 };
   // NOLINTBEGIN
@@ -119,13 +217,19 @@ Either<WaveFmtChunk, std::string> WaveFile::decodeFmtChunk()
   fmt_chunk.n_avg_bytes_per_sec = convFourBytesToInt32(std::span(idx + 16, idx + 20));
   fmt_chunk.n_block_align = convTwoBytesToInt16(std::span(idx + 20, idx + 22));
   fmt_chunk.bit_depth = convTwoBytesToInt16(std::span(idx + 22, idx + 24));
-  // NOLINTEND
 
-  // TODO: Add more format tags to handle here
-  /*if (fmt_chunk.format_tag != WaveFormat::PCM) {
-    const std::string msg{ "That wave format is not supported or not a wave format at all.\n" };
-    return right(msg);
-  }*/
+  if (fmt_chunk.format_tag == int16_t(WaveFormat::EXTENSIBLE)) {
+    if (fmt_chunk.ck_size < 40 || size_t(f) + 8 + 40 > m_file_view.size()) {
+      const std::string msg{ "The extensible fmt chunk is too short to hold its extension.\n" };
+      return right(msg);
+    }
+
+    fmt_chunk.valid_bits = convTwoBytesToInt16(std::span(idx + 26, idx + 28));
+    fmt_chunk.channel_mask = convFourBytesToInt32(std::span(idx + 28, idx + 32));
+    // The sub format GUID starts with the format tag it stands for.
+    fmt_chunk.sub_format = convTwoBytesToInt16(std::span(idx + 32, idx + 34));
+  }
+  // NOLINTEND
 
   if (fmt_chunk.n_channels < 1 || fmt_chunk.n_channels > 128) {// NOLINT
     const std::string msg{ "The number of channels is just to high or too low, who knows.\n" };
@@ -139,7 +243,7 @@ Either<WaveFmtChunk, std::string> WaveFile::decodeFmtChunk()
   }
 
   if (fmt_chunk.bit_depth != 8 && fmt_chunk.bit_depth != 16 && fmt_chunk.bit_depth != 24// NOLINT
-      && fmt_chunk.bit_depth != 32) {// NOLINT
+      && fmt_chunk.bit_depth != 32 && fmt_chunk.bit_depth != 64) {// NOLINT
     const std::string msg{ "Somehow this bit depth is not valid, HOW!?\n" };
     return right(msg);
   }
@@ -160,7 +264,11 @@ WaveDataChunk WaveFile::decodeDataChunk()
                        .join();
 
   int d = data_chunk.index;// NOLINT
-  auto idx = m_file_data.begin() + d;
+  if (d < 0 || size_t(d) + 8 > m_file_view.size()) {// NOLINT
+    data_chunk.index = -1;
+    return data_chunk;
+  }
+  auto idx = m_file_view.begin() + d;
 
   data_chunk.ck_id = { idx, idx + 4 };
   data_chunk.ck_size = convFourBytesToInt32(std::span(idx + 4, idx + 8));// NOLINT
@@ -168,64 +276,191 @@ WaveDataChunk WaveFile::decodeDataChunk()
   return data_chunk;
 }
 
-void WaveFile::decode8Bits(const WaveFmtChunk &fmt_chunk, const std::vector<uint8_t> &data)
+void WaveFile::decodeInfoChunks()
 {
-  if (fmt_chunk.n_channels == 1) {
-    for (size_t i = 0; i < m_pcm_data.size(); ++i) { m_pcm_data[i] = data[i]; }
-  } else {
-    throw std::domain_error("That quantity of channels is still unsupported.");
+  // Only chunk headers are visited, a LIST chunk can sit on either side of the data.
+  size_t idx = 12;// NOLINT
+  while (idx + 8 <= m_file_view.size()) {// NOLINT
+    const size_t body = idx + 8;// NOLINT
+    const auto ck_size = size_t(uint32_t(convFourBytesToInt32(m_file_view.subspan(idx + 4, 4))));
+
+    // Also stops at a streamed data chunk whose size was never filled in.
+    if (ck_size > m_file_view.size() - body) { return; }
+
+    // LIST chunks come in several kinds, only INFO holds the tags.
+    if (std::memcmp(&m_file_view[idx], "LIST", 4) == 0 && ck_size >= 4
+        && std::memcmp(&m_file_view[body], "INFO", 4) == 0) {
+      decodeInfoTags(m_file_view.subspan(body + 4, ck_size - 4));
+    }
+
+    idx = body + ck_size + (ck_size & 1U);
+  }
+}
+
+void WaveFile::decodeInfoTags(std::span<const uint8_t> tags)
+{
+  size_t idx = 0;
+  while (idx + 8 <= tags.size()) {// NOLINT
+    const std::string tag_id(tags.begin() + long(idx), tags.begin() + long(idx) + 4);
+    const auto tag_size = size_t(uint32_t(convFourBytesToInt32(tags.subspan(idx + 4, 4))));
+    const size_t text = idx + 8;// NOLINT
+    if (tag_size > tags.size() - text) { return; }
+
+    // The text is zero terminated, most writers pad it with more zeros.
+    const auto value_bytes = tags.subspan(text, tag_size);
+    const auto end = std::ranges::find(value_bytes, uint8_t{ 0 });
+    const std::string value(value_bytes.begin(), end);
+
+    if (tag_id == "INAM") { m_metadata.title = value; }
+    if (tag_id == "IART") { m_metadata.artist = value; }
+    if (tag_id == "IPRD") { m_metadata.album = value; }
+    if (tag_id == "IGNR") { m_metadata.genre = value; }
+    if (tag_id == "ICRD") { m_metadata.date = value; }
+
+    idx = text + tag_size + (tag_size & 1U);
   }
 }
 
-void WaveFile::decode16Bits(const WaveFmtChunk &fmt_chunk, const std::vector<uint8_t> &data)
+// The kernels below convert straight from the file buffer into the sample buffer. Where
+// the file layout already matches the in-memory one it is a plain copy, the rest are
+// simple loops the compiler widens with SIMD.
+
+PCMBuffer WaveFile::decode8Bits(std::span<const uint8_t> data)
+{
+  // 8-bit samples are unsigned, re-center them around zero.
+  std::vector<int16_t> samples(data.size());
+  for (size_t i = 0; i < data.size(); ++i) { samples[i] = static_cast<int16_t>(int16_t(data[i]) - 128); }// NOLINT
+
+  return samples;
+}
+
+PCMBuffer WaveFile::decode16Bits(std::span<const uint8_t> data)
 {
-  if (fmt_chunk.n_channels == 1) {
-    for (size_t i = 0, k = 0; i < m_pcm_data.size(); ++i, k += 2) {
-      double sample = static_cast<int16_t>((data[k + 1] << 8) | data[k]);// NOLINT
-      m_pcm_data[i] = sample;
+  std::vector<int16_t> samples(data.size() / 2);
+
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(samples.data(), data.data(), samples.size() * sizeof(int16_t));
+  } else {
+    for (size_t i = 0, k = 0; i < samples.size(); ++i, k += 2) {
+      samples[i] = static_cast<int16_t>((data[k + 1] << 8) | data[k]);// NOLINT
     }
-  } else if (fmt_chunk.n_channels == 2) {
-    size_t k = 0;// NOLINT
-    for (size_t i = 0; i < m_pcm_data.size() - 1; i += 2) {
-      int16_t leftSample = static_cast<int16_t>((data[k + 1] << 8) | data[k]);// NOLINT
-      int16_t rightSample = static_cast<int16_t>((data[k + 3] << 8) | data[k + 2]);// NOLINT
-      m_pcm_data[i] = leftSample;
-      m_pcm_data[i + 1] = rightSample;// NOLINT
-      k += 4;
+  }
+
+  return samples;
+}
+
+PCMBuffer WaveFile::decode24Bits(std::span<const uint8_t> data)
+{
+  std::vector<int32_t> samples(data.size() / 3);
+
+  for (size_t i = 0, k = 0; i < samples.size(); ++i, k += 3) {
+    // Put the three bytes at the top of the word and shift back down to sign extend.
+    const uint32_t value = (uint32_t(data[k]) << 8U) | (uint32_t(data[k + 1]) << 16U) | (uint32_t(data[k + 2]) << 24U);// NOLINT
+    samples[i] = static_cast<int32_t>(value) >> 8;// NOLINT
+  }
+
+  return samples;
+}
+
+PCMBuffer WaveFile::decode32Bits(std::span<const uint8_t> data)
+{
+  std::vector<int32_t> samples(data.size() / 4);
+
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(samples.data(), data.data(), samples.size() * sizeof(int32_t));
+  } else {
+    for (size_t i = 0, k = 0; i < samples.size(); ++i, k += 4) {
+      samples[i] = convFourBytesToInt32(data.subspan(k, 4));
     }
+  }
+
+  return samples;
+}
+
+PCMBuffer WaveFile::decodeFloat32Bits(std::span<const uint8_t> data)
+{
+  std::vector<float> samples(data.size() / 4);
+
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(samples.data(), data.data(), samples.size() * sizeof(float));
   } else {
-    throw std::domain_error("That quantity of chanels is still unsupported.");
+    for (size_t i = 0, k = 0; i < samples.size(); ++i, k += 4) {
+      const auto value = uint32_t(convFourBytesToInt32(data.subspan(k, 4)));
+      samples[i] = std::bit_cast<float>(value);
+    }
   }
+
+  return samples;
 }
 
-bool WaveFile::decodeSamples(const WaveFmtChunk &fmt_chunk, const WaveDataChunk &data_chunk)
+PCMBuffer WaveFile::decodeFloat64Bits(std::span<const uint8_t> data)
 {
-  std::vector<uint8_t> data(size_t(data_chunk.ck_size));
-  int offset = data_chunk.index + 8;// NOLINT
+  std::vector<double> samples(data.size() / 8);// NOLINT
 
-  if (offset + data_chunk.ck_size <= int(m_file_data.size())) {
-    std::copy(m_file_data.begin() + offset, m_file_data.begin() + offset + data_chunk.ck_size, data.begin());
+  if constexpr (std::endian::native == std::endian::little) {
+    std::memcpy(samples.data(), data.data(), samples.size() * sizeof(double));
+  } else {
+    for (size_t i = 0, k = 0; i < samples.size(); ++i, k += 8) {// NOLINT
+      uint64_t value = 0;
+      for (size_t b = 0; b < 8; ++b) { value |= uint64_t(data[k + b]) << (b * 8); }// NOLINT
+      samples[i] = std::bit_cast<double>(value);
+    }
   }
 
-  int bytes_per_sample = fmt_chunk.bit_depth / 8;// NOLINT
-  auto num_samples = size_t(data_chunk.ck_size / (bytes_per_sample * fmt_chunk.n_channels));
+  return samples;
+}
 
-  m_pcm_data.clear();
-  m_pcm_data.resize(num_samples);
+WaveDecodeKernel WaveFile::findDecodeKernel(WaveFormat format, uint16_t bit_depth)
+{
+  struct DecodeKernel
+  {
+    WaveFormat format;
+    uint16_t bit_depth;
+    WaveDecodeKernel decode;
+  };
+
+  static constexpr std::array<DecodeKernel, 6> kernels{ {
+    { WaveFormat::PCM, 8, &WaveFile::decode8Bits },
+    { WaveFormat::PCM, 16, &WaveFile::decode16Bits },
+    { WaveFormat::PCM, 24, &WaveFile::decode24Bits },
+    { WaveFormat::PCM, 32, &WaveFile::decode32Bits },
+    { WaveFormat::IEEE_FLOAT, 32, &WaveFile::decodeFloat32Bits },
+    { WaveFormat::IEEE_FLOAT, 64, &WaveFile::decodeFloat64Bits },
+  } };
+
+  const auto kernel =
+    std::ranges::find_if(kernels, [&](const DecodeKernel &k) { return k.format == format && k.bit_depth == bit_depth; });
+
+  return kernel == kernels.end() ? nullptr : kernel->decode;
+}
 
-  if (fmt_chunk.bit_depth == 8) {// NOLINT
-    decode8Bits(fmt_chunk, data);
-  } else if (fmt_chunk.bit_depth == 16) {// NOLINT
-    decode16Bits(fmt_chunk, data);
-  } else if (fmt_chunk.bit_depth == 24) {// NOLINT
-    static_assert(true, "Not implemented!");
-  } else if (fmt_chunk.bit_depth == 32) {// NOLINT
-    static_assert(true, "Not implemented!");
+bool WaveFile::prepareSamples(const WaveFmtChunk &fmt_chunk, const WaveDataChunk &data_chunk)
+{
+  // Extensible files carry the actual format in their sub format GUID.
+  auto format = WaveFormat(uint16_t(fmt_chunk.format_tag));
+  if (format == WaveFormat::EXTENSIBLE) { format = WaveFormat(uint16_t(fmt_chunk.sub_format)); }
+
+  const WaveDecodeKernel kernel = findDecodeKernel(format, uint16_t(fmt_chunk.bit_depth));
+
+  if (kernel == nullptr) {
+    std::cerr << "That wave format (" << uint16_t(format) << ", " << fmt_chunk.bit_depth
+              << " bits) is not supported.\n";
+    return false;
   }
 
-  // Scale down samples to [-1,1]
-  m_pcm_data = scaleDownSamples(m_pcm_data);
+  const size_t offset = size_t(data_chunk.index) + 8;// NOLINT
+  if (offset > m_file_view.size()) { return false; }
 
+  // The chunk size is unsigned, long captures go past 2 GiB. A truncated data chunk still
+  // gives us every sample up to the end of the file.
+  const size_t data_size = std::min(size_t(uint32_t(data_chunk.ck_size)), m_file_view.size() - offset);
+  m_block_align = size_t(fmt_chunk.bit_depth / 8) * size_t(fmt_chunk.n_channels);// NOLINT
+  m_data_view = m_file_view.subspan(offset, data_size - (data_size % m_block_align));
+  m_format = format;
+  m_decode_kernel = kernel;
+
+  // Nothing is decoded yet, decodeWindow() converts from the file bytes on demand and
+  // samples stay in their native type until they are scaled to [-1,1] as doubles.
   return true;
 }
 
@@ -252,8 +487,11 @@ bool WaveFile::decodeWaveFile()
   m_bit_depth = uint16_t(fmt_chunk.bit_depth);
   m_num_channels = uint16_t(fmt_chunk.n_channels);
   m_format_tag = uint16_t(fmt_chunk.format_tag);
+  m_channel_mask = uint32_t(fmt_chunk.channel_mask);
+
+  decodeInfoChunks();
 
-  return decodeSamples(fmt_chunk, data_chunk);
+  return prepareSamples(fmt_chunk, data_chunk);
 }
 
 Either<size_t, std::string> WaveFile::getIdxOfChunk(const std::string &ck_id, size_t start_idx)
@@ -266,24 +504,24 @@ Either<size_t, std::string> WaveFile::getIdxOfChunk(const std::string &ck_id, si
   }
 
   size_t idx = start_idx;
-  while (idx < m_file_data.size() - req_len) {
-    if (std::memcmp(&m_file_data[idx], ck_id.data(), req_len) == 0) { return left(idx); }
+  while (idx + req_len <= m_file_view.size()) {
+    if (std::memcmp(&m_file_view[idx], ck_id.data(), req_len) == 0) { return left(idx); }
 
     idx += req_len;
 
-    if ((idx + 4) >= m_file_data.size()) {
+    if ((idx + 4) >= m_file_view.size()) {
       const std::string msg{ "It seems like we have ran out of data to read.\n" };
       return right(msg);
     }
 
-    const int32_t ck_size =
-      convFourBytesToInt32(std::span(m_file_data.begin() + long(idx), m_file_data.begin() + long(idx) + 4));
-    if (ck_size > static_cast<int32_t>(m_file_data.size() - idx - req_len) || (ck_size < 0)) {// NOLINT
+    const int32_t ck_size = convFourBytesToInt32(m_file_view.subspan(idx, 4));
+    if (size_t(ck_size) > m_file_view.size() - idx - req_len || (ck_size < 0)) {// NOLINT
       const std::string msg{ "The chunk size we got is somehow invalid.\n" };
       return right(msg);
     }
 
-    idx += (req_len + size_t(ck_size));
+    // Chunks are padded to an even size.
+    idx += (req_len + size_t(ck_size) + (size_t(ck_size) & 1U));
   }
 
   const std::string msg{ "We could not find a chunk with that ID.\n" };
@@ -366,53 +604,41 @@ void WaveFile::encodeDataChunk(std::vector<uint8_t> &data) const
   }
 }
 
-void WaveFile::encode8Bits(std::vector<uint8_t> &data) const
+std::vector<int32_t> WaveFile::getIntegerSamples() const
 {
-  if (getNumChannels() == 1) {
-    for (const double sampleDbl : m_pcm_data) {
-      const uint8_t sample =
-        static_cast<uint8_t>(std::round(std::max(static_cast<double>(std::numeric_limits<uint8_t>::min()),
-          std::min(static_cast<double>(std::numeric_limits<uint8_t>::max()), sampleDbl))));
-      data.push_back(sample);
-    }
-  } else {
-    throw std::domain_error("That quantity of channels is not supported yet!");
+  if (const auto *samples = std::get_if<std::vector<int16_t>>(&m_samples)) {
+    return { samples->begin(), samples->end() };
   }
-}
+  if (const auto *samples = std::get_if<std::vector<int32_t>>(&m_samples)) { return *samples; }
 
-void WaveFile::encode16Bits(std::vector<uint8_t> &data) const
-{
-  if (getNumChannels() == 1) {
-    for (const double sampleDbl : m_pcm_data) {
-      const int16_t sample =
-        static_cast<int16_t>(std::round(std::max(static_cast<double>(std::numeric_limits<int16_t>::min()),
-          std::min(static_cast<double>(std::numeric_limits<int16_t>::max()), sampleDbl))));
+  // Floating point samples and the ones replaced through setPCMData() are in [-1,1],
+  // scale them back to full range.
+  const std::vector<double> pcm_data = getPCMData();
+  const double full_scale = double(1U << (m_bit_depth - 1U));
+  const double max_value = full_scale - 1.0;
+  std::vector<int32_t> samples(pcm_data.size());
 
-      data.push_back(static_cast<uint8_t>(sample & 0xFF));// NOLINT
-      data.push_back(static_cast<uint8_t>((sample >> 8) & 0xFF));// NOLINT
-    }
-  } else if (getNumChannels() == 2) {
-    for (size_t i = 0; i < m_pcm_data.size(); i += 2) {
-      const int16_t leftSample =
-        static_cast<int16_t>(std::round(std::max(static_cast<double>(std::numeric_limits<int16_t>::min()),
-          std::min(static_cast<double>(std::numeric_limits<int16_t>::max()), m_pcm_data[i]))));
+  for (size_t i = 0; i < pcm_data.size(); ++i) {
+    samples[i] = static_cast<int32_t>(std::round(std::clamp(pcm_data[i] * full_scale, -full_scale, max_value)));
+  }
 
-      const int16_t rightSample =
-        static_cast<int16_t>(std::round(std::max(static_cast<double>(std::numeric_limits<int16_t>::min()),
-          std::min(static_cast<double>(std::numeric_limits<int16_t>::max()), m_pcm_data[i + 1]))));
+  return samples;
+}
 
-      data.push_back(static_cast<uint8_t>(leftSample & 0xFF));// NOLINT
-      data.push_back(static_cast<uint8_t>((leftSample >> 8) & 0xFF));// NOLINT
+void WaveFile::encode8Bits(std::vector<uint8_t> &data) const
+{
+  for (const int32_t sample : getIntegerSamples()) { data.push_back(static_cast<uint8_t>(sample + 128)); }// NOLINT
+}
 
-      data.push_back(static_cast<uint8_t>(rightSample & 0xFF));// NOLINT
-      data.push_back(static_cast<uint8_t>((rightSample >> 8) & 0xFF));// NOLINT
-    }
-  } else {
-    throw std::domain_error("That quantity of channels is unsupported.");
+void WaveFile::encode16Bits(std::vector<uint8_t> &data) const
+{
+  for (const int32_t sample : getIntegerSamples()) {
+    data.push_back(static_cast<uint8_t>(sample & 0xFF));// NOLINT
+    data.push_back(static_cast<uint8_t>((sample >> 8) & 0xFF));// NOLINT
   }
 }
 
-int32_t convFourBytesToInt32(std::span<uint8_t> data, std::endian endianness)
+int32_t convFourBytesToInt32(std::span<const uint8_t> data, std::endian endianness)
 {
   int32_t result = -1;
 
@@ -425,7 +651,7 @@ int32_t convFourBytesToInt32(std::span<uint8_t> data, std::endian endianness)
   return result;
 }
 
-int16_t convTwoBytesToInt16(std::span<uint8_t> data, std::endian endianness)
+int16_t convTwoBytesToInt16(std::span<const uint8_t> data, std::endian endianness)
 {
   int16_t result = -1;
 
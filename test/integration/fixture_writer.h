@@ -0,0 +1,358 @@
+#ifndef fixture_writer_h_
+#define fixture_writer_h_
+
+#include <afsproject/crc.h>
+#include <afsproject/md5.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace afs::test {
+
+// Writes `bytes` to a file in the temp directory and returns its path.
+inline std::string writeFixture(const std::string &name, std::span<const uint8_t> bytes)
+{
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / ("afs_test_" + name);
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(bytes.data()), std::streamsize(bytes.size()));// NOLINT
+  return path.string();
+}
+
+inline void appendLE(std::vector<uint8_t> &out, uint64_t value, size_t num_bytes)
+{
+  for (size_t i = 0; i < num_bytes; ++i) { out.push_back(uint8_t((value >> (8 * i)) & 0xFFU)); }
+}
+
+inline void appendBE(std::vector<uint8_t> &out, uint64_t value, size_t num_bytes)
+{
+  for (size_t i = num_bytes; i > 0; --i) { out.push_back(uint8_t((value >> (8 * (i - 1))) & 0xFFU)); }
+}
+
+inline void appendText(std::vector<uint8_t> &out, const std::string &text) { out.insert(out.end(), text.begin(), text.end()); }
+
+/*
+ * WAVE
+ */
+
+// RIFF/WAVE file around `data`, a WAVE_FORMAT_EXTENSIBLE fmt chunk carries `format_tag` as its sub format.
+inline std::vector<uint8_t> makeWave(uint16_t format_tag,
+  uint16_t num_channels,
+  uint32_t sample_rate,
+  uint16_t bit_depth,
+  std::span<const uint8_t> data,
+  bool extensible = false)
+{
+  const uint32_t block_align = uint32_t(num_channels) * ((uint32_t(bit_depth) + 7) / 8);
+  std::vector<uint8_t> fmt;
+  appendLE(fmt, extensible ? 0xFFFEU : format_tag, 2);
+  appendLE(fmt, num_channels, 2);
+  appendLE(fmt, sample_rate, 4);
+  appendLE(fmt, uint64_t(sample_rate) * block_align, 4);
+  appendLE(fmt, block_align, 2);
+  appendLE(fmt, bit_depth, 2);
+  if (extensible) {
+    appendLE(fmt, 22, 2);// NOLINT
+    appendLE(fmt, bit_depth, 2);
+    appendLE(fmt, 0, 4);
+    // Sub format GUID, the format tag followed by the fixed KSDATAFORMAT suffix.
+    appendLE(fmt, format_tag, 2);
+    const std::array<uint8_t, 14> suffix = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+    fmt.insert(fmt.end(), suffix.begin(), suffix.end());
+  }
+
+  std::vector<uint8_t> out;
+  appendText(out, "RIFF");
+  appendLE(out, 4 + 8 + fmt.size() + 8 + data.size() + (data.size() % 2), 4);
+  appendText(out, "WAVE");
+  appendText(out, "fmt ");
+  appendLE(out, fmt.size(), 4);
+  out.insert(out.end(), fmt.begin(), fmt.end());
+  appendText(out, "data");
+  appendLE(out, data.size(), 4);
+  out.insert(out.end(), data.begin(), data.end());
+  if (data.size() % 2 != 0) { out.push_back(0); }
+
+  return out;
+}
+
+/*
+ * FLAC
+ */
+
+class BitWriter
+{
+public:
+  void write(uint64_t value, unsigned num_bits)
+  {
+    for (unsigned i = num_bits; i > 0; --i) {
+      m_current = uint8_t((m_current << 1U) | ((value >> (i - 1)) & 1U));
+      if (++m_num_bits == 8) { flush(); }
+    }
+  }
+
+  void writeSigned(int64_t value, unsigned num_bits)
+  {
+    write(uint64_t(value) & ((uint64_t(1) << num_bits) - 1), num_bits);
+  }
+
+  void skip(unsigned num_bits)
+  {
+    for (unsigned i = 0; i < num_bits; ++i) { write(0, 1); }
+  }
+
+  void alignToByte()
+  {
+    while (m_num_bits != 0) { write(0, 1); }
+  }
+
+  [[nodiscard]] const std::vector<uint8_t> &bytes() const { return m_bytes; }
+
+private:
+  std::vector<uint8_t> m_bytes;
+  uint8_t m_current{};
+  unsigned m_num_bits{};
+
+  void flush()
+  {
+    m_bytes.push_back(m_current);
+    m_current = 0;
+    m_num_bits = 0;
+  }
+};
+
+// Channel assignments of a FLAC frame header.
+enum class ChannelAssignment : uint8_t { Independent, LeftSide = 8, SideRight = 9, MidSide = 10 };
+
+struct FlacSpec
+{
+  uint32_t sample_rate = 44100;
+  uint16_t bit_depth = 16;
+  uint16_t num_channels = 2;
+  uint16_t block_size = 1024;
+  ChannelAssignment assignment = ChannelAssignment::Independent;
+  // Low bits every sample of every subframe has zeroed, marked in the subframe headers.
+  unsigned wasted_bits{};
+  // Order 2 fixed prediction with a Rice coded residual instead of verbatim subframes.
+  bool fixed_predictor = false;
+  // Metadata blocks after STREAMINFO, type and body.
+  std::vector<std::pair<uint8_t, std::vector<uint8_t>>> blocks;
+};
+
+// Order 2 fixed predictor subframe body: the warm-up samples and a single partition of
+// Rice coded residual.
+inline void writeFixedSubframe(BitWriter &frame, std::span<const int64_t> signal, unsigned bits)
+{
+  constexpr size_t order = 2;
+  constexpr unsigned rice_parameter = 14;
+
+  for (size_t i = 0; i < std::min(order, signal.size()); ++i) { frame.writeSigned(signal[i], bits); }
+
+  frame.write(0, 2);// 4 bit Rice parameters
+  frame.write(0, 4);// partition order 0
+  frame.write(rice_parameter, 4);
+  for (size_t i = order; i < signal.size(); ++i) {
+    const int64_t residual = signal[i] - ((2 * signal[i - 1]) - signal[i - 2]);
+    const uint64_t folded = residual >= 0 ? uint64_t(residual) << 1U : (uint64_t(-residual) << 1U) - 1;
+    frame.skip(unsigned(folded >> rice_parameter));
+    frame.write(1, 1);
+    frame.write(folded & ((uint64_t(1) << rice_parameter) - 1), rice_parameter);
+  }
+}
+
+// Encodes interleaved samples with verbatim or fixed subframes, so the file exercises the frame
+// and subframe headers and the channel decorrelation without needing a full encoder.
+inline std::vector<uint8_t> makeFlac(const FlacSpec &spec, std::span<const int32_t> samples)
+{
+  const size_t channels = spec.num_channels;
+  const size_t num_frames = samples.size() / channels;
+
+  // 1. Audio frames
+  std::vector<uint8_t> audio;
+  for (size_t first = 0, number = 0; first < num_frames; first += spec.block_size, ++number) {
+    const size_t block = std::min<size_t>(spec.block_size, num_frames - first);
+
+    BitWriter header;
+    header.write(0xFFF8, 16);// NOLINT
+    header.write(7, 4);// 16 bit block size at the end of the header
+    header.write(0, 4);// sample rate from STREAMINFO
+    header.write(spec.assignment == ChannelAssignment::Independent ? channels - 1 : uint64_t(spec.assignment), 4);
+    header.write(0, 3);// bit depth from STREAMINFO
+    header.write(0, 1);
+    // Frame numbers are UTF-8 coded, two bytes cover every fixture here.
+    if (number < 0x80) {// NOLINT
+      header.write(number, 8);
+    } else {
+      header.write(0xC0U | (number >> 6U), 8);// NOLINT
+      header.write(0x80U | (number & 0x3FU), 8);// NOLINT
+    }
+    header.write(block - 1, 16);// NOLINT
+    header.write(crc8(header.bytes()), 8);
+
+    BitWriter frame = header;
+    for (size_t chn = 0; chn < channels; ++chn) {
+      std::vector<int64_t> subframe(block);
+      unsigned bits = spec.bit_depth;
+      for (size_t i = 0; i < block; ++i) {
+        const int64_t left = samples[((first + i) * channels)];
+        const int64_t right = channels > 1 ? samples[((first + i) * channels) + 1] : 0;
+        const int64_t own = samples[((first + i) * channels) + chn];
+        switch (spec.assignment) {
+        case ChannelAssignment::LeftSide:
+          subframe[i] = chn == 0 ? left : left - right;
+          break;
+        case ChannelAssignment::SideRight:
+          subframe[i] = chn == 0 ? left - right : right;
+          break;
+        case ChannelAssignment::MidSide:
+          subframe[i] = chn == 0 ? (left + right) >> 1 : left - right;
+          break;
+        default:
+          subframe[i] = own;
+          break;
+        }
+      }
+      // The side channel needs one more bit.
+      const bool is_side = (spec.assignment == ChannelAssignment::LeftSide && chn == 1)
+                           || (spec.assignment == ChannelAssignment::SideRight && chn == 0)
+                           || (spec.assignment == ChannelAssignment::MidSide && chn == 1);
+      if (is_side) { ++bits; }
+
+      const bool is_fixed = spec.fixed_predictor && block > 2;
+      frame.write(0, 1);
+      frame.write(is_fixed ? 0b001010U : 0b000001U, 6);// fixed order 2 or verbatim
+      if (spec.wasted_bits > 0) {
+        frame.write(1, 1);
+        frame.write(1, spec.wasted_bits);// k - 1 zeros and a one
+      } else {
+        frame.write(0, 1);
+      }
+
+      for (int64_t &sample : subframe) { sample >>= spec.wasted_bits; }
+      if (is_fixed) {
+        writeFixedSubframe(frame, subframe, bits - spec.wasted_bits);
+      } else {
+        for (const int64_t sample : subframe) { frame.writeSigned(sample, bits - spec.wasted_bits); }
+      }
+    }
+    frame.alignToByte();
+
+    std::vector<uint8_t> bytes = frame.bytes();
+    appendBE(bytes, crc16(bytes), 2);
+    audio.insert(audio.end(), bytes.begin(), bytes.end());
+  }
+
+  // 2. MD5 of the samples, little endian in the width of the bit depth
+  MD5 md5;
+  std::vector<uint8_t> raw;
+  for (const int32_t sample : samples) { appendLE(raw, uint32_t(sample), (size_t(spec.bit_depth) + 7) / 8); }
+  md5.update(raw);
+  const std::array<uint8_t, 16> signature = md5.finalize();
+
+  // 3. STREAMINFO and the other metadata blocks
+  BitWriter info;
+  info.write(spec.block_size, 16);// NOLINT
+  info.write(spec.block_size, 16);// NOLINT
+  info.write(0, 24);// NOLINT
+  info.write(0, 24);// NOLINT
+  info.write(spec.sample_rate, 20);// NOLINT
+  info.write(channels - 1, 3);
+  info.write(spec.bit_depth - 1U, 5);// NOLINT
+  info.write(num_frames, 36);// NOLINT
+  for (const uint8_t byte : signature) { info.write(byte, 8); }
+
+  std::vector<uint8_t> out;
+  appendText(out, "fLaC");
+  out.push_back(spec.blocks.empty() ? 0x80 : 0x00);// NOLINT
+  appendBE(out, info.bytes().size(), 3);
+  out.insert(out.end(), info.bytes().begin(), info.bytes().end());
+  for (size_t i = 0; i < spec.blocks.size(); ++i) {
+    const auto &[type, body] = spec.blocks[i];
+    out.push_back(uint8_t(type | (i + 1 == spec.blocks.size() ? 0x80U : 0U)));// NOLINT
+    appendBE(out, body.size(), 3);
+    out.insert(out.end(), body.begin(), body.end());
+  }
+  out.insert(out.end(), audio.begin(), audio.end());
+
+  return out;
+}
+
+struct CueTrackSpec
+{
+  uint8_t number;
+  uint64_t offset;
+  // INDEX 00 precedes INDEX 01 by this many samples when non-zero.
+  uint64_t pregap{};
+  bool is_audio = true;
+};
+
+// CUESHEET block body, the lead-out track is appended at `lead_out`.
+inline std::vector<uint8_t> makeCueSheetBlock(std::span<const CueTrackSpec> tracks, uint64_t lead_out, bool is_cd = false)
+{
+  BitWriter cue;
+  cue.skip(128 * 8);// NOLINT media catalog number
+  cue.write(is_cd ? 88200 : 0, 64);// NOLINT lead-in samples
+  cue.write(is_cd ? 1 : 0, 1);
+  cue.skip(7 + (258 * 8));// NOLINT reserved
+  cue.write(tracks.size() + 1, 8);
+
+  for (const CueTrackSpec &track : tracks) {
+    // Track offsets are relative to the stream, index offsets relative to the track.
+    const uint64_t track_offset = track.offset - track.pregap;
+    cue.write(track_offset, 64);// NOLINT
+    cue.write(track.number, 8);
+    cue.skip(12 * 8);// NOLINT ISRC
+    cue.write(track.is_audio ? 0 : 1, 1);
+    cue.write(0, 1);
+    cue.skip(6 + (13 * 8));// NOLINT reserved
+    cue.write(track.pregap > 0 ? 2 : 1, 8);
+    if (track.pregap > 0) {
+      cue.write(0, 64);// NOLINT
+      cue.write(0, 8);
+      cue.write(0, 24);// NOLINT
+    }
+    cue.write(track.pregap, 64);// NOLINT
+    cue.write(1, 8);
+    cue.write(0, 24);// NOLINT
+  }
+
+  cue.write(lead_out, 64);// NOLINT
+  cue.write(is_cd ? 170 : 255, 8);// NOLINT
+  cue.skip((12 * 8) + 8 + (13 * 8));// NOLINT
+  cue.write(0, 8);
+
+  return cue.bytes();
+}
+
+// PICTURE block body around `data`.
+inline std::vector<uint8_t> makePictureBlock(uint32_t picture_type,
+  const std::string &mime_type,
+  const std::string &description,
+  uint32_t width,
+  uint32_t height,
+  std::span<const uint8_t> data)
+{
+  std::vector<uint8_t> out;
+  appendBE(out, picture_type, 4);
+  appendBE(out, mime_type.size(), 4);
+  appendText(out, mime_type);
+  appendBE(out, description.size(), 4);
+  appendText(out, description);
+  appendBE(out, width, 4);
+  appendBE(out, height, 4);
+  appendBE(out, 24, 4);// NOLINT
+  appendBE(out, 0, 4);
+  appendBE(out, data.size(), 4);
+  out.insert(out.end(), data.begin(), data.end());
+  return out;
+}
+
+}// namespace afs::test
+
+#endif
@@ -0,0 +1,129 @@
+#include <afsproject/audio_engine.h>
+#include <afsproject/audio_file.h>
+#include <afsproject/flac_file.h>
+#include "fixture_writer.h"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  // 16 bit mono ramp, `num_frames` samples long.
+  std::vector<uint8_t> make_ramp(size_t num_frames)
+  {
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < num_frames; ++i) { appendLE(data, uint16_t(int16_t(int(i) * 16)), 2); }// NOLINT
+    return data;
+  }
+
+  std::vector<uint8_t> to_bytes(const std::string &text) { return { text.begin(), text.end() }; }
+
+  // A decoder for files starting with `magic`, its files hold one second of silence.
+  AudioDecoder make_decoder(const std::string &name, const std::string &magic)
+  {
+    return { name,
+      [magic](std::span<const uint8_t> header) {
+        return header.size() >= magic.size() && std::equal(magic.begin(), magic.end(), header.begin());
+      },
+      [](const std::string &) -> std::unique_ptr<IAudioFile> {
+        auto file = std::make_unique<FlacFile>();
+        file->setPCMData(std::vector<double>(8000, 0.0), 8000, 1);// NOLINT
+        return file;
+      },
+      {} };
+  }
+
+}// namespace
+
+TEST_CASE("A misnamed WAV or FLAC file loads by its content", "[engine][probe]")
+{
+  const afs::AudioEngine engine;
+
+  const std::string wave_path = writeFixture("misnamed_wave.flac", makeWave(1, 1, 8000, 16, make_ramp(500)));
+  REQUIRE(engine.probe(wave_path)->name == "wav");
+  const std::unique_ptr<IAudioFile> wave = engine.loadAudioFile(wave_path);
+  REQUIRE(wave != nullptr);
+  REQUIRE(wave->getSampleRate() == 8000);
+  REQUIRE(wave->getNumSamplesPerChannel() == 500);
+
+  FlacSpec spec;
+  spec.sample_rate = 22050;
+  spec.num_channels = 1;
+  const std::vector<int32_t> samples(3000, 7);// NOLINT
+  const std::string flac_path = writeFixture("misnamed_flac.wav", makeFlac(spec, samples));
+  REQUIRE(engine.probe(flac_path)->name == "flac");
+  const std::unique_ptr<IAudioFile> flac = engine.loadAudioFile(flac_path);
+  REQUIRE(flac != nullptr);
+  REQUIRE(flac->getSampleRate() == 22050);
+  REQUIRE(size_t(flac->getNumSamplesPerChannel()) == samples.size());
+}
+
+TEST_CASE("A file shorter than the probe size is probed on what it holds", "[engine][probe]")
+{
+  const afs::AudioEngine engine;
+
+  // The magic alone is enough to be classified, not to be loaded.
+  const std::string magic_only = writeFixture("magic_only.flac", to_bytes("fLaC"));
+  REQUIRE(engine.probe(magic_only)->name == "flac");
+  REQUIRE(engine.loadAudioFile(magic_only) == nullptr);
+
+  // Cut off before the WAVE tag, and empty.
+  std::vector<uint8_t> riff = to_bytes("RIFF");
+  appendLE(riff, 36, 4);// NOLINT
+  appendText(riff, "WAV");
+  const std::string cut = writeFixture("cut_riff.wav", riff);
+  REQUIRE(engine.probe(cut) == nullptr);
+  REQUIRE(engine.probe(writeFixture("empty.wav", std::vector<uint8_t>())) == nullptr);
+  REQUIRE(engine.probe(std::span<const uint8_t>()) == nullptr);
+}
+
+TEST_CASE("A file no decoder takes is rejected before it is read", "[engine][probe]")
+{
+  const afs::AudioEngine engine;
+
+  std::vector<uint8_t> mp3 = to_bytes("ID3");
+  mp3.resize(4096, 0x55);// NOLINT
+  const std::string path = writeFixture("unsupported.wav", mp3);
+
+  REQUIRE(engine.probe(path) == nullptr);
+  REQUIRE(engine.loadAudioFile(path) == nullptr);
+  AudioInfo info;
+  REQUIRE_FALSE(engine.scanAudioFile(path, info));
+
+  const std::filesystem::path missing = std::filesystem::temp_directory_path() / "afs_test_missing.wav";
+  std::filesystem::remove(missing);
+  REQUIRE(engine.probe(missing.string()) == nullptr);
+  REQUIRE(engine.loadAudioFile(missing.string()) == nullptr);
+}
+
+TEST_CASE("Registered decoders are probed in registration order", "[engine][probe]")
+{
+  afs::AudioEngine engine;
+  engine.registerDecoder(make_decoder("ogg", "OggS"));
+  engine.registerDecoder(make_decoder("ogg_late", "OggS"));
+  // Registered after the built-in WAV decoder, it never sees a WAV file.
+  engine.registerDecoder(make_decoder("riff", "RIFF"));
+
+  const std::string ogg_path = writeFixture("custom.ogg", to_bytes("OggS"));
+  REQUIRE(engine.probe(ogg_path)->name == "ogg");
+  const std::unique_ptr<IAudioFile> ogg = engine.loadAudioFile(ogg_path);
+  REQUIRE(ogg != nullptr);
+  REQUIRE(ogg->getNumSamplesPerChannel() == 8000);
+
+  // No scan, so no stream properties either.
+  AudioInfo info;
+  REQUIRE_FALSE(engine.scanAudioFile(ogg_path, info));
+
+  const std::string wave_path = writeFixture("custom_order.wav", makeWave(1, 1, 8000, 16, make_ramp(10)));
+  REQUIRE(engine.probe(wave_path)->name == "wav");
+}
+
+}// namespace afs::test
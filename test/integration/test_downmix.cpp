@@ -0,0 +1,103 @@
+#include <afsproject/downmix.h>
+#include <afsproject/flac_file.h>
+#include "fixture_writer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  // Interleaved samples that differ in every frame and channel, within +-10000.
+  template<typename S> std::vector<S> make_frames(size_t num_frames, size_t channels)
+  {
+    std::vector<S> samples(num_frames * channels);
+    for (size_t i = 0; i < samples.size(); ++i) { samples[i] = S(int((i * 7919) % 20001) - 10000); }// NOLINT
+    return samples;
+  }
+
+  // Mixes with `downmix` and checks every frame against a plain sum in double precision.
+  template<typename S, typename T> bool mixes_every_frame(size_t num_frames, size_t channels)
+  {
+    const std::vector<S> samples = make_frames<S>(num_frames, channels);
+    const DownmixMatrix matrix = makeDownmixMatrix(uint16_t(channels));
+    constexpr double norm_factor = 1.0 / 32768.0;
+
+    // One spare value past the frames, a kernel writing too far would change it.
+    std::vector<T> out(num_frames + 1, T(42));
+    afs::downmix(std::span<const S>(samples), norm_factor, matrix, std::span<T>(out).first(num_frames));
+    if (out.back() != T(42)) { return false; }
+
+    for (size_t i = 0; i < num_frames; ++i) {
+      double expected = 0.0;
+      for (size_t chn = 0; chn < channels; ++chn) {
+        expected += double(samples[(i * channels) + chn]) * matrix.gains[chn] * norm_factor;
+      }
+      if (std::abs(double(out[i]) - expected) > 1e-6) { return false; }// NOLINT
+    }
+    return true;
+  }
+
+}// namespace
+
+TEST_CASE("Mono downmix matches the average of the channels", "[downmix]")
+{
+  FlacSpec spec;
+  std::vector<int32_t> samples;
+  for (int32_t i = 0; i < 3000; ++i) {// NOLINT
+    samples.push_back((i * 9) - 13000);// NOLINT
+    samples.push_back(12000 - (i * 7));// NOLINT
+  }
+
+  auto flac = std::make_unique<afs::FlacFile>();
+  REQUIRE(flac->load(writeFixture("downmix_stereo.flac", makeFlac(spec, samples))));
+
+  const std::vector<double> pcm_data = flac->getPCMData();
+  const std::vector<double> mono = flac->getMonoPCMData();
+  REQUIRE(mono.size() * 2 == pcm_data.size());
+
+  for (size_t i = 0; i < mono.size(); ++i) {
+    REQUIRE(std::abs(mono[i] - ((pcm_data[2 * i] + pcm_data[(2 * i) + 1]) / 2)) < 1e-12);
+  }
+}
+
+TEST_CASE("5.1 downmix drops the LFE and keeps the level", "[downmix]")
+{
+  // FL FR FC LFE BL BR, the same signal on every channel but the LFE.
+  const std::vector<double> frame = { 0.5, 0.5, 0.5, 1.0, 0.5, 0.5 };
+  std::vector<double> pcm_data;
+  for (size_t i = 0; i < 100; ++i) { pcm_data.insert(pcm_data.end(), frame.begin(), frame.end()); }
+
+  auto flac = std::make_unique<afs::FlacFile>();
+  flac->setPCMData(pcm_data, 48000, 6);
+
+  const std::vector<double> mono = flac->getMonoPCMData();
+  REQUIRE(mono.size() == 100);
+  for (const double sample : mono) { REQUIRE(std::abs(sample - 0.5) < 1e-12); }
+
+  const std::vector<float> mono_float = flac->getMonoPCMDataFloat();
+  REQUIRE(mono_float.size() == 100);
+  for (const float sample : mono_float) { REQUIRE(std::abs(sample - 0.5F) < 1e-6F); }
+}
+
+TEST_CASE("Frames left over after the vector loop are mixed like the others", "[downmix]")
+{
+  // The vector kernels take 8 frames at a time and leave the rest, and for 3 or more
+  // channels also the last full block, to the scalar loop.
+  for (size_t channels = 3; channels <= MAX_DOWNMIX_CHANNELS; ++channels) {
+    for (const size_t num_frames : { 1U, 7U, 8U, 9U, 15U, 16U, 17U, 29U }) {// NOLINT
+      REQUIRE((mixes_every_frame<int16_t, float>(num_frames, channels)));
+      REQUIRE((mixes_every_frame<int32_t, float>(num_frames, channels)));
+      REQUIRE((mixes_every_frame<float, float>(num_frames, channels)));
+      REQUIRE((mixes_every_frame<int16_t, double>(num_frames, channels)));
+      REQUIRE((mixes_every_frame<double, double>(num_frames, channels)));
+    }
+  }
+}
+
+}// namespace afs::test
@@ -0,0 +1,438 @@
+#include <afsproject/afs.h>
+#include <afsproject/db.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/flac_file.h>
+#include <afsproject/sub_fingerprint.h>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <set>
+#include <span>
+#include <sqlite3.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  // A catalogue in memory with every migration applied.
+  std::unique_ptr<afs::SQLiteDB> make_catalogue()
+  {
+    auto db = std::make_unique<afs::SQLiteDB>(":memory:");
+    afs::run(*db, MIGRATION_DIR);
+    return db;
+  }
+
+  // Two seconds of a chirp, enough for a few hundred hashes.
+  std::vector<double> make_chirp(uint32_t sample_rate)
+  {
+    std::vector<double> samples(size_t(sample_rate) * 2);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      const double t = double(i) / double(sample_rate);
+      samples[i] = 0.5 * std::sin(2.0 * std::numbers::pi * (300.0 + (400.0 * t)) * t);
+    }
+    return samples;
+  }
+
+  // `seconds` of tones that change every 60 ms, the same function of time at any rate. Songs
+  // with another `seed` play other tones.
+  std::vector<double> make_melody(uint32_t sample_rate, double seconds, uint32_t seed)
+  {
+    std::vector<double> samples(size_t(double(sample_rate) * seconds));
+    for (size_t i = 0; i < samples.size(); ++i) {
+      const double t = double(i) / double(sample_rate);
+      const auto note = uint32_t(t / 0.06) + 1;// NOLINT
+      double sample = 0.0;
+      for (uint32_t voice = 0; voice < 3; ++voice) {
+        const uint32_t pitch = ((note * 2654435761U) ^ (seed * 40503U) ^ (voice * 97U)) % 1600U;// NOLINT
+        sample += 0.2 * std::sin(2.0 * std::numbers::pi * (350.0 + double(pitch)) * t);
+      }
+      samples[i] = sample;
+    }
+    return samples;
+  }
+
+  // Six seconds of two melodies in stereo, one per channel.
+  std::unique_ptr<afs::FlacFile> make_stereo_melody()
+  {
+    const std::vector<double> left = make_melody(44100, 6.0, 5);// NOLINT
+    const std::vector<double> right = make_melody(44100, 6.0, 6);// NOLINT
+    std::vector<double> interleaved;
+    for (size_t i = 0; i < left.size(); ++i) {
+      interleaved.push_back(left[i]);
+      interleaved.push_back(right[i]);
+    }
+
+    auto audio = std::make_unique<afs::FlacFile>();
+    audio->setPCMData(interleaved, 44100, 2);
+    return audio;
+  }
+
+}// namespace
+
+TEST_CASE("Fingerprint config survives a round trip through the database", "[fingerprint][config]")
+{
+  auto db = make_catalogue();
+
+  afs::FingerprintConfig config;
+  config.fan_out = 7;
+  config.anchor_offset = 1;
+  config.max_time_delta_ms = 2000;
+  config.freq_bits = 10;
+  config.time_delta_bits = 12;
+  config.time_step = 0.032;
+  config.silence_threshold_db = -50.0;
+  config.peak_extractor = afs::PeakExtractor::LocalMax;
+  config.peaks_per_second = 20.0;
+  config.fingerprint_mode = afs::FingerprintMode::SubFingerprint;
+  config.max_bit_error_rate = 0.25;
+  REQUIRE(afs::storeFingerprintConfig(*db, config));
+
+  const afs::FingerprintConfig loaded = afs::loadFingerprintConfig(*db);
+  REQUIRE(loaded.fan_out == config.fan_out);
+  REQUIRE(loaded.anchor_offset == config.anchor_offset);
+  REQUIRE(loaded.max_time_delta_ms == config.max_time_delta_ms);
+  REQUIRE(loaded.freq_bits == config.freq_bits);
+  REQUIRE(loaded.time_delta_bits == config.time_delta_bits);
+  REQUIRE(loaded.time_step == config.time_step);
+  REQUIRE(loaded.silence_threshold_db == config.silence_threshold_db);
+  REQUIRE(loaded.peak_extractor == config.peak_extractor);
+  REQUIRE(loaded.peaks_per_second == config.peaks_per_second);
+  REQUIRE(loaded.fingerprint_mode == config.fingerprint_mode);
+  REQUIRE(loaded.max_bit_error_rate == config.max_bit_error_rate);
+
+  // An invalid config never reaches the table.
+  afs::FingerprintConfig invalid;
+  invalid.fan_out = 0;
+  REQUIRE_FALSE(afs::storeFingerprintConfig(*db, invalid));
+  REQUIRE(afs::loadFingerprintConfig(*db).fan_out == config.fan_out);
+}
+
+TEST_CASE("An open time limit ends where the address would wrap", "[fingerprint][config]")
+{
+  afs::FingerprintConfig config;
+  config.time_delta_bits = 10;
+  config.time_quantum_ms = 2;
+  REQUIRE(config.timeDeltaRangeMs() == 2047);
+  REQUIRE(config.maxTimeDeltaMs() == 2047);
+  REQUIRE(config.isValid());
+
+  // Deltas past the field would alias shorter ones.
+  config.max_time_delta_ms = 2048;
+  REQUIRE_FALSE(config.isValid());
+  config.max_time_delta_ms = 0;
+  config.min_time_delta_ms = 2048;
+  REQUIRE_FALSE(config.isValid());
+
+  // The zone starts late and the fan-out is wide, an anchor runs out of targets before its
+  // fan-out is reached. An open limit has to stop at the same place as the explicit one.
+  afs::FingerprintConfig open;
+  open.time_delta_bits = 10;
+  open.min_time_delta_ms = 900;
+  open.fan_out = 40;// NOLINT
+  afs::FingerprintConfig bounded = open;
+  bounded.max_time_delta_ms = open.timeDeltaRangeMs();
+
+  const std::vector<double> chirp = make_chirp(44100);
+  const afs::Fingerprint open_hashes = afs::AFS::computeFingerprints(chirp, 44100, afs::SamplePrecision::Double, open);
+  REQUIRE(!open_hashes.empty());
+  REQUIRE(open_hashes == afs::AFS::computeFingerprints(chirp, 44100, afs::SamplePrecision::Double, bounded));
+}
+
+TEST_CASE("Storing fingerprints records the config they were built with", "[fingerprint][config]")
+{
+  auto db = make_catalogue();
+  db->execute("DELETE FROM fingerprint_config;");
+  db->execute("INSERT INTO songs (title, artist, file_path) VALUES ('chirp', 'test', 'chirp.wav');");
+
+  auto audio = std::make_unique<afs::FlacFile>();
+  audio->setPCMData(make_chirp(44100), 44100, 1);
+  afs::AFS::storingFingerprints(*audio, sqlite3_last_insert_rowid(db->get()), *db);
+
+  afs::SQLiteDB::Statement stmt(*db, "SELECT fan_out, freq_bits FROM fingerprint_config WHERE id = 1;");
+  REQUIRE(stmt.step() == SQLITE_ROW);
+  REQUIRE(uint32_t(stmt.columnInt(0)) == afs::FingerprintConfig{}.fan_out);
+  REQUIRE(stmt.columnInt(1) == afs::FingerprintConfig{}.freq_bits);
+}
+
+TEST_CASE("A catalogue that has a config keeps it untouched on ingest", "[fingerprint][config]")
+{
+  auto db = make_catalogue();
+  db->execute("INSERT INTO songs (id, title, artist, file_path) VALUES (1, 'chirp', 'test', 'chirp.wav');");
+  db->execute("INSERT INTO songs (id, title, artist, file_path) VALUES (2, 'album', 'test', 'album.flac');");
+
+  // Every write to the config row leaves a mark.
+  db->execute("CREATE TEMP TABLE config_writes (id INTEGER);");
+  db->execute("CREATE TEMP TRIGGER config_insert AFTER INSERT ON fingerprint_config BEGIN INSERT INTO config_writes "
+              "VALUES (NEW.id); END;");
+  db->execute("CREATE TEMP TRIGGER config_update AFTER UPDATE ON fingerprint_config BEGIN INSERT INTO config_writes "
+              "VALUES (NEW.id); END;");
+
+  const std::vector<double> chirp = make_chirp(44100);
+  afs::FlacFile audio;
+  audio.setPCMData(chirp, 44100, 1);
+  afs::AFS::storingFingerprints(audio, 1, *db);
+  const std::vector<afs::TrackSlice> tracks = { { 2, 0, chirp.size() } };
+  afs::AFS::storingTrackFingerprints(chirp, 44100, tracks, *db);
+
+  afs::SQLiteDB::Statement stmt(*db, "SELECT COUNT(*) FROM config_writes;");
+  REQUIRE(stmt.step() == SQLITE_ROW);
+  REQUIRE(stmt.columnInt(0) == 0);
+}
+
+TEST_CASE("An album without tracks stores nothing", "[fingerprint][cuesheet]")
+{
+  auto db = make_catalogue();
+  db->execute("DELETE FROM fingerprint_config;");
+
+  const std::vector<double> mono = make_chirp(44100);
+  afs::AFS::storingTrackFingerprints(mono, 44100, {}, *db);
+
+  afs::SQLiteDB::Statement stmt(*db, "SELECT COUNT(*) FROM fingerprint_config;");
+  REQUIRE(stmt.step() == SQLITE_ROW);
+  REQUIRE(stmt.columnInt(0) == 0);
+}
+
+TEST_CASE("Every song keeps its postings however common its hashes were at ingest", "[fingerprint][stop_hash]")
+{
+  auto db = make_catalogue();
+
+  // With 3 songs a hash in 2 of them is already above the cap.
+  afs::FingerprintConfig config;
+  config.stop_hash_max_fraction = 0.5;
+  config.stop_hash_min_songs = 1;
+  REQUIRE(afs::storeFingerprintConfig(*db, config));
+
+  for (int id = 1; id <= 3; ++id) {
+    const std::string name = "copy" + std::to_string(id);
+    db->execute("INSERT INTO songs (id, title, artist, file_path) VALUES (" + std::to_string(id) + ", '" + name
+                + "', 'test', '" + name + ".wav');");
+  }
+
+  // Three tracks holding the same audio hash the same.
+  const std::vector<double> chirp = make_chirp(44100);
+  std::vector<double> album;
+  for (int copy = 0; copy < 3; ++copy) { album.insert(album.end(), chirp.begin(), chirp.end()); }
+
+  std::vector<afs::TrackSlice> tracks;
+  for (uint64_t i = 0; i < 3; ++i) { tracks.push_back({ static_cast<long long>(i) + 1, i * chirp.size(), (i + 1) * chirp.size() }); }
+  afs::AFS::storingTrackFingerprints(album, 44100, tracks, *db);
+
+  afs::SQLiteDB::Statement stmt(*db, "SELECT COUNT(*) FROM fingerprints WHERE song_id = ?;");
+  std::vector<int> postings;
+  for (int id = 1; id <= 3; ++id) {
+    stmt.bindInt(1, id);
+    REQUIRE(stmt.step() == SQLITE_ROW);
+    postings.push_back(stmt.columnInt(0));
+    stmt.reset();
+  }
+
+  REQUIRE(postings[0] > 0);
+  REQUIRE(postings[1] == postings[0]);
+  REQUIRE(postings[2] == postings[0]);
+}
+
+TEST_CASE("Sub-fingerprints are stored little-endian and found again at any sample rate", "[fingerprint][sub]")
+{
+  auto db = make_catalogue();
+
+  afs::FingerprintConfig config;
+  config.fingerprint_mode = afs::FingerprintMode::SubFingerprint;
+  REQUIRE(afs::storeFingerprintConfig(*db, config));
+
+  for (uint32_t id = 1; id <= 2; ++id) {
+    const std::string name = "melody" + std::to_string(id);
+    db->execute("INSERT INTO songs (id, title, artist, file_path) VALUES (" + std::to_string(id) + ", '" + name
+                + "', 'test', '" + name + ".wav');");
+
+    afs::FlacFile song;
+    song.setPCMData(make_melody(44100, 8.0, id), 44100, 1);// NOLINT
+    afs::AFS::storingFingerprints(song, id, *db);
+  }
+
+  // 1. The BLOB holds the low byte of every frame first
+  const afs::SubFingerprint frames =
+    afs::AFS::computeSubFingerprints(make_melody(44100, 8.0, 2), 44100, afs::SamplePrecision::Double, config);
+  REQUIRE(frames.size() > afs::SUB_FINGERPRINT_BLOCK);
+
+  afs::SQLiteDB::Statement stmt(*db, "SELECT frames FROM sub_fingerprints WHERE song_id = 2;");
+  REQUIRE(stmt.step() == SQLITE_ROW);
+  const std::vector<uint8_t> bytes = stmt.columnBlob(0);
+  REQUIRE(bytes.size() == frames.size() * 4);
+  REQUIRE(bytes[0] == uint8_t(frames[0]));
+  REQUIRE(bytes[3] == uint8_t(frames[0] >> 24U));
+  REQUIRE(afs::unpackSubFingerprint(bytes) == frames);
+
+  // 2. A frame lasts as long at 48 kHz as it does at 44.1 kHz
+  auto excerpt = [&config](uint32_t sample_rate) {
+    const std::vector<double> song = make_melody(sample_rate, 8.0, 2);// NOLINT
+    const auto first = song.begin() + (std::ptrdiff_t(sample_rate) * 3);
+    const std::vector<double> samples(first, first + (std::ptrdiff_t(sample_rate) * 4));
+    return afs::AFS::computeSubFingerprints(samples, sample_rate, afs::SamplePrecision::Double, config);
+  };
+  const afs::SubFingerprint query_frames = excerpt(48000);// NOLINT
+  const afs::SubFingerprint reference_frames = excerpt(44100);// NOLINT
+  REQUIRE(query_frames.size() + 1 >= reference_frames.size());
+  REQUIRE(query_frames.size() <= reference_frames.size() + 1);
+
+  // 3. The excerpt is found in its song, three seconds in
+  const afs::SubFingerprintMatch match = afs::AFS::searchSubFingerprints(query_frames, *db, config);
+  REQUIRE(match.song_id == 2);
+  REQUIRE(match.bit_error_rate < config.max_bit_error_rate);
+  const double frame_ms = 1000.0 * double(config.sub_fingerprint_hop) / double(afs::SUB_FINGERPRINT_SAMPLE_RATE);
+  REQUIRE(std::abs(match.time_offset_ms - 3000) <= int(frame_ms) + 1);
+}
+
+TEST_CASE("A batch of queries matches like each query on its own, every posting list is read once", "[fingerprint][batch]")
+{
+  auto db = make_catalogue();
+  db->execute("INSERT INTO songs (id, title, artist, file_path) VALUES (1, 'one', 'test', 'one.wav');");
+  db->execute("INSERT INTO songs (id, title, artist, file_path) VALUES (2, 'two', 'test', 'two.wav');");
+
+  // Hashes 1-20 are in song 1 at 1000 ms + 10 ms * hash, hashes 15-40 in song 2 at 10 ms * hash.
+  afs::SQLiteDB::Statement insert(*db, "INSERT INTO fingerprints (hash, song_id, time_offset) VALUES (?, ?, ?);");
+  auto add_posting = [&insert](int hash, int song_id, int time_offset) {
+    insert.bindInt(1, hash);
+    insert.bindInt(2, song_id);
+    insert.bindInt(3, time_offset);
+    insert.step();
+    insert.reset();
+  };
+  for (int hash = 1; hash <= 20; ++hash) { add_posting(hash, 1, 1000 + (10 * hash)); }// NOLINT
+  for (int hash = 15; hash <= 40; ++hash) { add_posting(hash, 2, 10 * hash); }// NOLINT
+
+  // Queries heard at 10 ms * hash - `start_ms`, the hashes of neighbouring queries overlap
+  // and one query repeats a hash at two anchor times.
+  auto make_query = [](uint32_t first, uint32_t last, uint32_t start_ms) {
+    afs::Fingerprint query;
+    for (uint32_t hash = first; hash <= last; ++hash) { query.push_back({ hash, (10 * hash) - start_ms }); }// NOLINT
+    return query;
+  };
+  std::vector<afs::Fingerprint> queries = {
+    make_query(1, 12, 0), make_query(8, 22, 50), make_query(18, 40, 100), {}// NOLINT
+  };
+  queries[1].push_back({ 10, 500 });// NOLINT
+
+  // Every fetch of a posting list, by the hash bound to it.
+  std::multiset<std::string> fetches;
+  sqlite3_trace_v2(
+    db->get(),
+    SQLITE_TRACE_STMT,
+    [](unsigned, void *context, void *statement, void *) {
+      char *sql = sqlite3_expanded_sql(static_cast<sqlite3_stmt *>(statement));
+      const std::string text = sql ? sql : "";
+      sqlite3_free(sql);
+      if (text.starts_with("SELECT song_id, time_offset FROM fingerprints WHERE hash = ")) {
+        static_cast<std::multiset<std::string> *>(context)->insert(text);
+      }
+      return 0;
+    },
+    &fetches);
+
+  const afs::FingerprintConfig config;
+  const std::vector<afs::MatchResult> batch = afs::AFS::matchFingerprints(queries, *db, config);
+
+  std::set<uint32_t> hashes;
+  for (const afs::Fingerprint &query : queries) {
+    for (const afs::FingerprintEntry &entry : query) { hashes.insert(entry.address); }
+  }
+  REQUIRE(fetches.size() == hashes.size());
+  REQUIRE(std::set<std::string>(fetches.begin(), fetches.end()).size() == fetches.size());
+  sqlite3_trace_v2(db->get(), 0, nullptr, nullptr);
+
+  REQUIRE(batch.size() == queries.size());
+  REQUIRE(batch[0].song_id == 1);
+  REQUIRE(batch[0].time_offset_ms == 1000);
+  REQUIRE(batch[2].song_id == 2);
+  REQUIRE(batch[2].time_offset_ms == 100);
+  REQUIRE(batch[3].song_id == -1);
+
+  for (size_t q = 0; q < queries.size(); ++q) {
+    const std::vector<afs::MatchResult> single = afs::AFS::matchFingerprints(std::span(&queries[q], 1), *db, config);
+    REQUIRE(single.size() == 1);
+    REQUIRE(batch[q].song_id == single[0].song_id);
+    REQUIRE(batch[q].score == single[0].score);
+    REQUIRE(batch[q].num_matches == single[0].num_matches);
+    REQUIRE(batch[q].time_offset_ms == single[0].time_offset_ms);
+  }
+}
+
+TEST_CASE("Single precision pipeline matches the double one", "[fingerprint][precision]")
+{
+  const auto audio = make_stereo_melody();
+
+  const afs::Fingerprint fgs_double = afs::AFS::computeFingerprints(*audio, afs::SamplePrecision::Double);
+  const afs::Fingerprint fgs_float = afs::AFS::computeFingerprints(*audio, afs::SamplePrecision::Float);
+
+  // Postings come out sorted and unique.
+  REQUIRE(std::ranges::adjacent_find(fgs_double) == fgs_double.end());
+
+  std::set<std::pair<uint32_t, uint32_t>> entries_double;
+  for (const afs::FingerprintEntry &entry : fgs_double) { entries_double.emplace(entry.address, entry.anchor_time); }
+
+  const size_t num_float = fgs_float.size();
+  size_t num_common = 0;
+  for (const afs::FingerprintEntry &entry : fgs_float) {
+    if (entries_double.contains({ entry.address, entry.anchor_time })) { ++num_common; }
+  }
+
+  // A peak that sits right on the band threshold may flip with the rounding, nothing else.
+  REQUIRE(!entries_double.empty());
+  REQUIRE(double(num_common) >= 0.99 * double(std::max(num_float, entries_double.size())));
+}
+
+TEST_CASE("Sub-fingerprints hold up in single precision", "[fingerprint][precision]")
+{
+  const auto audio = make_stereo_melody();
+
+  afs::FingerprintConfig config;
+  config.fingerprint_mode = afs::FingerprintMode::SubFingerprint;
+
+  const afs::SubFingerprint frames_double =
+    afs::AFS::computeSubFingerprints(*audio, afs::SamplePrecision::Double, config);
+  const afs::SubFingerprint frames_float =
+    afs::AFS::computeSubFingerprints(*audio, afs::SamplePrecision::Float, config);
+
+  // One frame per hop at the sub-fingerprint rate, the melody lasts six seconds.
+  REQUIRE(!frames_double.empty());
+  REQUIRE(frames_double.size() == frames_float.size());
+  const double frames_per_second = double(afs::SUB_FINGERPRINT_SAMPLE_RATE) / double(config.sub_fingerprint_hop);
+  REQUIRE(std::abs(double(frames_double.size()) - (6.0 * frames_per_second)) < 10.0);
+
+  const size_t errors = afs::bitErrors(frames_double, frames_float);
+  REQUIRE(double(errors) < 0.05 * double(frames_double.size() * afs::SUB_FINGERPRINT_BITS));
+}
+
+TEST_CASE("Silence gate skips quiet blocks and -inf turns it off", "[fingerprint][silence]")
+{
+  // Four blocks: digital silence, a -80 dBFS hum, a -20 dBFS tone, digital silence.
+  const size_t block = afs::FFT_WINDOW_SIZE;
+  std::vector<double> samples(block * 4, 0.0);
+  for (size_t i = 0; i < block; ++i) {
+    const double phase = 2.0 * std::numbers::pi * double(i) / 64.0;
+    samples[block + i] = 1e-4 * std::sqrt(2.0) * std::sin(phase);
+    samples[(2 * block) + i] = 0.1 * std::sqrt(2.0) * std::sin(phase);
+  }
+  const std::span<const double> pcm(samples);
+
+  const std::vector<uint8_t> gated = afs::AFS::gateSilence(pcm, 4, block, -60.0);
+  const std::vector<uint8_t> expected_gated = { 0, 0, 1, 0 };
+  REQUIRE(gated == expected_gated);
+
+  const std::vector<uint8_t> open = afs::AFS::gateSilence(pcm, 4, block, -std::numeric_limits<double>::infinity());
+  const std::vector<uint8_t> expected_open = { 1, 1, 1, 1 };
+  REQUIRE(open == expected_open);
+
+  // Single precision takes the same path.
+  const std::vector<float> samples_f(samples.begin(), samples.end());
+  REQUIRE(afs::AFS::gateSilence(std::span<const float>(samples_f), 4, block, -60.0) == expected_gated);
+}
+
+}// namespace afs::test
@@ -1,8 +1,20 @@
+#include <afsproject/cue_sheet.h>
 #include <afsproject/flac_file.h>
+#include <afsproject/flac_stream_decoder.h>
+#include <afsproject/md5.h>
+#include "fixture_writer.h"
+#include <algorithm>
+#include <array>
 #include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace afs::test {
 
@@ -17,6 +29,36 @@ protected:
     return find_first_flac(dir);
   }
 
+  // Every sample of the file through the stream decoder, frame CRCs and MD5 checked.
+  static std::vector<int32_t> decode_all(const std::string &path)
+  {
+    afs::FlacStreamDecoder decoder;
+    decoder.setVerifyMode(afs::VerifyMode::Full);
+    if (!decoder.open(path)) { return {}; }
+
+    std::vector<int32_t> samples;
+    std::vector<int32_t> chunk(4096 * size_t(decoder.getStreamInfo().num_channels));
+    size_t num_frames = 0;
+    while ((num_frames = decoder.readFrames(chunk)) > 0) {
+      samples.insert(samples.end(), chunk.begin(), chunk.begin() + long(num_frames * decoder.getStreamInfo().num_channels));
+    }
+
+    if (decoder.failed()) { return {}; }
+    return samples;
+  }
+
+  // A stereo sweep with odd samples, so a dropped lowest bit of mid shows up.
+  static std::vector<int32_t> make_stereo_samples(size_t num_frames, int32_t step)
+  {
+    std::vector<int32_t> samples;
+    for (size_t i = 0; i < num_frames; ++i) {
+      const auto t = int32_t(i % 4000);
+      samples.push_back(((t * 7) - 14000) * step + 1);
+      samples.push_back((15000 - (t * 5)) * step);
+    }
+    return samples;
+  }
+
 private:
   static std::string find_first_flac(const std::string &dir)
   {
@@ -40,4 +82,161 @@ TEST_CASE_METHOD(FlacDecoderFixture, "Load valid stereo FLAC file", "[flac][ster
   REQUIRE(result);
 }
 
+TEST_CASE_METHOD(FlacDecoderFixture, "Full verification accepts an intact file", "[flac][verify]")
+{
+  const std::string path = get_stereo_fixture();
+  REQUIRE(!path.empty());
+
+  auto flac = std::make_unique<afs::FlacFile>();
+  flac->setVerifyMode(afs::VerifyMode::Full);
+  REQUIRE(flac->load(path));
+}
+
+TEST_CASE_METHOD(FlacDecoderFixture, "Stream decoder output matches the STREAMINFO MD5", "[flac][stream]")
+{
+  const std::string path = get_stereo_fixture();
+  REQUIRE(!path.empty());
+
+  // The signature is taken from the file bytes, not from the decoder under test:
+  // "fLaC", the STREAMINFO block header and 18 bytes of stream parameters come first.
+  std::ifstream file(path, std::ios::binary);
+  std::array<char, 42> header{};
+  REQUIRE(file.read(header.data(), header.size()));
+  std::array<uint8_t, 16> expected{};
+  std::memcpy(expected.data(), header.data() + 26, expected.size());
+  REQUIRE(std::ranges::any_of(expected, [](uint8_t byte) { return byte != 0; }));
+
+  afs::FlacStreamDecoder decoder;
+  decoder.setVerifyMode(afs::VerifyMode::Off);
+  REQUIRE(decoder.open(path));
+
+  const auto num_channels = size_t(decoder.getStreamInfo().num_channels);
+  const size_t bytes_per_sample = (size_t(decoder.getStreamInfo().bit_depth) + 7) / 8;
+
+  // A chunk size that does not divide the block size makes reads straddle frames.
+  std::vector<int32_t> chunk(1000 * num_channels);
+  afs::MD5 md5;
+  size_t num_frames = 0;
+
+  while ((num_frames = decoder.readFrames(chunk)) > 0) {
+    for (size_t i = 0; i < num_frames * num_channels; ++i) {
+      // Signed little endian samples in the width of the bit depth.
+      const auto sample = uint32_t(chunk[i]);
+      for (size_t byte = 0; byte < bytes_per_sample; ++byte) {
+        const auto value = uint8_t((sample >> (8 * byte)) & 0xFFU);
+        md5.update(&value, 1);
+      }
+    }
+  }
+
+  REQUIRE(decoder.isEndOfStream());
+  REQUIRE_FALSE(decoder.failed());
+  REQUIRE(md5.finalize() == expected);
+}
+
+TEST_CASE_METHOD(FlacDecoderFixture, "Wasted bits are shifted back into every sample", "[flac][subframe]")
+{
+  // Every sample a multiple of 8, the encoder strips 3 bits from each subframe.
+  std::vector<int32_t> samples = make_stereo_samples(3000, 1);
+  for (int32_t &sample : samples) { sample = (sample / 8) * 8; }
+
+  afs::test::FlacSpec spec;
+  spec.wasted_bits = 3;
+  const std::vector<uint8_t> bytes = afs::test::makeFlac(spec, samples);
+  const std::string path = afs::test::writeFixture("wasted_bits.flac", bytes);
+
+  REQUIRE(decode_all(path) == samples);
+
+  // Prediction has to run on the stripped warm-up samples, the shift comes after it.
+  spec.fixed_predictor = true;
+  const std::string fixed_path = afs::test::writeFixture("wasted_bits_fixed.flac", afs::test::makeFlac(spec, samples));
+  REQUIRE(decode_all(fixed_path) == samples);
+
+  spec.assignment = afs::test::ChannelAssignment::LeftSide;
+  const std::string side_path = afs::test::writeFixture("wasted_bits_side.flac", afs::test::makeFlac(spec, samples));
+  REQUIRE(decode_all(side_path) == samples);
+}
+
+TEST_CASE_METHOD(FlacDecoderFixture, "Side channel assignments restore left and right", "[flac][stereo]")
+{
+  const std::vector<int32_t> samples = make_stereo_samples(5000, 2);
+
+  for (const auto assignment : { afs::test::ChannelAssignment::LeftSide,
+         afs::test::ChannelAssignment::SideRight,
+         afs::test::ChannelAssignment::MidSide }) {
+    afs::test::FlacSpec spec;
+    spec.assignment = assignment;
+    spec.fixed_predictor = true;
+    const std::string path = afs::test::writeFixture(
+      "side_" + std::to_string(int(assignment)) + ".flac", afs::test::makeFlac(spec, samples));
+
+    REQUIRE(decode_all(path) == samples);
+  }
+}
+
+TEST_CASE_METHOD(FlacDecoderFixture, "CUESHEET tracks start at INDEX 01 and end at the lead-out", "[flac][cuesheet]")
+{
+  // Track 2 has a pregap, INDEX 00 at 2500 and INDEX 01 at 3000. The lead-out is short of
+  // the end of the stream.
+  const std::array<CueTrackSpec, 3> tracks = {
+    CueTrackSpec{ .number = 1, .offset = 0 },
+    CueTrackSpec{ .number = 2, .offset = 3000, .pregap = 500 },
+    CueTrackSpec{ .number = 3, .offset = 7000 },
+  };
+  constexpr uint64_t lead_out = 9000;
+
+  for (const bool is_cd : { false, true }) {
+    FlacSpec spec;
+    spec.blocks.emplace_back(uint8_t(5), makeCueSheetBlock(tracks, lead_out, is_cd));
+    const std::vector<int32_t> samples = make_stereo_samples(10 * 1024, 1);
+    const std::string path = writeFixture(is_cd ? "cue_cd.flac" : "cue.flac", makeFlac(spec, samples));
+
+    afs::FlacStreamDecoder decoder;
+    REQUIRE(decoder.open(path));
+    const uint64_t total_samples = decoder.getStreamInfo().total_samples;
+    REQUIRE(total_samples == 10 * 1024);
+
+    // The lead-out is not a track.
+    const std::optional<CueSheet> &cue_sheet = decoder.getCueSheet();
+    REQUIRE(cue_sheet.has_value());
+    REQUIRE(cue_sheet->tracks.size() == tracks.size());
+    REQUIRE(countAudioTracks(*cue_sheet) == tracks.size());
+    REQUIRE(cue_sheet->lead_out == lead_out);
+
+    for (size_t i = 0; i < tracks.size(); ++i) {
+      REQUIRE(cue_sheet->tracks[i].number == tracks[i].number);
+      REQUIRE(cue_sheet->tracks[i].start_sample == tracks[i].offset);
+    }
+
+    // The pregap stays with the previous track, the last one stops at the lead-out.
+    REQUIRE(getTrackEnd(*cue_sheet, 0, total_samples) == 3000);
+    REQUIRE(getTrackEnd(*cue_sheet, 1, total_samples) == 7000);
+    REQUIRE(getTrackEnd(*cue_sheet, 2, total_samples) == lead_out);
+    // A lead-out past the end of the stream is cut to it.
+    REQUIRE(getTrackEnd(*cue_sheet, 2, 8000) == 8000);
+  }
+}
+
+TEST_CASE_METHOD(FlacDecoderFixture, "Range decode matches the same window of a full load", "[flac][stream]")
+{
+  const std::string path = get_stereo_fixture();
+  REQUIRE(!path.empty());
+
+  auto flac = std::make_unique<afs::FlacFile>();
+  REQUIRE(flac->load(path));
+  const std::vector<double> pcm_data = flac->getPCMData();
+  const auto num_channels = size_t(flac->getNumChannels());
+  const size_t num_frames = pcm_data.size() / num_channels;
+
+  // Starts inside a frame, on a frame boundary and a window running past the end.
+  for (const size_t start : { size_t(1000), size_t(4096), num_frames - 100 }) {
+    auto range = std::make_unique<afs::FlacFile>();
+    REQUIRE(range->decodeRange(path, start, 5000));
+
+    const std::vector<double> window = range->getPCMData();
+    REQUIRE(window.size() == std::min<size_t>(5000, num_frames - start) * num_channels);
+    REQUIRE(std::equal(window.begin(), window.end(), pcm_data.begin() + long(start * num_channels)));
+  }
+}
+
 }// namespace afs::test
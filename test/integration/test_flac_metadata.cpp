@@ -0,0 +1,145 @@
+#include <afsproject/audio_file.h>
+#include <afsproject/flac_file.h>
+#include <afsproject/flac_metadata.h>
+#include "fixture_writer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  std::vector<uint8_t> make_vorbis_comment(const std::string &vendor, const std::vector<std::string> &fields)
+  {
+    std::vector<uint8_t> out;
+    appendLE(out, vendor.size(), 4);
+    appendText(out, vendor);
+    appendLE(out, fields.size(), 4);
+    for (const std::string &field : fields) {
+      appendLE(out, field.size(), 4);
+      appendText(out, field);
+    }
+    return out;
+  }
+
+}// namespace
+
+TEST_CASE("Metadata index finds every block, the first frame and the pictures", "[flac][metadata]")
+{
+  const std::vector<uint8_t> back_cover(300, 0xAB);
+  const std::vector<uint8_t> front_cover = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10 };
+
+  FlacSpec spec;
+  spec.blocks.emplace_back(uint8_t(4), make_vorbis_comment("test", { "TITLE=Cover", "ARTIST=Fixture" }));
+  spec.blocks.emplace_back(uint8_t(6), makePictureBlock(4, "image/png", "back", 64, 32, back_cover));
+  spec.blocks.emplace_back(uint8_t(6), makePictureBlock(3, "image/jpeg", "front", 600, 600, front_cover));
+  spec.blocks.emplace_back(uint8_t(1), std::vector<uint8_t>(17, 0));
+
+  const std::vector<int32_t> samples(2 * 1024, 0);
+  const std::vector<uint8_t> file = makeFlac(spec, samples);
+  const std::string path = writeFixture("metadata.flac", file);
+
+  afs::FlacMetadataIndex index;
+  REQUIRE(index.open(path));
+
+  // 1. STREAMINFO and the blocks after it, each body right past a 4 byte header
+  const std::vector<MetadataBlockInfo> &blocks = index.getBlocks();
+  REQUIRE(blocks.size() == spec.blocks.size() + 1);
+  REQUIRE(blocks[0].type == MetadataBlockType::StreamInfo);
+  REQUIRE(blocks[0].offset == 8);
+  REQUIRE(blocks[0].size == 34);
+
+  uint64_t offset = blocks[0].offset + blocks[0].size;
+  for (size_t i = 0; i < spec.blocks.size(); ++i) {
+    offset += 4;
+    REQUIRE(uint8_t(blocks[i + 1].type) == spec.blocks[i].first);
+    REQUIRE(blocks[i + 1].offset == offset);
+    REQUIRE(blocks[i + 1].size == spec.blocks[i].second.size());
+    offset += blocks[i + 1].size;
+  }
+
+  // 2. The first frame follows the last block and starts with the sync code
+  REQUIRE(index.getFirstFrameOffset() == offset);
+  REQUIRE(file[offset] == 0xFF);
+  REQUIRE((file[offset + 1] & 0xFEU) == 0xF8);
+
+  // 3. Tags and pictures, parsed in place
+  const std::optional<VorbisComment> comment = index.getVorbisComment();
+  REQUIRE(comment.has_value());
+  REQUIRE(comment->vendor == "test");
+  REQUIRE(comment->fields.size() == 2);
+  REQUIRE(comment->fields[1].first == "ARTIST");
+  REQUIRE(comment->fields[1].second == "Fixture");
+
+  const std::vector<FlacPicture> pictures = index.getPictures();
+  REQUIRE(pictures.size() == 2);
+  REQUIRE(pictures[0].picture_type == 4);
+  REQUIRE(pictures[0].mime_type == "image/png");
+  REQUIRE(pictures[0].data.size() == back_cover.size());
+  REQUIRE(pictures[1].picture_type == 3);
+  REQUIRE(pictures[1].mime_type == "image/jpeg");
+  REQUIRE(pictures[1].description == "front");
+  REQUIRE(pictures[1].width == 600);
+  REQUIRE(pictures[1].height == 600);
+  REQUIRE(pictures[1].color_depth == 24);
+  REQUIRE(std::vector<uint8_t>(pictures[1].data.begin(), pictures[1].data.end()) == front_cover);
+}
+
+TEST_CASE("Scan reads STREAMINFO and the Vorbis tags without decoding a frame", "[flac][scan]")
+{
+  FlacSpec spec;
+  spec.sample_rate = 96000;
+  spec.bit_depth = 24;
+  spec.num_channels = 2;
+  // Field names are case-insensitive, ALBUMARTIST stands in for ARTIST.
+  spec.blocks.emplace_back(uint8_t(4),
+    make_vorbis_comment(
+      "test", { "title=Scanned", "ALBUMARTIST=Band", "Album=Record", "GENRE=Test", "DATE=2001", "COMMENT=ignored" }));
+  spec.blocks.emplace_back(uint8_t(6), makePictureBlock(3, "image/png", "", 1, 1, std::vector<uint8_t>(64, 1)));
+
+  const std::vector<int32_t> samples(size_t(2) * 1500, 0);
+  std::vector<uint8_t> file = makeFlac(spec, samples);
+
+  // Without any frames left, a scan never reads them.
+  afs::FlacMetadataIndex index;
+  REQUIRE(index.open(writeFixture("scan_full.flac", file)));
+  file.resize(index.getFirstFrameOffset());
+
+  afs::AudioInfo info;
+  REQUIRE(afs::FlacFile::scan(writeFixture("scan.flac", file), info));
+  REQUIRE(info.sample_rate == 96000);
+  REQUIRE(info.num_channels == 2);
+  REQUIRE(info.bit_depth == 24);
+  REQUIRE(info.num_frames == 1500);
+  REQUIRE(info.metadata.title == "Scanned");
+  REQUIRE(info.metadata.artist == "Band");
+  REQUIRE(info.metadata.album == "Record");
+  REQUIRE(info.metadata.genre == "Test");
+  REQUIRE(info.metadata.date == "2001");
+
+  REQUIRE_FALSE(afs::FlacFile::scan(writeFixture("scan_not_flac.flac", std::vector<uint8_t>(64, 0)), info));
+}
+
+TEST_CASE("A truncated picture block is skipped", "[flac][metadata]")
+{
+  std::vector<uint8_t> picture = makePictureBlock(3, "image/jpeg", "", 1, 1, std::vector<uint8_t>(8, 1));
+  REQUIRE(afs::parsePicture(picture).has_value());
+
+  // The data length now claims more bytes than the block holds.
+  picture.pop_back();
+  REQUIRE_FALSE(afs::parsePicture(picture).has_value());
+
+  FlacSpec spec;
+  spec.blocks.emplace_back(uint8_t(6), picture);
+  const std::vector<int32_t> samples(2 * 1024, 0);
+
+  afs::FlacMetadataIndex index;
+  REQUIRE(index.open(writeFixture("bad_picture.flac", makeFlac(spec, samples))));
+  REQUIRE(index.getPictures().empty());
+}
+
+}// namespace afs::test
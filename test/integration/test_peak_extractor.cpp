@@ -0,0 +1,196 @@
+#include <afsproject/afs.h>
+#include <afsproject/fingerprint_config.h>
+#include <afsproject/peak_extractor.h>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  // Reproducible values in [0, 1000), ties included.
+  std::vector<double> make_values(size_t n, uint32_t seed)
+  {
+    std::vector<double> values(n);
+    uint32_t state = seed;
+    for (double &value : values) {
+      state = (state * 1664525U) + 1013904223U;// NOLINT
+      value = double((state >> 8U) % 1000U);// NOLINT
+    }
+    return values;
+  }
+
+  // Maximum over the window by looking at every element of it.
+  std::vector<double> naive_sliding_max(const std::vector<double> &in, size_t radius)
+  {
+    std::vector<double> out(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+      const size_t first = i >= radius ? i - radius : 0;
+      const size_t last = std::min(in.size(), i + radius + 1);
+      out[i] = *std::max_element(in.begin() + std::ptrdiff_t(first), in.begin() + std::ptrdiff_t(last));
+    }
+    return out;
+  }
+
+  // Positions of all peaks in time, then frequency order.
+  std::vector<std::pair<size_t, int>> peak_positions(const Matrix &peaks)
+  {
+    std::vector<std::pair<size_t, int>> positions;
+    for (size_t b = 0; b < peaks.size(); ++b) {
+      for (const auto &[bin, magnitude] : peaks[b]) { positions.emplace_back(b, bin); }
+    }
+    return positions;
+  }
+
+  afs::FingerprintConfig make_config(uint32_t time_radius, uint32_t freq_radius, double peaks_per_second)
+  {
+    afs::FingerprintConfig config;
+    config.peak_time_radius = time_radius;
+    config.peak_freq_radius = freq_radius;
+    config.peaks_per_second = peaks_per_second;
+    config.time_step = 0.1;// NOLINT
+    return config;
+  }
+
+}// namespace
+
+TEST_CASE("Sliding max agrees with a window scan at every length, radius and edge", "[peaks][sliding_max]")
+{
+  std::vector<double> scratch;
+
+  for (size_t n = 1; n <= 40; ++n) {// NOLINT
+    const std::vector<double> in = make_values(n, uint32_t(n));
+    for (size_t radius = 0; radius <= 6; ++radius) {// NOLINT
+      std::vector<double> out(n);
+      afs::slidingMax(in.data(), out.data(), n, 1, radius, scratch);
+      REQUIRE(out == naive_sliding_max(in, radius));
+    }
+  }
+}
+
+TEST_CASE("Sliding max with radius 0 copies its input", "[peaks][sliding_max]")
+{
+  const std::vector<double> in = make_values(17, 3);// NOLINT
+  std::vector<double> out(in.size());
+  std::vector<double> scratch;
+  afs::slidingMax(in.data(), out.data(), in.size(), 1, 0, scratch);
+  REQUIRE(out == in);
+}
+
+TEST_CASE("Sliding max runs in place along a strided column", "[peaks][sliding_max]")
+{
+  // Column 1 of a 3 wide matrix, the other columns are left alone.
+  constexpr size_t stride = 3;
+  const std::vector<double> column = make_values(25, 7);// NOLINT
+  std::vector<double> matrix(column.size() * stride, -1.0);
+  for (size_t i = 0; i < column.size(); ++i) { matrix[(i * stride) + 1] = column[i]; }
+
+  std::vector<double> scratch;
+  afs::slidingMax(matrix.data() + 1, matrix.data() + 1, column.size(), stride, 4, scratch);
+
+  const std::vector<double> expected = naive_sliding_max(column, 4);
+  for (size_t i = 0; i < column.size(); ++i) {
+    REQUIRE(matrix[(i * stride) + 1] == expected[i]);
+    REQUIRE(matrix[i * stride] == -1.0);
+    REQUIRE(matrix[(i * stride) + 2] == -1.0);
+  }
+
+  // Single precision takes the same path.
+  const std::vector<float> in_f(column.begin(), column.end());
+  std::vector<float> out_f(in_f.size());
+  std::vector<float> scratch_f;
+  afs::slidingMax(in_f.data(), out_f.data(), in_f.size(), 1, 4, scratch_f);
+  REQUIRE(std::vector<double>(out_f.begin(), out_f.end()) == expected);
+}
+
+TEST_CASE("Local maxima are found up to the edges of the spectrogram", "[peaks][local_max]")
+{
+  // Peaks in the corners and one in the middle, everything else silent.
+  constexpr size_t num_blocks = 9;
+  constexpr size_t num_bins = 12;
+  std::vector<double> power(num_blocks * num_bins, 0.0);
+  power[0] = 50.0;// NOLINT
+  power[num_bins - 1] = 40.0;// NOLINT
+  power[(4 * num_bins) + 6] = 30.0;// NOLINT
+  power[((num_blocks - 1) * num_bins) + num_bins - 1] = 20.0;// NOLINT
+
+  const Matrix peaks =
+    afs::extractLocalMaxima(std::span<const double>(power), num_blocks, num_bins, make_config(2, 3, 100));
+
+  const std::vector<std::pair<size_t, int>> expected = { { 0, 0 }, { 0, 11 }, { 4, 6 }, { 8, 11 } };
+  REQUIRE(peak_positions(peaks) == expected);
+  // Peaks carry the magnitude, not the power.
+  REQUIRE(peaks[0][0].second == std::sqrt(50.0));
+}
+
+TEST_CASE("Every bin of a plateau is a local maximum", "[peaks][local_max]")
+{
+  // A 2 x 3 plateau, no bin of it is louder than the others.
+  constexpr size_t num_blocks = 6;
+  constexpr size_t num_bins = 8;
+  std::vector<double> power(num_blocks * num_bins, 0.0);
+  for (size_t b = 2; b < 4; ++b) {
+    for (size_t k = 3; k < 6; ++k) { power[(b * num_bins) + k] = 9.0; }// NOLINT
+  }
+
+  const Matrix peaks =
+    afs::extractLocalMaxima(std::span<const double>(power), num_blocks, num_bins, make_config(2, 2, 100));
+
+  const std::vector<std::pair<size_t, int>> expected = { { 2, 3 }, { 2, 4 }, { 2, 5 }, { 3, 3 }, { 3, 4 }, { 3, 5 } };
+  REQUIRE(peak_positions(peaks) == expected);
+}
+
+TEST_CASE("With both radii 0 every audible bin is a peak, silence is none", "[peaks][local_max]")
+{
+  constexpr size_t num_blocks = 3;
+  constexpr size_t num_bins = 4;
+  std::vector<double> power = make_values(num_blocks * num_bins, 11);// NOLINT
+  for (double &value : power) { value += 1.0; }
+  power[5] = 0.0;// NOLINT
+
+  const Matrix peaks =
+    afs::extractLocalMaxima(std::span<const double>(power), num_blocks, num_bins, make_config(0, 0, 100));
+  REQUIRE(peak_positions(peaks).size() == power.size() - 1);
+  REQUIRE(peaks[1].size() == num_bins - 1);
+
+  const std::vector<double> silence(num_blocks * num_bins, 0.0);
+  const Matrix none =
+    afs::extractLocalMaxima(std::span<const double>(silence), num_blocks, num_bins, make_config(0, 0, 100));
+  REQUIRE(peak_positions(none).empty());
+}
+
+TEST_CASE("Each second keeps only its strongest peaks up to the budget", "[peaks][local_max]")
+{
+  // 10 blocks a second, 25 blocks: two full seconds and half of a third. Every block holds
+  // one isolated peak that grows with the block, in a bin that moves around.
+  constexpr size_t num_blocks = 25;
+  constexpr size_t num_bins = 16;
+  std::vector<double> power(num_blocks * num_bins, 0.0);
+  for (size_t b = 0; b < num_blocks; ++b) { power[(b * num_bins) + ((b * 5) % num_bins)] = 10.0 + double(b); }// NOLINT
+  const std::span<const double> spectrogram(power);
+
+  const Matrix all = afs::extractLocalMaxima(spectrogram, num_blocks, num_bins, make_config(0, 1, 100));
+  REQUIRE(peak_positions(all).size() == num_blocks);
+
+  // A budget of 3 keeps the 3 last, loudest blocks of every second, still in time order.
+  const Matrix peaks = afs::extractLocalMaxima(spectrogram, num_blocks, num_bins, make_config(0, 1, 3));
+  std::vector<std::pair<size_t, int>> expected;
+  for (const size_t b : { 7U, 8U, 9U, 17U, 18U, 19U, 22U, 23U, 24U }) {// NOLINT
+    expected.emplace_back(b, int((b * 5) % num_bins));
+  }
+  REQUIRE(peak_positions(peaks) == expected);
+
+  // The same in single precision.
+  const std::vector<float> power_f(power.begin(), power.end());
+  const Matrix peaks_f =
+    afs::extractLocalMaxima(std::span<const float>(power_f), num_blocks, num_bins, make_config(0, 1, 3));
+  REQUIRE(peak_positions(peaks_f) == expected);
+}
+
+}// namespace afs::test
@@ -0,0 +1,149 @@
+#include <afsproject/audio_file.h>
+#include <afsproject/pipe_audio_file.h>
+#include <afsproject/wave_file.h>
+#include "fixture_writer.h"
+#include <bit>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  std::string to_string(const std::vector<uint8_t> &bytes) { return { bytes.begin(), bytes.end() }; }
+
+  // 16 bit stereo frames, left rising and right falling.
+  std::vector<uint8_t> make_s16_frames(size_t num_frames, std::vector<double> &expected)
+  {
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < num_frames; ++i) {
+      const auto left = int16_t(int(i) * 100);
+      const auto right = int16_t(-int(i) * 100);
+      appendLE(data, uint16_t(left), 2);
+      appendLE(data, uint16_t(right), 2);
+      expected.push_back(double(left) / 32768.0);
+      expected.push_back(double(right) / 32768.0);
+    }
+    return data;
+  }
+
+}// namespace
+
+TEST_CASE("WAV on stdin runs to the end of the stream when its length is unknown", "[pipe][wave]")
+{
+  std::vector<double> expected;
+  const std::vector<uint8_t> data = make_s16_frames(100000, expected);
+  std::vector<uint8_t> wave = makeWave(1, 2, 22050, 16, data);
+
+  // A transcoder writing to a pipe cannot seek back to fill in the sizes.
+  constexpr size_t data_size_offset = 40;
+  for (size_t i = 0; i < 4; ++i) { wave[data_size_offset + i] = 0xFF; }
+
+  std::istringstream in(to_string(wave));
+  std::streambuf *const stdin_buffer = std::cin.rdbuf(in.rdbuf());
+  afs::PipeAudioFile pipe;
+  const bool loaded = pipe.load("-");
+  std::cin.rdbuf(stdin_buffer);
+
+  REQUIRE(loaded);
+  REQUIRE(pipe.getSampleRate() == 22050);
+  REQUIRE(pipe.getNumChannels() == 2);
+  REQUIRE(pipe.getBitDepth() == 16);
+  REQUIRE(pipe.getNumSamplesPerChannel() == 100000);
+  REQUIRE(pipe.getPCMData() == expected);
+}
+
+TEST_CASE("WAV data chunk size ends the read and other chunks are skipped", "[pipe][wave]")
+{
+  std::vector<double> expected;
+  const std::vector<uint8_t> data = make_s16_frames(10, expected);
+  std::vector<uint8_t> wave = makeWave(1, 2, 8000, 16, data);
+
+  // An odd sized LIST chunk with its pad byte ahead of the data, and trailing bytes after it.
+  constexpr size_t data_chunk_offset = 36;
+  std::vector<uint8_t> list;
+  appendText(list, "LIST");
+  appendLE(list, 3, 4);
+  list.insert(list.end(), { 'a', 'b', 'c', 0 });
+  wave.insert(wave.begin() + data_chunk_offset, list.begin(), list.end());
+  wave.insert(wave.end(), { 0x7F, 0x7F, 0x7F, 0x7F });
+
+  std::istringstream in(to_string(wave));
+  afs::PipeAudioFile pipe;
+  REQUIRE(pipe.load(in));
+  REQUIRE(pipe.getPCMData() == expected);
+}
+
+TEST_CASE("Raw PCM is read in the declared format, a partial frame at the end is dropped", "[pipe][raw]")
+{
+  std::vector<double> expected;
+  // More than one read chunk, the bytes sniffed for a WAV header lead the first one.
+  std::vector<uint8_t> data = make_s16_frames(50000, expected);
+  data.push_back(0x01);
+
+  const auto format = afs::makeRawPCMFormat("s16le", 16000, 2);
+  REQUIRE(format.has_value());
+
+  std::istringstream in(to_string(data));
+  afs::PipeAudioFile pipe(*format);
+  REQUIRE(pipe.load(in));
+  REQUIRE(pipe.getSampleRate() == 16000);
+  REQUIRE(pipe.getNumSamplesPerChannel() == 50000);
+  REQUIRE(pipe.getPCMData() == expected);
+}
+
+TEST_CASE("A stream keeps no samples but knows how long it was", "[pipe][raw]")
+{
+  std::vector<double> expected;
+  const std::vector<uint8_t> data = make_s16_frames(40000, expected);
+
+  std::istringstream in(to_string(data));
+  afs::PipeAudioFile pipe(*afs::makeRawPCMFormat("s16le", 16000, 2));
+  size_t num_samples = 0;
+  REQUIRE(pipe.stream(in, [&num_samples](afs::PCMBuffer &&chunk) { num_samples += afs::getNumStoredSamples(chunk); }));
+
+  REQUIRE(num_samples == expected.size());
+  REQUIRE(pipe.getNumSamplesPerChannel() == 0);
+  REQUIRE(pipe.getDurationSeconds() == 2.5);
+}
+
+TEST_CASE("Raw PCM shorter than a WAV header is still read", "[pipe][raw]")
+{
+  const std::vector<double> expected = { 0.5, -0.25 };
+  std::vector<uint8_t> data;
+  for (const double value : expected) { appendLE(data, std::bit_cast<uint32_t>(float(value)), 4); }
+
+  std::istringstream in(to_string(data));
+  afs::PipeAudioFile pipe(*afs::makeRawPCMFormat("f32le", 8000, 1));
+  REQUIRE(pipe.load(in));
+  REQUIRE(pipe.getPCMData() == expected);
+}
+
+TEST_CASE("An empty stream holds no samples", "[pipe][raw]")
+{
+  std::istringstream in;
+  afs::PipeAudioFile pipe;
+  REQUIRE_FALSE(pipe.load(in));
+  REQUIRE(pipe.getNumSamplesPerChannel() == 0);
+}
+
+TEST_CASE("Raw PCM formats are looked up by their ffmpeg name", "[pipe][raw]")
+{
+  const auto s24 = afs::makeRawPCMFormat("s24le", 48000, 6);
+  REQUIRE(s24.has_value());
+  REQUIRE(s24->format == afs::WaveFormat::PCM);
+  REQUIRE(s24->bit_depth == 24);
+  REQUIRE(s24->num_channels == 6);
+
+  REQUIRE(afs::makeRawPCMFormat("f64le", 44100, 2)->format == afs::WaveFormat::IEEE_FLOAT);
+  REQUIRE_FALSE(afs::makeRawPCMFormat("s16be", 44100, 2).has_value());
+  REQUIRE_FALSE(afs::makeRawPCMFormat("s16le", 0, 2).has_value());
+  REQUIRE_FALSE(afs::makeRawPCMFormat("s16le", 44100, 0).has_value());
+}
+
+}// namespace afs::test
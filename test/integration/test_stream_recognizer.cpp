@@ -0,0 +1,136 @@
+#include <afsproject/afs.h>
+#include <afsproject/db.h>
+#include <afsproject/stream_recognizer.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  constexpr uint32_t SAMPLE_RATE = 8000;
+
+  // A catalogue of hashes written straight into the postings, no audio involved. Hashes
+  // without hash_stats rows weigh 1, so the score of a hop is the number of hashes in it.
+  class SyntheticCatalogue
+  {
+  public:
+    SyntheticCatalogue() : m_db(":memory:")
+    {
+      afs::run(m_db, MIGRATION_DIR);
+      m_db.execute("INSERT INTO songs (id, title, artist, file_path) VALUES (1, 'one', 'test', 'one.wav');");
+      m_db.execute("INSERT INTO songs (id, title, artist, file_path) VALUES (2, 'two', 'test', 'two.wav');");
+    }
+
+    SQLiteDB &db() { return m_db; }
+
+    // `count` hashes of `song_id` anchored 50 ms apart from the start of hop `hop`, the
+    // catalogue holds them at the same time in the song. Every call uses fresh addresses.
+    Fingerprint hop(int64_t song_id, size_t hop, size_t count)
+    {
+      SQLiteDB::Statement insert(m_db, "INSERT INTO fingerprints (hash, song_id, time_offset) VALUES (?, ?, ?);");
+      const auto hop_ms = int64_t(hop) * 2000;
+
+      Fingerprint fingerprints;
+      for (size_t i = 0; i < count; ++i) {
+        const uint32_t address = m_next_address++;
+        const auto anchor_time = uint32_t(i * 50);
+        fingerprints.push_back({ address, anchor_time });
+
+        insert.bindInt(1, int(address));
+        insert.bindLongLong(2, song_id);
+        insert.bindLongLong(3, hop_ms + anchor_time);
+        insert.step();
+        insert.reset();
+      }
+
+      return fingerprints;
+    }
+
+  private:
+    SQLiteDB m_db;
+    uint32_t m_next_address = 1;
+  };
+
+}// namespace
+
+TEST_CASE("A song has to reach the enter score to open a segment", "[stream]")
+{
+  SyntheticCatalogue catalogue;
+  afs::StreamRecognizer recognizer(catalogue.db(), SAMPLE_RATE, 1);
+
+  // 15 votes a hop stay below the enter score of 20 however long they last, the decayed
+  // votes add up but only the votes of the current window can open a segment.
+  for (size_t hop = 0; hop < 5; ++hop) {
+    recognizer.pushHashes(catalogue.hop(1, hop, 15), double(hop) * 2.0);
+    REQUIRE(recognizer.takeSegments().empty());
+  }
+
+  recognizer.pushHashes(catalogue.hop(1, 5, 25), 10.0);
+  recognizer.finish();
+
+  const std::vector<StreamSegment> segments = recognizer.takeSegments();
+  REQUIRE(segments.size() == 1);
+  REQUIRE(segments[0].song_id == 1);
+  REQUIRE(segments[0].start_seconds == 10.0);
+  REQUIRE(segments[0].end_seconds == 12.0);
+}
+
+TEST_CASE("An open segment outlasts a dropout and closes once its votes decay", "[stream]")
+{
+  SyntheticCatalogue catalogue;
+  afs::StreamRecognizer recognizer(catalogue.db(), SAMPLE_RATE, 1);
+
+  // 25 votes open the segment. Every silent hop keeps exp(-2 / 6) of them:
+  // 17.9, 12.8, 9.2 stay above the exit score of 8, 6.6 does not.
+  recognizer.pushHashes(catalogue.hop(1, 0, 25), 0.0);
+  for (size_t hop = 1; hop <= 3; ++hop) {
+    recognizer.pushHashes({}, double(hop) * 2.0);
+    REQUIRE(recognizer.takeSegments().empty());
+  }
+
+  recognizer.pushHashes({}, 8.0);
+  const std::vector<StreamSegment> segments = recognizer.takeSegments();
+  REQUIRE(segments.size() == 1);
+  REQUIRE(segments[0].song_id == 1);
+  REQUIRE(segments[0].start_seconds == 0.0);
+  // The silent hops did not vote for the song, the segment did not grow over them.
+  REQUIRE(segments[0].end_seconds == 2.0);
+  REQUIRE(segments[0].confidence > 0.99);
+}
+
+TEST_CASE("A weak window keeps the segment open, a stronger song takes over", "[stream]")
+{
+  SyntheticCatalogue catalogue;
+  afs::StreamRecognizer recognizer(catalogue.db(), SAMPLE_RATE, 1);
+
+  recognizer.pushHashes(catalogue.hop(1, 0, 30), 0.0);
+  recognizer.pushHashes(catalogue.hop(1, 1, 30), 2.0);
+  // Between the exit and the enter score: the segment grows over this hop.
+  recognizer.pushHashes(catalogue.hop(1, 2, 10), 4.0);
+  // Another song below the enter score cannot take over.
+  recognizer.pushHashes(catalogue.hop(2, 3, 15), 6.0);
+  REQUIRE(recognizer.takeSegments().empty());
+
+  recognizer.pushHashes(catalogue.hop(2, 4, 40), 8.0);
+  std::vector<StreamSegment> segments = recognizer.takeSegments();
+  REQUIRE(segments.size() == 1);
+  REQUIRE(segments[0].song_id == 1);
+  REQUIRE(segments[0].start_seconds == 0.0);
+  REQUIRE(segments[0].end_seconds == 6.0);
+
+  recognizer.finish();
+  segments = recognizer.takeSegments();
+  REQUIRE(segments.size() == 1);
+  REQUIRE(segments[0].song_id == 2);
+  REQUIRE(segments[0].start_seconds == 8.0);
+  REQUIRE(segments[0].end_seconds == 10.0);
+  REQUIRE(segments[0].confidence > 0.0);
+  REQUIRE(segments[0].confidence < 1.0);
+}
+
+}// namespace afs::test
@@ -0,0 +1,172 @@
+#include <afsproject/audio_file.h>
+#include <afsproject/wave_file.h>
+#include "fixture_writer.h"
+#include <algorithm>
+#include <bit>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace afs::test {
+
+namespace {
+
+  // Loads a generated file and returns its samples, empty when the load failed.
+  std::vector<double> load_wave(const std::string &name, const std::vector<uint8_t> &bytes)
+  {
+    auto wave = std::make_unique<afs::WaveFile>();
+    if (!wave->load(writeFixture(name, bytes))) { return {}; }
+    return wave->getPCMData();
+  }
+
+  // Little endian integer samples of `bits` width.
+  std::vector<uint8_t> pack_integers(const std::vector<int64_t> &values, size_t bytes_per_sample)
+  {
+    std::vector<uint8_t> data;
+    for (const int64_t value : values) { appendLE(data, uint64_t(value), bytes_per_sample); }
+    return data;
+  }
+
+  // LIST/INFO chunk of zero terminated tags, odd sizes padded to an even length.
+  std::vector<uint8_t> make_info_list(const std::vector<std::pair<std::string, std::string>> &tags)
+  {
+    std::vector<uint8_t> body;
+    appendText(body, "INFO");
+    for (const auto &[id, text] : tags) {
+      appendText(body, id);
+      appendLE(body, text.size() + 1, 4);
+      appendText(body, text);
+      body.push_back(0);
+      if ((text.size() + 1) % 2 != 0) { body.push_back(0); }
+    }
+
+    std::vector<uint8_t> list;
+    appendText(list, "LIST");
+    appendLE(list, body.size(), 4);
+    list.insert(list.end(), body.begin(), body.end());
+    return list;
+  }
+
+  // Puts `chunk` at `offset` and fixes up the RIFF size.
+  void insert_chunk(std::vector<uint8_t> &wave, size_t offset, const std::vector<uint8_t> &chunk)
+  {
+    wave.insert(wave.begin() + std::ptrdiff_t(offset), chunk.begin(), chunk.end());
+    std::vector<uint8_t> riff_size;
+    appendLE(riff_size, wave.size() - 8, 4);
+    std::copy(riff_size.begin(), riff_size.end(), wave.begin() + 4);
+  }
+
+}// namespace
+
+TEST_CASE("8 bit PCM is unsigned around 128", "[wave][pcm]")
+{
+  const std::vector<uint8_t> data = { 0, 64, 128, 192, 255, 128 };
+  const std::vector<double> samples = load_wave("pcm8.wav", makeWave(1, 2, 8000, 8, data));
+
+  const std::vector<double> expected = { -1.0, -0.5, 0.0, 0.5, 127.0 / 128.0, 0.0 };
+  REQUIRE(samples == expected);
+}
+
+TEST_CASE("16, 24 and 32 bit PCM keep their full range", "[wave][pcm]")
+{
+  struct Width
+  {
+    uint16_t bits;
+    int64_t full_scale;
+  };
+
+  for (const Width width : { Width{ 16, 1LL << 15 }, Width{ 24, 1LL << 23 }, Width{ 32, 1LL << 31 } }) {
+    const std::vector<int64_t> values = { -width.full_scale, -1, 0, 1, width.full_scale / 2, width.full_scale - 1 };
+    const std::vector<uint8_t> data = pack_integers(values, width.bits / 8U);
+
+    for (const bool extensible : { false, true }) {
+      const std::string name = "pcm" + std::to_string(width.bits) + (extensible ? "_ext.wav" : ".wav");
+      const std::vector<double> samples = load_wave(name, makeWave(1, 2, 48000, width.bits, data, extensible));
+
+      REQUIRE(samples.size() == values.size());
+      for (size_t i = 0; i < values.size(); ++i) {
+        REQUIRE(samples[i] == double(values[i]) / double(width.full_scale));
+      }
+    }
+  }
+}
+
+TEST_CASE("32 and 64 bit float samples are taken as they are", "[wave][float]")
+{
+  const std::vector<double> values = { -1.0, -0.25, 0.0, 0.125, 0.75, 1.0 };
+
+  std::vector<uint8_t> data32;
+  std::vector<uint8_t> data64;
+  for (const double value : values) {
+    appendLE(data32, std::bit_cast<uint32_t>(float(value)), 4);
+    appendLE(data64, std::bit_cast<uint64_t>(value), 8);
+  }
+
+  REQUIRE(load_wave("float32.wav", makeWave(3, 1, 44100, 32, data32)) == values);
+  REQUIRE(load_wave("float64.wav", makeWave(3, 1, 44100, 64, data64)) == values);
+  REQUIRE(load_wave("float32_ext.wav", makeWave(3, 1, 44100, 32, data32, true)) == values);
+}
+
+TEST_CASE("Scan reads the stream properties and the INFO tags ahead of the data", "[wave][scan]")
+{
+  // 24 bit stereo, 100 frames.
+  const std::vector<uint8_t> data(size_t(100) * 2 * 3, 0x11);
+  std::vector<uint8_t> wave = makeWave(1, 2, 48000, 24, data);
+  constexpr size_t data_chunk_offset = 36;
+  const std::vector<uint8_t> list = make_info_list(
+    { { "INAM", "Title" }, { "IART", "Artist" }, { "IPRD", "Album" }, { "IGNR", "Genre" }, { "ICRD", "1999" } });
+  insert_chunk(wave, data_chunk_offset, list);
+
+  afs::AudioInfo info;
+  REQUIRE(afs::WaveFile::scan(writeFixture("scan_info.wav", wave), info));
+  REQUIRE(info.sample_rate == 48000);
+  REQUIRE(info.num_channels == 2);
+  REQUIRE(info.bit_depth == 24);
+  REQUIRE(info.num_frames == 100);
+  REQUIRE(info.metadata.title == "Title");
+  REQUIRE(info.metadata.artist == "Artist");
+  REQUIRE(info.metadata.album == "Album");
+  REQUIRE(info.metadata.genre == "Genre");
+  REQUIRE(info.metadata.date == "1999");
+}
+
+TEST_CASE("Scan finds a LIST chunk after the data", "[wave][scan]")
+{
+  // An odd sized 8 bit data chunk, its pad byte sits between the data and the LIST chunk.
+  const std::vector<uint8_t> data(77, 0x80);
+  std::vector<uint8_t> wave = makeWave(1, 1, 11025, 8, data);
+  // A LIST chunk of another kind ahead of the INFO one is skipped.
+  std::vector<uint8_t> adtl;
+  appendText(adtl, "LIST");
+  appendLE(adtl, 4, 4);
+  appendText(adtl, "adtl");
+  insert_chunk(wave, wave.size(), adtl);
+  insert_chunk(wave, wave.size(), make_info_list({ { "INAM", "Late" }, { "IART", "Tail" } }));
+
+  afs::AudioInfo info;
+  REQUIRE(afs::WaveFile::scan(writeFixture("scan_trailing_list.wav", wave), info));
+  REQUIRE(info.sample_rate == 11025);
+  REQUIRE(info.num_channels == 1);
+  REQUIRE(info.bit_depth == 8);
+  REQUIRE(info.num_frames == data.size());
+  REQUIRE(info.metadata.title == "Late");
+  REQUIRE(info.metadata.artist == "Tail");
+  REQUIRE(info.metadata.album.empty());
+
+  REQUIRE_FALSE(afs::WaveFile::scan(writeFixture("scan_short.wav", std::vector<uint8_t>(8, 0)), info));
+}
+
+TEST_CASE("Unsupported formats are rejected", "[wave]")
+{
+  const std::vector<uint8_t> data(16, 0);
+
+  // A-law has no kernel and there is no 16 bit float.
+  REQUIRE(load_wave("alaw.wav", makeWave(6, 1, 8000, 8, data)).empty());
+  REQUIRE(load_wave("float16.wav", makeWave(3, 1, 8000, 16, data)).empty());
+}
+
+}// namespace afs::test